@@ -0,0 +1,64 @@
+#ifndef CHANNEL_MAP_HH
+#define CHANNEL_MAP_HH
+
+// Detector channel of every TDC input, shared by the online filter of hodo_daq
+// and the decoder of hodo_analysis from common/include.
+//
+//   -1..-49 inner downstream bars, -50..-89 inner upstream bars, -100.. inner tiles
+//    1..49  outer downstream bars,  50..89  outer upstream bars,  100.. outer tiles
+//  300..363 BGO, 500.. trigger, -999 not connected
+
+#include <array>
+
+/**
+ * @brief Maps a TDC input (tdcID * 128 + channel) to the detector channel.
+ *
+ * @param tdcch The TDC input.
+ * @return The detector channel, -999 for unused or invalid inputs.
+ */
+constexpr int mapChannel(int tdcch) {
+    // Ensure tdcch is within a valid range
+    if (tdcch < 0 || tdcch >= 28 * 16) {
+        return -999; // Error value (invalid channel)
+    }
+
+    constexpr std::array<std::array<int, 16>, 28> board = {{
+        {{   4 ,   5 ,   6 ,   7 ,   8 ,   9 ,  10 ,  11 ,  -4 ,  -5 ,  -6 ,  -7 ,  -8 ,  -9 , -10 , -11 }}, // A0 Bars 4-11
+        {{  12 ,  13 ,  14 ,  15 ,  16 ,  17 ,  18 ,  19 , -12 , -13 , -14 , -15 , -16 , -17 , -18 , -19 }}, // A1 Bars 12-19
+        {{ -61 , -60 , -59 , -58 , -57 , -56 , -55 , -54 ,  61 ,  60 ,  59 ,  58 ,  57 ,  56 ,  55 ,  54 }}, // D1 Bars 4-11
+        {{ -69 , -68 , -67 , -66 , -65 , -64 , -63 , -62 ,  69 ,  68 ,  67 ,  66 ,  65 ,  64 ,  63 ,  62 }}, // D0 Bars 12-19
+        {{ 100 , 101 , 102 , 103 , 104 , 105 , 106 , 107 , 115 , 116 , 117 , 118 , 119 , 120 , 121 , 122 }}, // Outer Tiles AmpBoard 10
+        {{ 130 , 131 , 132 , 133 , 134 , 135 , 136 , 137 , 145 , 146 , 147 , 148 , 149 , 150 , 151 , 152 }}, // Outer Tiles AmpBoard 11
+        {{ 108 , 109 , 110 , 111 , 112 ,-999 , 114 ,-999 , 123 , 124 , 125 , 126 , 127 , 128 , 129 , 113 }}, // Outer Tiles AmpBoard 14
+        {{ 138 , 139 , 140 , 141 , 142 , 143 , 144 ,-999 , 153 , 154 , 155 , 156 , 157 , 158 , 159 , 500 }}, // Outer Tiles AmpBoard 15
+        {{  20 ,  21 ,  22 ,  23 ,  24 ,  25 ,  26 ,  27 , -20 , -21 , -22 , -23 , -24 , -25 , -26 , -27 }}, // B0 Bars 20-27
+        {{  28 ,  29 ,  30 ,  31 ,  32 ,   1 ,   2 ,   3 , -28 , -29 , -30 , -31 , -32 ,  -1 ,  -2 ,  -3 }}, // B1 Bars 28-3
+        {{ -77 , -76 , -75 , -74 , -73 , -72 , -71 , -70 ,  77 ,  76 ,  75 ,  74 ,  73 ,  72 ,  71 ,  70 }}, // E0 Bars 20-27
+        {{ -53 , -52 , -51 , -82 , -81 , -80 , -79 , -78 ,  53 ,  52 ,  51 ,  82 ,  81 ,  80 ,  79 ,  78 }}, // E1 Bars 28-3
+        {{ 160 , 161 , 162 , 163 , 164 , 165 , 166 ,-999 , 175 , 176 , 177 , 178 , 179 , 180 , 181 ,-999 }}, // Outer Tiles AmpBoard 12
+        {{ 190 , 191 , 192 , 193 , 194 , 195 , 196 , 197 , 205 , 206 , 207 , 208 , 209 , 210 , 211 , 212 }}, // Outer Tiles AmpBoard 13
+        {{ 167 , 168 , 169 , 170 , 171 , 172 , 173 , 174 , 182 , 183 , 184 , 185 , 186 , 187 , 188 , 189 }}, // Outer Tiles AmpBoard 16
+        {{ 198 , 199 , 200 , 201 , 202 , 203 , 204 ,-999 , 213 , 214 , 215 , 216 , 217 , 218 , 219 , 501 }}, // Outer Tiles AmpBoard 17
+        {{-100 ,-101 ,-102 ,-103 ,-104 ,-105 ,-106 ,-107 ,-115 ,-116 ,-117 ,-118 ,-119 ,-120 ,-121 ,-122 }}, // Inner Tiles AmpBoard 18
+        {{-130 ,-131 ,-132 ,-133 ,-134 ,-135 ,-136 ,-137 ,-145 ,-146 ,-147 ,-148 ,-149 ,-150 ,-151 ,-152 }}, // Inner Tiles AmpBoard 19
+        {{-160 ,-161 ,-162 ,-163 ,-164 ,-165 ,-166 ,-167 ,-175 ,-176 ,-177 ,-178 ,-179 ,-180 ,-181 ,-182 }}, // Inner Tiles AmpBoard 20
+        {{-190 ,-191 ,-192 ,-193 ,-194 ,-195 ,-196 ,-197 ,-205 ,-206 ,-207 ,-208 ,-209 ,-210 ,-211 ,-212 }}, // Inner Tiles AmpBoard 21
+        {{-108 ,-109 ,-110 ,-111 ,-112 ,-113 ,-114 ,-999 ,-123 ,-124 ,-125 ,-126 ,-127 ,-128 ,-129 ,-999 }}, // Inner Tiles AmpBoard 22
+        {{-138 ,-139 ,-140 ,-141 ,-142 ,-143 ,-144 ,-999 ,-153 ,-154 ,-155 ,-156 ,-157 ,-158 ,-159 ,-999 }}, // Inner Tiles AmpBoard 23
+        {{-168 ,-169 ,-170 ,-171 ,-172 ,-173 ,-174 ,-999 ,-183 ,-184 ,-185 ,-186 ,-187 ,-188 ,-189 ,-999 }}, // Inner Tiles AmpBoard 24
+        {{-198 ,-199 ,-200 ,-201 ,-202 ,-203 ,-204 ,-999 ,-213 ,-214 ,-215 ,-216 ,-217 ,-218 ,-219 , 502 }}, // Inner Tiles AmpBoard 25
+        {{ 300 , 301 , 302 , 303 , 304 , 305 , 306 , 307 , 308 , 309 , 310 , 311 , 312 , 313 , 314 , 503 }}, // BGO 1
+        // {{ 300 , 301 , 302 , 303 , 304 , 305 , 306 , 307 , 308 , 309 , 310 , 311 , 312 , 313 , 314 , 315 }}, // BGO 1
+        {{ 316 , 317 , 318 , 319 , 320 , 321 , 322 , 323 , 324 , 325 , 326 , 327 , 328 , 329 , 330 , 331 }}, // BGO 2
+        // {{ 332 , 333 , 334 , 335 , 336 , 337 , 338 , 339 , 340 , 341 , 342 , 343 , 344 , 345 , 346 , 600 }}, // BGO 3
+        {{ 332 , 333 , 334 , 335 , 336 , 337 , 338 , 339 , 340 , 341 , 342 , 343 , 344 , 345 , 346 , 347 }}, // BGO 3
+        {{ 348 , 349 , 350 , 351 , 352 , 353 , 354 , 355 , 356 , 357 , 358 , 359 , 360 , 361 , 362 , 363 }}  // BGO 4
+    }};
+
+    int port = tdcch / 16;
+    int index = tdcch % 16;
+
+    return board[port][index];
+}
+
+#endif  // CHANNEL_MAP_HH
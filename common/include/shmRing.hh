@@ -0,0 +1,236 @@
+#ifndef SHM_RING_HH
+#define SHM_RING_HH
+
+// Shared-memory ring of serialized blocks between hodo_daq (writer) and
+// hodo_analysis (readers). Included by both from common/include, so writer
+// and reader always agree on the layout.
+//
+// The writer never waits for readers: it overwrites the oldest data. Every
+// block gets a sequence number and an index slot with its position in the
+// data area. Readers copy a block and check afterwards that it was not
+// overwritten meanwhile, blocks they were too slow for are reported as lost.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace shmring {
+
+constexpr uint32_t MAGIC = 0x484F4452;   // "HODR"
+constexpr uint32_t VERSION = 1;
+
+struct Slot {
+    std::atomic<uint64_t> seq;          // 2*n+1 while block n is written, 2*n+2 when done
+    std::atomic<uint64_t> offset;       // position in the data stream, not wrapped
+    std::atomic<uint32_t> length;       // bytes
+    std::atomic<uint32_t> blockID;
+    std::atomic<uint32_t> runNumber;
+};
+
+struct Header {
+    std::atomic<uint32_t> magic;        // set last, readers wait for it
+    uint32_t version;
+    uint64_t dataSize;                  // bytes in the data area
+    uint64_t nSlots;
+    std::atomic<uint64_t> writeSeq;     // sequence number of the next block
+    std::atomic<uint64_t> head;         // bytes written into the stream, not wrapped
+};
+
+inline size_t mappedSize(uint64_t dataSize, uint64_t nSlots) {
+    return sizeof(Header) + nSlots * sizeof(Slot) + dataSize;
+}
+
+inline Slot* slots(void* base) {
+    return reinterpret_cast<Slot*>(static_cast<char*>(base) + sizeof(Header));
+}
+
+inline char* data(void* base, uint64_t nSlots) {
+    return static_cast<char*>(base) + sizeof(Header) + nSlots * sizeof(Slot);
+}
+
+inline const Slot* slots(const void* base) {
+    return reinterpret_cast<const Slot*>(static_cast<const char*>(base) + sizeof(Header));
+}
+
+inline const char* data(const void* base, uint64_t nSlots) {
+    return static_cast<const char*>(base) + sizeof(Header) + nSlots * sizeof(Slot);
+}
+
+}
+
+class ShmRingWriter {
+public:
+    ShmRingWriter(const std::string& name, uint64_t dataSize, uint64_t nSlots = 4096) : name(name) {
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) return;
+
+        size = shmring::mappedSize(dataSize, nSlots);
+        if (ftruncate(fd, size) == 0) {
+            void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            base = (p == MAP_FAILED) ? nullptr : p;
+        }
+        close(fd);
+        if (!base) return;
+
+        header = static_cast<shmring::Header*>(base);
+        header->magic.store(0, std::memory_order_relaxed);
+        header->version = shmring::VERSION;
+        header->dataSize = dataSize;
+        header->nSlots = nSlots;
+        header->writeSeq.store(0, std::memory_order_relaxed);
+        header->head.store(0, std::memory_order_relaxed);
+        for (uint64_t i = 0; i < nSlots; i++) {
+            shmring::slots(base)[i].seq.store(0, std::memory_order_relaxed);
+        }
+        header->magic.store(shmring::MAGIC, std::memory_order_release);
+    }
+
+    ~ShmRingWriter() {
+        if (base) munmap(base, size);
+        shm_unlink(name.c_str());
+    }
+
+    bool isOpen() const { return base != nullptr; }
+
+    // Publishes one block, blocks larger than the data area are not published
+    bool publish(const void* block, uint32_t length, uint32_t blockID, uint32_t runNumber) {
+        if (!base || length > header->dataSize) return false;
+
+        const uint64_t seq = header->writeSeq.load(std::memory_order_relaxed);
+        const uint64_t offset = header->head.load(std::memory_order_relaxed);
+        shmring::Slot& slot = shmring::slots(base)[seq % header->nSlots];
+
+        slot.seq.store(2 * seq + 1, std::memory_order_relaxed);
+        // Readers check head after copying, advancing it first marks the old bytes as overwritten
+        header->head.store(offset + length, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const uint64_t start = offset % header->dataSize;
+        const uint64_t first = std::min<uint64_t>(length, header->dataSize - start);
+        char* ring = shmring::data(base, header->nSlots);
+        std::memcpy(ring + start, block, first);
+        std::memcpy(ring, static_cast<const char*>(block) + first, length - first);
+
+        slot.offset.store(offset, std::memory_order_relaxed);
+        slot.length.store(length, std::memory_order_relaxed);
+        slot.blockID.store(blockID, std::memory_order_relaxed);
+        slot.runNumber.store(runNumber, std::memory_order_relaxed);
+        slot.seq.store(2 * seq + 2, std::memory_order_release);
+        header->writeSeq.store(seq + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::string name;
+    void* base = nullptr;
+    size_t size = 0;
+    shmring::Header* header = nullptr;
+};
+
+class ShmRingReader {
+public:
+    enum class Status { Ok, Empty, Lost };
+
+    ShmRingReader(const std::string& name) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) return;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(shmring::Header)) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) {
+                base = p;
+                size = st.st_size;
+            }
+        }
+        close(fd);
+        if (!base) return;
+
+        header = static_cast<const shmring::Header*>(base);
+        if (header->magic.load(std::memory_order_acquire) != shmring::MAGIC
+            || header->version != shmring::VERSION
+            || size < shmring::mappedSize(header->dataSize, header->nSlots)) {
+            munmap(base, size);
+            base = nullptr;
+            return;
+        }
+        // Only blocks published after attaching are read
+        nextSeq = header->writeSeq.load(std::memory_order_acquire);
+    }
+
+    ~ShmRingReader() {
+        if (base) munmap(base, size);
+    }
+
+    bool isOpen() const { return base != nullptr; }
+    uint64_t lostBlocks() const { return lost; }
+
+    /**
+     * Copies the next block into out, never waits.
+     * Empty: no new block. Lost: the reader fell behind, the missed blocks are
+     * skipped and counted, the next call continues with the oldest available block.
+     */
+    Status read(std::vector<uint32_t>& out, uint32_t& blockID, uint32_t& runNumber) {
+        if (!base) return Status::Empty;
+
+        const uint64_t writeSeq = header->writeSeq.load(std::memory_order_acquire);
+        if (nextSeq >= writeSeq) return Status::Empty;
+
+        if (writeSeq - nextSeq > header->nSlots) {
+            skip(writeSeq - header->nSlots);
+            return Status::Lost;
+        }
+
+        const shmring::Slot& slot = shmring::slots(static_cast<const void*>(base))[nextSeq % header->nSlots];
+        const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != 2 * nextSeq + 2) {
+            skip(nextSeq + 1);      // slot reused for a newer block
+            return Status::Lost;
+        }
+
+        const uint64_t offset = slot.offset.load(std::memory_order_relaxed);
+        const uint32_t length = slot.length.load(std::memory_order_relaxed);
+        blockID = slot.blockID.load(std::memory_order_relaxed);
+        runNumber = slot.runNumber.load(std::memory_order_relaxed);
+
+        out.resize(length / sizeof(uint32_t));
+        const uint64_t start = offset % header->dataSize;
+        const uint64_t first = std::min<uint64_t>(length, header->dataSize - start);
+        const char* ring = shmring::data(static_cast<const void*>(base), header->nSlots);
+        std::memcpy(out.data(), ring + start, first);
+        std::memcpy(reinterpret_cast<char*>(out.data()) + first, ring, length - first);
+
+        // The copy is only valid if the writer did not start to overwrite it meanwhile
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq
+            || header->head.load(std::memory_order_relaxed) > offset + header->dataSize) {
+            skip(nextSeq + 1);
+            return Status::Lost;
+        }
+
+        nextSeq++;
+        return Status::Ok;
+    }
+
+private:
+    void skip(uint64_t seq) {
+        lost += seq - nextSeq;
+        nextSeq = seq;
+    }
+
+    void* base = nullptr;
+    size_t size = 0;
+    const shmring::Header* header = nullptr;
+    uint64_t nextSeq = 0;
+    uint64_t lost = 0;
+};
+
+#endif // SHM_RING_HH
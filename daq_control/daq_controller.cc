@@ -4,6 +4,11 @@
 #include "vmeInterface.hh"
 #include "logger.hh"
 #include "tcp_server.hh"
+#include "shmRing.hh"
+#include "stageTimer.hh"
+#include "eventIdChecker.hh"
+#include "onlineFilter.hh"
+#include "threadPlacement.hh"
 
 #include <iostream>
 #include <vector>
@@ -11,12 +16,16 @@
 #include <stdlib.h>
 #include <queue>
 #include <thread>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <map>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
 
 #define NUM_TDCS 4
 #define NUM_FPGAS 1
@@ -39,7 +48,7 @@ VMEInterface vme(vmeConnType, vmeIPAddress);
 
 // Config file for run number: 
 const std::string runconfig = "../../config/daq_config.conf";
-std::map<std::string, std::string> config;
+std::mutex configMutex;              // serializes reading and writing runconfig, the TCP thread switches runs while processEvents runs
 
 // Thread safe readout 
 std::queue<DataBank> bankQueue;
@@ -59,6 +68,72 @@ bool stopWriter = false;
 std::thread fileWriter;
 
 uint32_t blockID = 0; // ID of each BLT block
+std::atomic<uint32_t> currentRunNumber{0};
+
+// Written blocks and bytes of the current run, reported by the TCP server
+std::atomic<uint64_t> blocksWritten{0};
+std::atomic<uint64_t> bytesWritten{0};
+
+// Shared-memory tap for the live analysis, never blocks the DAQ
+std::unique_ptr<ShmRingWriter> shmRing;
+
+// Output file of the current run, only used by the file writer thread
+FILE* runFile = nullptr;
+// File of the next run, opened by switch_run and taken over by the file writer
+// at the switch marker (an empty block) in the block queue
+FILE* nextRunFile = nullptr;
+
+// Group commit of the run file: fdatasync after commit_mb or commit_ms, the
+// durable size is recorded in <file_prefix><run>.commit for hodo_analysis -r
+uint64_t commitBytes = 16ull << 20;             // 0: no size trigger
+std::chrono::milliseconds commitInterval{1000}; // 0: no time trigger
+std::string runCommitName;                      // sidecar of runFile, only used by the file writer
+std::string nextRunCommitName;
+uint64_t uncommittedBytes = 0;
+std::chrono::steady_clock::time_point lastCommit;
+
+// Run switch: processEvents closes the last block of the old run and queues the marker
+bool switchPending = false;         // guarded by bankQueueMutex
+uint32_t switchRunNumber = 0;
+std::condition_variable switchDone;
+std::mutex readoutMutex;            // held by the polling thread while it reads out
+std::atomic<bool> holdReadout{false};
+
+// Scaler readout into the SCLR bank, by the polling thread
+std::chrono::milliseconds scalerInterval{1000};    // scaler_interval_ms, 0 disables it
+std::chrono::steady_clock::time_point lastScalerRead;
+
+// Dead time accounting of the current run, written to the LIVE bank of every
+// block and to the run summary
+#define LIVE_WORDS 11
+std::atomic<std::chrono::steady_clock::rep> runStart{0};   // steady_clock ticks, reset by the TCP thread on a run switch
+std::atomic<uint64_t> busyTime_us{0};       // polling: from almost full until all modules are read out
+std::atomic<uint32_t> busyCycles{0};
+std::atomic<uint32_t> recordedEvents{0};    // entries of the GATE lists
+std::atomic<uint32_t> scalerTriggers{0};    // last read trigger_cnt and gated_cnt
+std::atomic<uint32_t> scalerGated{0};
+std::atomic<uint32_t> triggerBase{0};       // the counters at the run start
+std::atomic<uint32_t> gatedBase{0};
+
+// Event ID consistency of the TDCs and the GATE list, checked for every block
+EventIdChecker eventIdChecker(NUM_TDCS);
+
+// Optional software trigger on the TDC data, only used by the processing thread
+OnlineFilter onlineFilter(NUM_TDCS);
+
+// Memory held by the bank and block queues. Above queue_high_mb the veto is
+// held until the queues are below queue_low_mb again, above queue_max_mb in
+// the block queue alone the processing thread waits for the file writer.
+std::atomic<uint64_t> bankQueueBytes{0};
+std::atomic<uint64_t> blockQueueBytes{0};
+std::atomic<uint64_t> queuePeakBytes{0};
+uint64_t queueHighBytes = 256ull << 20;     // 0 disables the veto
+uint64_t queueLowBytes = 128ull << 20;
+uint64_t queueMaxBytes = 512ull << 20;      // 0 disables the limit
+std::condition_variable blockSpace;
+std::mutex queueVetoMutex;
+bool queueVeto = false;                     // guarded by queueVetoMutex
+std::atomic<uint32_t> queueHoldBase{0};     // vme.vetoHolds() at the run start
 
 bool all_init = false;
 bool is_running = false;
@@ -68,8 +143,8 @@ bool is_running = false;
  *
  * This function reads a configuration file at the location specified by
  * the global variable `runconfig`. The file should contain lines of the form
- * "key=value". The resulting key-value pairs are stored in the global
- * `config` map.
+ * "key=value". Every call returns its own map, so callers on different
+ * threads do not share state.
  *
  * @return the config map
  */
@@ -77,8 +152,9 @@ std::map<std::string, std::string> loadConfig() {
 
     auto log = Logger::getLogger();
 
+    std::lock_guard<std::mutex> lock(configMutex);
     std::ifstream file(runconfig);
-    // std::map<std::string, std::string> config;
+    std::map<std::string, std::string> config;
     std::string line;
     
     if (!file.is_open()) {
@@ -111,6 +187,7 @@ std::map<std::string, std::string> loadConfig() {
  * @param config The configuration to be saved.
  */
 void saveConfig(const std::map<std::string, std::string>& config) {
+    std::lock_guard<std::mutex> lock(configMutex);
     std::ofstream file(runconfig);
     for (const auto& [key, value] : config) {
         file << key << "=" << value << "\n";
@@ -140,6 +217,88 @@ char* getRunFilename(int runNumber, const std::string& path, const std::string&
 }
 
 
+/**
+ * @brief Memory used by a bank in the bank queue.
+ */
+size_t bankBytes(const DataBank& bank) {
+    size_t bytes = sizeof(DataBank);
+    for (const auto& event : bank.getEvents()) {
+        bytes += sizeof(Event) + event.data.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Holds the veto while the queues are above the high watermark.
+ *
+ * Called after every change of the queues. The veto is released once both
+ * queues together are below the low watermark, the time in between counts
+ * as veto time in the dead time of the run.
+ */
+void checkQueueLevel() {
+    uint64_t bytes = bankQueueBytes + blockQueueBytes;
+    uint64_t peak = queuePeakBytes;
+    while (bytes > peak && !queuePeakBytes.compare_exchange_weak(peak, bytes)) {}
+
+    if (queueHighBytes == 0) return;
+
+    std::lock_guard<std::mutex> lock(queueVetoMutex);
+    if (!queueVeto && bytes >= queueHighBytes) {
+        queueVeto = true;
+        vme.holdVeto(true);
+        Logger::getLogger()->warn("Queues hold {:.1f} MB, veto on until they are below {:d} MB", bytes / 1048576., queueLowBytes >> 20);
+    } else if (queueVeto && bytes <= queueLowBytes) {
+        queueVeto = false;
+        vme.holdVeto(false);
+        Logger::getLogger()->info("Queues down to {:.1f} MB, veto released", bytes / 1048576.);
+    }
+}
+
+/**
+ * @brief Puts a bank into the bank queue for the processing thread.
+ *
+ * @param bank The bank, moved into the queue.
+ */
+void queueBank(DataBank&& bank) {
+    bankQueueBytes += bankBytes(bank);
+    {
+        std::lock_guard<std::mutex> lock(bankQueueMutex);
+        bankQueue.push(std::move(bank));
+        dataAvailable.notify_one();
+    }
+    checkQueueLevel();
+}
+
+/**
+ * @brief Takes the next bank from the bank queue, bankQueueMutex must be held.
+ */
+DataBank popBank() {
+    DataBank bank = std::move(bankQueue.front());
+    bankQueue.pop();
+    bankQueueBytes -= bankBytes(bank);
+    return bank;
+}
+
+/**
+ * @brief Puts a serialized block into the block queue for the file writer.
+ *
+ * @param data The block, moved into the queue.
+ * @param wait Wait while the block queue is above queue_max_mb.
+ */
+void queueBlock(std::vector<uint32_t>&& data, bool wait) {
+    {
+        std::unique_lock<std::mutex> blockLock(blockQueueMutex);
+        if (wait && queueMaxBytes > 0) {
+            // the veto is on by now, so this only waits for the data already taken
+            blockSpace.wait(blockLock, [] { return blockQueueBytes < queueMaxBytes || stopReadout; });
+        }
+        blockQueueBytes += data.size() * sizeof(uint32_t);
+        blockQueue.push(std::move(data));
+    }
+    blockQueueCond.notify_one();
+    checkQueueLevel();
+}
+
 /**
  * @brief Starts a readout thread for a given TDC.
  *
@@ -153,14 +312,13 @@ char* getRunFilename(int runNumber, const std::string& path, const std::string&
  */
 void startReadoutThread(v1190& tdc, std::string bankName) {
     readoutThreads.emplace_back([&tdc, bankName] () {
+        ThreadPlacement::apply(ThreadPlacement::Readout);
         // while(!stopReadout) {
             DataBank dataBank(bankName.c_str());
             unsigned int wordsRead = tdc.BLTRead(dataBank);
 
             if (wordsRead > 0) {
-                std::lock_guard<std::mutex> lock(bankQueueMutex);
-                bankQueue.push(std::move(dataBank));
-                dataAvailable.notify_one();
+                queueBank(std::move(dataBank));
             }
             int tdcID = bankName.back() - '0';
             tdcReading[tdcID] = false;
@@ -183,14 +341,13 @@ void startReadoutThread(v1190& tdc, std::string bankName) {
  */
 void startReadoutThread(v2495& fpga, std::string bankName, uint32_t regAddressList, uint32_t regAddressStatus) {
     readoutThreads.emplace_back([&fpga, bankName, regAddressList, regAddressStatus] () {
+        ThreadPlacement::apply(ThreadPlacement::Readout);
         // while(!stopReadout) {
             DataBank dataBank(bankName.c_str());
             unsigned int wordsRead = fpga.readList(dataBank, regAddressList, regAddressStatus);
 
             if (wordsRead > 0) {
-                std::lock_guard<std::mutex> lock(bankQueueMutex);
-                bankQueue.push(std::move(dataBank));
-                dataAvailable.notify_one();
+                queueBank(std::move(dataBank));
             }
 //            int tdcID = bankName.back() - '0';
 //            tdcReading[tdcID] = false;
@@ -213,15 +370,14 @@ void startReadoutThread(v2495& fpga, std::string bankName, uint32_t regAddressLi
  */
 void startReadoutThread(v2495& fpga, std::string bankName, uint32_t regAddressListOne, uint32_t regAddressStatusOne, uint32_t regAddressListTwo, uint32_t regAddressStatusTwo) {
     readoutThreads.emplace_back([&fpga, bankName, regAddressListOne, regAddressStatusOne, regAddressListTwo, regAddressStatusTwo] () {
+        ThreadPlacement::apply(ThreadPlacement::Readout);
         // while(!stopReadout) {
             DataBank dataBank(bankName.c_str());
 
             unsigned int wordsRead = fpga.readTwoLists(dataBank, regAddressListOne, regAddressStatusOne, regAddressListTwo, regAddressStatusTwo);
 
             if (wordsRead > 0) {
-                std::lock_guard<std::mutex> lock(bankQueueMutex);
-                bankQueue.push(std::move(dataBank));
-                dataAvailable.notify_one();
+                queueBank(std::move(dataBank));
             }
 //            int tdcID = bankName.back() - '0';
 //            tdcReading[tdcID] = false;
@@ -232,27 +388,96 @@ void startReadoutThread(v2495& fpga, std::string bankName, uint32_t regAddressLi
 }
 
 /**
- * @brief Write a block of data to a binary file.
+ * @brief Open the binary file of a run for appending.
  *
- * This function appends the given data block to a binary file associated
- * with the current run number. The filename is constructed using the
- * "run_number", "data_path" and "file_prefix" configuration values.
+ * The filename is constructed using the "data_path" and "file_prefix"
+ * configuration values.
  *
- * @param data The block of data to write to the file.
+ * @param runNumber The run number.
+ * @return The file, nullptr if it could not be opened.
  */
-void writeBinFile(const std::vector<uint32_t>& data) {
-
+FILE* openRunFile(int runNumber) {
     std::map<std::string, std::string> config = loadConfig();
-    int runNumber = std::stoi(config["run_number"]);
-    // Get filename as char*
     char* filename = getRunFilename(runNumber, config["daq_path"]+config["data_path"], config["file_prefix"]);
-    // log->info("Starting run {0:d}, saving data to: {1}", runNumber, filename);
 
     FILE* file = fopen(filename, "ab");
-    // fwrite(data.data(), 1, data.size(), file);
-    fwrite(data.data(), sizeof(uint32_t), data.size(), file);
-    fclose(file);
+    if (!file) {
+        Logger::getLogger()->error("Could not open {}", filename);
+    }
     free(filename);
+    return file;
+}
+
+/**
+ * @brief Name of a file next to the binary file of a run.
+ *
+ * @param runNumber The run number.
+ * @param extension Replaces ".bin", e.g. ".summary".
+ */
+std::string runSidecarName(int runNumber, const char* extension) {
+    std::map<std::string, std::string> config = loadConfig();
+    char* filename = getRunFilename(runNumber, config["daq_path"]+config["data_path"], config["file_prefix"]);
+    std::string name(filename);
+    free(filename);
+    name.replace(name.size() - 4, 4, extension);
+    return name;
+}
+
+/**
+ * @brief Makes everything written to the run file durable and records its size.
+ *
+ * After the fdatasync the size of the file and the number of blocks are
+ * written to the .commit file, through a temporary file and a rename so it
+ * is never half written. The data up to this size survives a crash of the
+ * DAQ or of the host, hodo_analysis -r cuts the file back to it.
+ */
+void commitRunFile() {
+    auto log = Logger::getLogger();
+    if (!runFile) return;
+
+    fflush(runFile);
+    if (fdatasync(fileno(runFile)) != 0) {
+        log->error("fdatasync of the run file failed: {}", strerror(errno));
+        return;
+    }
+    long offset = ftell(runFile);
+
+    std::string tmpName = runCommitName + ".tmp";
+    FILE* commit = fopen(tmpName.c_str(), "w");
+    if (!commit) {
+        log->error("Could not write {}", tmpName);
+        return;
+    }
+    fprintf(commit, "offset=%ld\nblocks=%llu\n", offset, static_cast<unsigned long long>(blocksWritten.load()));
+    fflush(commit);
+    fdatasync(fileno(commit));
+    fclose(commit);
+    if (rename(tmpName.c_str(), runCommitName.c_str()) != 0) {
+        log->error("Could not rename {}: {}", tmpName, strerror(errno));
+    }
+
+    uncommittedBytes = 0;
+    lastCommit = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief Write a block of data to the binary file of the current run.
+ *
+ * The file stays open for the whole run, it is flushed after every block so
+ * the live analysis can follow it. It is committed to disk once commit_mb
+ * were written since the last commit.
+ *
+ * @param data The block of data to write to the file.
+ */
+void writeBinFile(const std::vector<uint32_t>& data) {
+    if (!runFile) return;
+    fwrite(data.data(), sizeof(uint32_t), data.size(), runFile);
+    fflush(runFile);
+
+    uncommittedBytes += data.size() * sizeof(uint32_t);
+    if (commitBytes > 0 && uncommittedBytes >= commitBytes) {
+        commitRunFile();
+    }
 }
 
 /**
@@ -267,24 +492,217 @@ void writeBinFile(const std::vector<uint32_t>& data) {
  */
 void fileWriterThread() {
     auto log = Logger::getLogger();
+    ThreadPlacement::apply(ThreadPlacement::Writer);
     while(true) {
         log->debug("fileWriterThread started");
         std::unique_lock<std::mutex> lock(blockQueueMutex);
-        blockQueueCond.wait(lock, [] { return !blockQueue.empty() || stopWriter; });
+        auto ready = [] { return !blockQueue.empty() || stopWriter; };
+        if (commitInterval.count() > 0) {
+            // commit_ms also applies while no blocks arrive
+            auto due = lastCommit + commitInterval;
+            if (!blockQueueCond.wait_until(lock, due, ready)) {
+                lock.unlock();
+                if (uncommittedBytes > 0) commitRunFile();
+                else lastCommit = std::chrono::steady_clock::now();
+                continue;
+            }
+        } else {
+            blockQueueCond.wait(lock, ready);
+        }
 
         if (blockQueue.empty() && stopWriter) {
+            commitRunFile();
             break;
         }
 
         std::vector<uint32_t> binaryData = std::move(blockQueue.front());
         blockQueue.pop();
+        blockQueueBytes -= binaryData.size() * sizeof(uint32_t);
         lock.unlock();
+        blockSpace.notify_one();
+        checkQueueLevel();
+
+        if (binaryData.empty()) {
+            // Switch marker, all blocks of the old run are written
+            commitRunFile();
+            if (runFile) fclose(runFile);
+            runFile = nextRunFile;
+            runCommitName = nextRunCommitName;
+            nextRunFile = nullptr;
+            blocksWritten = 0;
+            bytesWritten = 0;
+            log->debug("File writer switched to run {}", switchRunNumber);
+            continue;
+        }
 
+        blocksWritten++;
+        bytesWritten += binaryData.size() * sizeof(uint32_t);
         writeBinFile(binaryData);  // Function to write data to file
+        if (commitInterval.count() > 0 && std::chrono::steady_clock::now() - lastCommit >= commitInterval) {
+            commitRunFile();
+        }
+    }
+}
+
+
+
+/**
+ * @brief Publish a serialized block to the shared-memory ring.
+ *
+ * The live analysis reads the blocks from there instead of the binary file.
+ * If no reader keeps up, the oldest blocks are overwritten, the DAQ never
+ * waits for a reader.
+ *
+ * @param data The serialized block.
+ * @param id The block ID.
+ */
+void publishBlock(const std::vector<uint32_t>& data, uint32_t id) {
+    if (!shmRing) return;
+    if (!shmRing->publish(data.data(), data.size() * sizeof(uint32_t), id, currentRunNumber)) {
+        Logger::getLogger()->warn("Block {} is larger than the shared-memory ring, not published", id);
+    }
+}
+
+/**
+ * @brief Create the shared-memory ring.
+ *
+ * Uses the config keys "shm_ring_name" (empty disables the ring) and
+ * "shm_ring_size_mb".
+ */
+void initShmRing() {
+    auto log = Logger::getLogger();
+    std::map<std::string, std::string> config = loadConfig();
+
+    std::string name = config.count("shm_ring_name") ? config["shm_ring_name"] : "/hodo_daq_ring";
+    if (name.empty()) {
+        log->info("Shared-memory ring disabled");
+        return;
+    }
+    uint64_t sizeMB = config.count("shm_ring_size_mb") ? std::stoull(config["shm_ring_size_mb"]) : 64;
+
+    shmRing = std::make_unique<ShmRingWriter>(name, sizeMB << 20);
+    if (!shmRing->isOpen()) {
+        log->error("Could not create shared-memory ring {}", name);
+        shmRing.reset();
+        return;
+    }
+    log->info("Publishing blocks to shared-memory ring {} ({} MB)", name, sizeMB);
+}
+
+/**
+ * @brief Starts the dead time accounting of a new run.
+ *
+ * @param triggers trigger_cnt of the FPGA at the run start.
+ * @param gated gated_cnt of the FPGA at the run start.
+ */
+void resetDeadTime(uint32_t triggers, uint32_t gated) {
+    runStart = std::chrono::steady_clock::now().time_since_epoch().count();
+    vme.resetVetoTime();
+    busyTime_us = 0;
+    busyCycles = 0;
+    recordedEvents = 0;
+    scalerTriggers = triggers;
+    scalerGated = gated;
+    triggerBase = triggers;
+    gatedBase = gated;
+    queueHoldBase = vme.vetoHolds();
+    queuePeakBytes = bankQueueBytes + blockQueueBytes;
+}
+
+/**
+ * @brief Time since the start of the current run.
+ */
+std::chrono::steady_clock::duration runTime() {
+    return std::chrono::steady_clock::now().time_since_epoch() - std::chrono::steady_clock::duration(runStart.load());
+}
+
+/**
+ * @brief Creates the LIVE bank with the dead time of the run so far.
+ *
+ * One event with the system time in ns as timestamp and LIVE_WORDS words,
+ * all counted since the run start: run time, veto time and busy time in us
+ * (64 bit, high word first), busy cycles, recorded events, the trigger
+ * and gated counters of the FPGA as of the last scaler readout, and the
+ * number of vetoes because of full queues.
+ *
+ * @return The LIVE bank.
+ */
+DataBank makeLiveBank() {
+    auto now = std::chrono::system_clock::now();
+    uint64_t run_us = std::chrono::duration_cast<std::chrono::microseconds>(runTime()).count();
+    uint64_t veto_us = vme.vetoTime_us();
+    uint64_t busy_us = busyTime_us;
+
+    Event event;
+    event.eventID = 0;
+    event.timestamp = 0;
+    event.timestamp64 = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+    for (uint64_t value : {run_us, veto_us, busy_us}) {
+        event.data.push_back(static_cast<uint32_t>(value >> 32));
+        event.data.push_back(static_cast<uint32_t>(value & 0xFFFFFFFF));
     }
+    event.data.push_back(busyCycles);
+    event.data.push_back(recordedEvents);
+    event.data.push_back(scalerTriggers - triggerBase);
+    event.data.push_back(scalerGated - gatedBase);
+    event.data.push_back(vme.vetoHolds() - queueHoldBase);
+
+    DataBank live("LIVE");
+    live.addEvent(event);
+    return live;
 }
 
+/**
+ * @brief Logs the dead time of a run and writes it next to the binary file.
+ *
+ * The summary <file_prefix><run>.summary holds key=value lines with the run
+ * time, the veto and busy times, the live fraction and the trigger counts.
+ *
+ * @param runNumber The run that just ended.
+ */
+void writeRunSummary(int runNumber) {
+    auto log = Logger::getLogger();
+
+    double run_s = std::chrono::duration<double>(runTime()).count();
+    double veto_s = vme.vetoTime_us() * 1e-6;
+    double busy_s = busyTime_us * 1e-6;
+    uint32_t triggers = scalerTriggers - triggerBase;
+    uint32_t gated = scalerGated - gatedBase;
+    uint32_t recorded = recordedEvents;
+    double live = run_s > 0 ? 1. - veto_s / run_s : 0.;
+    double recordedFraction = triggers > 0 ? static_cast<double>(recorded) / triggers : 0.;
+
+    log->info("Run {0:d}: {1:.1f} s, {2:.3f} s under veto, {3:.3f} s busy in {4:d} readouts, live {5:.2f}%",
+              runNumber, run_s, veto_s, busy_s, (uint32_t)busyCycles, 100. * live);
+    log->info("Run {0:d}: {1:d} triggers, {2:d} gated, {3:d} recorded ({4:.2f}%)",
+              runNumber, triggers, gated, recorded, 100. * recordedFraction);
+    if (vme.vetoHolds() != queueHoldBase) {
+        log->warn("Run {0:d}: {1:d} vetoes because of full queues, peak {2:.1f} MB",
+                  runNumber, vme.vetoHolds() - queueHoldBase, queuePeakBytes / 1048576.);
+    }
+
+    std::string summaryName = runSidecarName(runNumber, ".summary");
 
+    std::ofstream summary(summaryName);
+    if (!summary) {
+        log->error("Could not write {}", summaryName);
+        return;
+    }
+    summary << std::fixed << std::setprecision(6)
+            << "run_number=" << runNumber << "\n"
+            << "run_time_s=" << run_s << "\n"
+            << "veto_time_s=" << veto_s << "\n"
+            << "busy_time_s=" << busy_s << "\n"
+            << "busy_cycles=" << busyCycles << "\n"
+            << "live_fraction=" << live << "\n"
+            << "triggers=" << triggers << "\n"
+            << "gated=" << gated << "\n"
+            << "recorded=" << recorded << "\n"
+            << "recorded_fraction=" << recordedFraction << "\n"
+            << "queue_vetoes=" << vme.vetoHolds() - queueHoldBase << "\n"
+            << "queue_peak_mb=" << queuePeakBytes / 1048576. << "\n"
+            << "threads=" << ThreadPlacement::report() << "\n";
+}
 
 /**
  * @brief Processes events from the bank queue and prepares them for writing.
@@ -295,16 +713,22 @@ void fileWriterThread() {
  * and serializes the block for writing. The serialized block is then
  * added to the block queue for further processing.
  * 
+ * When switch_run requests a switch, the block with the banks read out until
+ * then is the last one of the old run. It is followed by the switch marker
+ * for the file writer, the next block belongs to the new run.
+ *
  * The function will terminate once the readout is stopped by setting
  * `stopReadout` to true.
  */
 
   void processEvents() {
+    ThreadPlacement::apply(ThreadPlacement::Processing);
+    // Read once per run, not for every block
+    const std::string cuspFileName = loadConfig()["daq_path"] + "CUSP/Hodo.txt";
     while(!stopReadout) {
 
         Block block(blockID);
-        std::map<std::string, std::string> config = loadConfig();
-        
+
 
         DataBank CUSP("CUSP");        // Adding the current s timestamp to the CUSP bank
         auto now = std::chrono::system_clock::now();
@@ -314,7 +738,7 @@ void fileWriterThread() {
         // Setting the 63rd bit to 1 as a flag to check if 32 or 64 bit times are used:
         now_ns |= (1ULL << 63);
 
-        std::ifstream cuspFile(config["daq_path"]+"CUSP/Hodo.txt");
+        std::ifstream cuspFile(cuspFileName);
         if (cuspFile) {
             int cuspValue;
             cuspFile >> cuspValue;
@@ -326,6 +750,7 @@ void fileWriterThread() {
             eventCUSPrun.data.clear();
         }
         block.addDataBank(CUSP);
+        block.addDataBank(makeLiveBank());
 
 /*         DataBank GATE("GATE");
         fpgas[0]->readList(GATE, SCI_REG_mixGate_FIFOADDRESS, SCI_REG_mixGate_STATUS); 
@@ -336,32 +761,82 @@ void fileWriterThread() {
         block.addDataBank(DUMP); */
 
         std::unique_lock<std::mutex> lock(bankQueueMutex);
-        dataAvailable.wait(lock, [] {return !bankQueue.empty() || stopReadout; });
+        dataAvailable.wait(lock, [] {return !bankQueue.empty() || stopReadout || switchPending; });
 
         if (bankQueue.empty() && stopReadout) break;
+        bool switching = switchPending;
+        std::vector<DataBank> tdcBanks;
 
         while (!bankQueue.empty()) {
-            DataBank dataBank = std::move(bankQueue.front());
-            bankQueue.pop();
-            block.addDataBank(dataBank);
+            DataBank dataBank = popBank();
+            if (strncmp(dataBank.bankName, "GATE", 4) == 0) {
+                recordedEvents += dataBank.getEvents().size();
+            }
+            eventIdChecker.check(dataBank);
+            if (onlineFilter.enabled() && strncmp(dataBank.bankName, "TDC", 3) == 0) {
+                tdcBanks.push_back(std::move(dataBank));
+            } else {
+                block.addDataBank(dataBank);
+            }
 
         }
 
         lock.unlock();
 
+        eventIdChecker.endBlock(blockID);
 
-        std::vector<uint32_t> binaryData = block.serialize();
-        {
-            std::lock_guard<std::mutex> blockLock(blockQueueMutex);
-            blockQueue.push(std::move(binaryData));
+        if (onlineFilter.enabled()) {
+            // events still missing fragments wait for the next block, unless the run ends here
+            for (auto& bank : onlineFilter.process(tdcBanks, switching)) {
+                block.addDataBank(bank);
+            }
         }
-        blockQueueCond.notify_one();
+
+
+        std::vector<uint32_t> binaryData = block.serialize();
+        publishBlock(binaryData, blockID);
+        queueBlock(std::move(binaryData), true);
 
         blockID++;
 
+        if (switching) {
+            {
+                std::lock_guard<std::mutex> blockLock(blockQueueMutex);
+                blockQueue.push({});    // switch marker
+            }
+            blockQueueCond.notify_one();
+
+            blockID = 0;
+            currentRunNumber = switchRunNumber;
+            {
+                std::lock_guard<std::mutex> switchLock(bankQueueMutex);
+                switchPending = false;
+            }
+            switchDone.notify_all();
+        }
+
   }
 }
 
+/**
+ * @brief Reads the FPGA counters once and queues them as SCLR bank.
+ *
+ * Called by the polling thread every scaler_interval_ms and by forceReadout,
+ * so every run ends with the final counter values.
+ */
+void readScalers() {
+    lastScalerRead = std::chrono::steady_clock::now();
+
+    DataBank scalers("SCLR");
+    if (fpgas[0]->readScalers(scalers) > 0) {
+        const std::vector<uint32_t>& counters = scalers.getEvents().back().data;
+        scalerTriggers = counters[SCALER_TRIGGER_IDX];
+        scalerGated = counters[SCALER_GATED_IDX];
+
+        queueBank(std::move(scalers));
+    }
+}
+
 /**
  * @brief Monitors the TDCs and initiates readout when almost full.
  *
@@ -376,18 +851,30 @@ void fileWriterThread() {
 void polling() {
     auto log = Logger::getLogger();
     log->debug("Polling thread started");
+    ThreadPlacement::apply(ThreadPlacement::Polling);
 
     try {
         bool isfull = false;
 
         while (!stopReadout) {
+            if (holdReadout) {
+                // switch_run reads out the modules itself
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            std::lock_guard<std::mutex> readoutLock(readoutMutex);
             isfull = false;
 
+            if (scalerInterval.count() > 0 && std::chrono::steady_clock::now() - lastScalerRead >= scalerInterval) {
+                readScalers();
+            }
+
             for (auto tdc : tdcs) {
                 isfull |= tdc->almostFull();
             }
 
             if (isfull) {
+                auto busyStart = std::chrono::steady_clock::now();
 
                 for (int i = 0; i < NUM_TDCS; i++){
                     if (!tdcReading[i]) {
@@ -411,6 +898,9 @@ void polling() {
                 }
                 readoutThreads.clear();
                 readoutThreads.resize(NUM_TDCS);
+
+                busyTime_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - busyStart).count();
+                busyCycles++;
                 
             }
 
@@ -427,6 +917,35 @@ void polling() {
 
 
 
+/**
+ * @brief Reads out all TDCs, the GATE lists and the scalers once and queues the banks.
+ *
+ * Used at the end of a run and at a run switch to get the data that is still
+ * in the modules. The polling thread must not read out at the same time.
+ */
+void forceReadout() {
+    for (int i = 0; i < NUM_TDCS; i++) {
+        DataBank lastBank(("TDC" + std::to_string(i)).c_str());
+        unsigned int wordsRead = tdcs[i]->BLTRead(lastBank);
+
+        if (wordsRead > 0) {
+            queueBank(std::move(lastBank));
+        }
+    }
+
+    DataBank lastGATE("GATE");
+    // unsigned int wordsRead = fpgas[0]->readList(lastGATE, SCI_REG_Gate_FIFOADDRESS, SCI_REG_Gate_STATUS);
+    unsigned int wordsRead = fpgas[0]->readTwoLists(lastGATE, SCI_REG_Gate_FIFOADDRESS, SCI_REG_Gate_STATUS, SCI_REG_TimeTag_FIFOADDRESS, SCI_REG_TimeTag_STATUS);
+
+    if (wordsRead > 0) {
+        queueBank(std::move(lastGATE));
+    }
+
+    if (scalerInterval.count() > 0) {
+        readScalers();
+    }
+}
+
 /**
  * @brief Starts a new run by initializing the TDCs and starting the polling thread.
  *
@@ -450,6 +969,7 @@ bool start_run() {
     int runNumber = std::stoi(config["run_number"]) +1;
     config["run_number"] = std::to_string(runNumber);
     saveConfig(config);  // Save updated run number
+    currentRunNumber = runNumber;
 
   // Get filename as char*
     // char* filename = getRunFilename(runNumber, config["data_path"], config["file_prefix"]);
@@ -464,6 +984,34 @@ bool start_run() {
     }
 
     blockID = 0;
+    blocksWritten = 0;
+    bytesWritten = 0;
+
+    eventIdChecker.reset(config.count("event_id_tolerance") ? std::stoll(config["event_id_tolerance"]) : 128);
+    onlineFilter.configure(config);
+    ThreadPlacement::configure(config);
+
+    queueHighBytes = (config.count("queue_high_mb") ? std::stoull(config["queue_high_mb"]) : 256) << 20;
+    queueLowBytes = (config.count("queue_low_mb") ? std::stoull(config["queue_low_mb"]) : 128) << 20;
+    queueMaxBytes = (config.count("queue_max_mb") ? std::stoull(config["queue_max_mb"]) : 512) << 20;
+    if (queueLowBytes > queueHighBytes) {
+        log->warn("queue_low_mb is above queue_high_mb, using queue_high_mb / 2");
+        queueLowBytes = queueHighBytes / 2;
+    }
+
+    scalerInterval = std::chrono::milliseconds(config.count("scaler_interval_ms") ? std::stoi(config["scaler_interval_ms"]) : 1000);
+    lastScalerRead = std::chrono::steady_clock::time_point();     // first readout right at the start
+
+    commitBytes = (config.count("commit_mb") ? std::stoull(config["commit_mb"]) : 16) << 20;
+    commitInterval = std::chrono::milliseconds(config.count("commit_ms") ? std::stoi(config["commit_ms"]) : 1000);
+
+    runFile = openRunFile(runNumber);
+    if (!runFile) {
+        return false;
+    }
+    runCommitName = runSidecarName(runNumber, ".commit");
+    uncommittedBytes = 0;
+    lastCommit = std::chrono::steady_clock::now();
 
     for (auto fpga : fpgas) {
         log->debug("Resetting Event Counter on FPGA");
@@ -492,6 +1040,7 @@ bool start_run() {
         return false;  // Thread creation failed
     }
 
+    resetDeadTime(0, 0);    // the FPGA counters were reset above
     vme.stopVeto();
     log->info("Data acquisition started!");
 
@@ -523,6 +1072,7 @@ void stop_run() {
         stopReadout = true;
         dataAvailable.notify_all();
         blockQueueCond.notify_all();
+        blockSpace.notify_all();
 
         if (pollingThread.joinable()) {
             pollingThread.join();  // Wait for polling thread to finish
@@ -539,30 +1089,10 @@ void stop_run() {
         readoutThreads.clear();
 
         log->debug("Forcing final readout of TDCs");
+        forceReadout();
 
-        for (int i = 0; i < NUM_TDCS; i++) {
-            DataBank lastBank(("TDC" + std::to_string(i)).c_str());
-            unsigned int wordsRead = tdcs[i]->BLTRead(lastBank);
-
-            if (wordsRead > 0) {
-                std::lock_guard<std::mutex> lock(bankQueueMutex);
-                bankQueue.push(std::move(lastBank));
-                dataAvailable.notify_one();
-            }
-        }
-
-        DataBank lastGATE("GATE");
-        // unsigned int wordsRead = fpgas[0]->readList(lastGATE, SCI_REG_Gate_FIFOADDRESS, SCI_REG_Gate_STATUS);
-        unsigned int wordsRead = fpgas[0]->readTwoLists(lastGATE, SCI_REG_Gate_FIFOADDRESS, SCI_REG_Gate_STATUS, SCI_REG_TimeTag_FIFOADDRESS, SCI_REG_TimeTag_STATUS);
-
-
-        if (wordsRead > 0) {
-            std::lock_guard<std::mutex> lock(bankQueueMutex);
-            bankQueue.push(std::move(lastGATE));
-            dataAvailable.notify_one();
-        }
-
-        if (!bankQueue.empty()) {
+        // Events of the online filter still waiting for fragments are written with the last block
+        if (!bankQueue.empty() || onlineFilter.hasPending()) {
 
             log->debug("Flushing remaining data...");
 
@@ -586,6 +1116,7 @@ void stop_run() {
                 CUSP.addEvent(eventCUSPrun);
             }
             finalBlock.addDataBank(CUSP);
+            finalBlock.addDataBank(makeLiveBank());
 
 /*            DataBank GATE("GATE");
             fpgas[0]->readMixList(GATE, SCI_REG_mixGate_FIFOADDRESS); 
@@ -596,36 +1127,55 @@ void stop_run() {
             finalBlock.addDataBank(DUMP);
 */
 
+            std::vector<DataBank> tdcBanks;
             std::unique_lock<std::mutex> lock(bankQueueMutex);
             while (!bankQueue.empty()) {
-                DataBank dataBank = std::move(bankQueue.front());
-                bankQueue.pop();
+                DataBank dataBank = popBank();
                 lock.unlock();
 
-                finalBlock.addDataBank(dataBank);
+                if (strncmp(dataBank.bankName, "GATE", 4) == 0) {
+                    recordedEvents += dataBank.getEvents().size();
+                }
+                eventIdChecker.check(dataBank);
+                if (onlineFilter.enabled() && strncmp(dataBank.bankName, "TDC", 3) == 0) {
+                    tdcBanks.push_back(std::move(dataBank));
+                } else {
+                    finalBlock.addDataBank(dataBank);
+                }
                 lock.lock();
             }
             lock.unlock();
 
+            eventIdChecker.endBlock(blockID);
 
+            if (onlineFilter.enabled()) {
+                for (auto& bank : onlineFilter.process(tdcBanks, true)) {
+                    finalBlock.addDataBank(bank);
+                }
+            }
 
             // Serialize and push to file writer queue
             std::vector<uint32_t> binaryData = finalBlock.serialize();
-            {
-                std::lock_guard<std::mutex> blockLock(blockQueueMutex);
-                blockQueue.push(std::move(binaryData));
-            }
-            blockQueueCond.notify_one();
+            publishBlock(binaryData, blockID);
+            queueBlock(std::move(binaryData), false);
 
             blockID++; // Increment block ID
         }
+        if (onlineFilter.enabled()) {
+            log->info("Online filter: {:d} events accepted, {:d} rejected", onlineFilter.acceptedEvents(), onlineFilter.rejectedEvents());
+        }
 
         stopWriter = true;
         blockQueueCond.notify_all();
         if (fileWriter.joinable()) {
             fileWriter.join();
         }
+        if (runFile) {
+            fclose(runFile);
+            runFile = nullptr;
+        }
 
+        writeRunSummary(currentRunNumber);
         
         log->info("Data acquisition stopped");
 
@@ -637,6 +1187,117 @@ void stop_run() {
 
 }
 
+/**
+ * @brief Clears the event counters of all modules as start_run does.
+ *
+ * The TDCs are soft-cleared and the FPGA counter and its gate and time tag
+ * lists are reset, so the next event is number 0 on all modules. Only call
+ * it under the veto with the readout held.
+ *
+ * @return false if a module could not be reset.
+ */
+bool restartCounters() {
+    auto log = Logger::getLogger();
+    bool ok = true;
+
+    for (auto tdc : tdcs) {
+        if (!tdc->start()) {
+            log->error("Failed to clear TDC!");
+            ok = false;
+        }
+    }
+    for (auto fpga : fpgas) {
+        if (fpga->resetCounter() != 0) {
+            log->error("Failed to reset counter on FPGA");
+            ok = false;
+        }
+        if (fpga->startGateList() != 0) {
+            log->error("Failed to restart mixGate List on FPGA!");
+            ok = false;
+        }
+        if (fpga->startTimeList() != 0) {
+            log->error("Failed to restart time tag List on FPGA!");
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief Ends the current run and starts the next one without stopping the DAQ.
+ *
+ * The modules, the threads and the file writer keep running. The run number
+ * is saved and the next file is opened before the veto is set, so only the
+ * readout of the modules, the last block of the old run and the reset of the
+ * event counters fall into the dead time. The file writer changes the file
+ * at the switch marker in the block queue, so the old file gets exactly the
+ * blocks before the switch. The new run counts its events from 0 as after
+ * start_run.
+ *
+ * @return true if the run was switched, false otherwise.
+ */
+bool switch_run() {
+    auto log = Logger::getLogger();
+
+    if (!is_running) {
+        log->error("Nothing is running, so it can't be switched.");
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t oldRunNumber = currentRunNumber;
+
+    std::map<std::string, std::string> config = loadConfig();
+    int runNumber = std::stoi(config["run_number"]) +1;
+    nextRunFile = openRunFile(runNumber);
+    if (!nextRunFile) {
+        return false;
+    }
+    nextRunCommitName = runSidecarName(runNumber, ".commit");
+    config["run_number"] = std::to_string(runNumber);
+    saveConfig(config);  // Save updated run number
+
+    vme.startVeto();
+    auto vetoStart = std::chrono::steady_clock::now();
+
+    holdReadout = true;
+    {
+        std::lock_guard<std::mutex> readoutLock(readoutMutex);
+
+        // Everything triggered before the veto belongs to the old run
+        forceReadout();
+
+        {
+            std::unique_lock<std::mutex> lock(bankQueueMutex);
+            switchRunNumber = runNumber;
+            switchPending = true;
+            dataAvailable.notify_all();
+            switchDone.wait(lock, [] { return !switchPending; });
+        }
+
+        // forceReadout read the counters at the end of the old run
+        writeRunSummary(oldRunNumber);
+
+        // The new run starts counting events from 0 like after start_run, so
+        // the TDC and GATE event IDs of its file match again
+        if (!restartCounters()) {
+            log->error("Could not reset the event counters, the event IDs of run {0:d} will not match", runNumber);
+        }
+        // No banks are queued until the readout is released, the processing thread does not use the checker meanwhile
+        eventIdChecker.reset(config.count("event_id_tolerance") ? std::stoll(config["event_id_tolerance"]) : 128);
+        resetDeadTime(0, 0);
+    }
+    holdReadout = false;
+
+    vme.stopVeto();
+    auto end = std::chrono::steady_clock::now();
+
+    log->info("Switched to run {0:d}, {1:.1f} ms under veto, {2:.1f} ms in total", runNumber,
+              std::chrono::duration<double, std::milli>(end - vetoStart).count(),
+              std::chrono::duration<double, std::milli>(end - start).count());
+    return true;
+}
+
 /**
  * @brief Pauses the data acquisition.
  *
@@ -687,10 +1348,21 @@ int daq_exit() {
     return 0;
 }
 
+/**
+ * @brief Connects to the VME crate and initialises all TDCs and FPGAs.
+ *
+ * The modules are independent of each other, so every module is set up on
+ * its own thread and the total time is that of the slowest module instead of
+ * the sum. The time of every stage is logged. With warm_restart=1 in the
+ * config, TDCs which are still set up are not reset and programmed again.
+ *
+ * @return true if all modules are online.
+ */
 bool hardware_inits() {
 
     auto log = Logger::getLogger();
     bool success = true;
+    StageTimer timer("Hardware init");
     log->debug("Starting VME initialization...");
     if (handle == -1) {
         vme.init();
@@ -700,18 +1372,42 @@ bool hardware_inits() {
         vme.startVeto();
 
     }
+    timer.stage("VME");
 
 
     // Connect to all TDCs:
     for(int i=0; i<NUM_TDCS; i++){
+        delete tdcs[i];
         tdcs[i] = new v1190(TDCbaseAddresses[i], handle);
     }
 
+    for(int i=0; i<NUM_FPGAS; i++){
+        delete fpgas[i];
+        fpgas[i] = new v2495((char*)FPGAbaseAddress, handle);
+    }
+
+    // TDCs that still hold the same settings are not set up again
+    std::map<std::string, std::string> config = loadConfig();
+    bool warm = !config.count("warm_restart") || config["warm_restart"] != "0";
+
+    // every thread writes only its own status entry
+    std::vector<std::thread> initThreads;
     for(int i=0; i<NUM_TDCS; i++){
-        V1190Status[i] = true;
-        // V1190Status[i] = tdcs[i]->checkModuleResponse(); // this is already called in the init function
-        V1190Status[i] &= tdcs[i]->init(i);
+        initThreads.emplace_back([i, warm]() {
+            V1190Status[i] = tdcs[i]->init(i, warm);
+        });
+    }
+    for(int i=0; i<NUM_FPGAS; i++){
+        initThreads.emplace_back([i]() {
+            StageTimer fpgaTimer(fmt::format("FPGA {:d} init", i));
+            V2495Status[i] = fpgas[i]->init(i); // Opens connection
+            fpgaTimer.done();
+        });
+    }
+    for (auto& t : initThreads) t.join();
+    timer.stage("modules");
 
+    for(int i=0; i<NUM_TDCS; i++){
         if (V1190Status[i]) {
             log->info("V1190 module {0:d} is online", i);
         } else {
@@ -720,24 +1416,16 @@ bool hardware_inits() {
         }
     }
 
-
-
-    for(int i=0; i<NUM_FPGAS; i++){
-        fpgas[i] = new v2495((char*)FPGAbaseAddress, handle);
-    }
-
     for(int i=0; i<NUM_FPGAS; i++){
-        V2495Status[i] = fpgas[i]->init(i); // Opens connection
-
         if (V2495Status[i] == 0) {
             log->info("V2495 module {0:d} is online", i);
         } else {
           log->info("V2495 module {0:d} is NOT online!", i);
           success = false;
         }
-
     }
 
+    timer.done();
     return success;
 }
 
@@ -759,6 +1447,12 @@ int main() {
     log->info("Hiya!");
     log->debug("Oy!");
 
+    std::map<std::string, std::string> config = loadConfig();
+
+    // before any thread is started, so all of them are placed and locked
+    ThreadPlacement::configure(config);
+    ThreadPlacement::lockMemory(config);
+
     TCPServer server(12345);  // Choose a port
     server.start();
 
@@ -771,7 +1465,7 @@ int main() {
 
     all_init = true;
 
-    std::map<std::string, std::string> config = loadConfig();
+    initShmRing();
 
     int runNumber = std::stoi(config["run_number"]);
     log->info("Current run number: {0:d}", runNumber);
@@ -0,0 +1,54 @@
+#ifndef EVENT_ID_CHECKER_HH
+#define EVENT_ID_CHECKER_HH
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dataBanks.hh"
+
+// Checks the event IDs of the TDCs and the GATE list while the data is taken,
+// so a desynchronisation is seen during the run and not only by the sorter.
+//
+// Skip:  within the banks of one module the IDs must count up by one (12 bit
+//        TDC IDs, 30 bit GATE IDs), from one bank to the next as well.
+// Drift: every TDC must have sent as many events as the GATE list. The
+//        modules are read out one after the other while triggers go on, so
+//        the counts may differ by up to the tolerance.
+//
+// check() and endBlock() are called by the processing thread, status() by
+// the TCP server.
+class EventIdChecker {
+public:
+    enum class State { Ok, Skip, Drift };
+
+    EventIdChecker(int nTdcs);
+
+    void reset(int64_t tolerance);          // at the run start
+    void check(const DataBank& bank);       // every bank of a block
+    State endBlock(uint32_t blockID);
+
+    std::string status() const;             // "evid=ok evid_skips=0 evid_drift=0"
+
+private:
+    struct Source {
+        std::string name;
+        uint32_t mask;
+        bool seen = false;
+        uint32_t last = 0;
+        int64_t events = 0;
+    };
+
+    void checkId(Source& source, uint32_t id);
+
+    std::vector<Source> sources;            // TDC0..TDCn-1, GATE
+    int64_t tolerance = 128;
+    uint64_t skips = 0;                     // events missing or repeated
+    uint64_t blockSkips = 0;
+    int64_t drift = 0;                      // largest count difference TDC - GATE of the last block
+    State state = State::Ok;
+    mutable std::mutex mutex;
+};
+
+#endif  // EVENT_ID_CHECKER_HH
@@ -0,0 +1,75 @@
+#ifndef ONLINE_FILTER_HH
+#define ONLINE_FILTER_HH
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dataBanks.hh"
+
+// Optional pre-selection of the TDC data before it is written, a looser
+// version of the cuts of the DataFilter in the analysis:
+//
+//   online_filter_bars=1      an outer and an inner bar with hits on both ends
+//   online_filter_bgo_min=2   at least this many BGO channels with a hit
+//
+// Hits count regardless of edge and time, so every event accepted by the
+// analysis is accepted here. The fragments of the TDCs are collected by their
+// 12 bit event ID until all TDCs have sent the event, then the event is
+// accepted or rejected as a whole. At most MAX_PENDING events wait for their
+// fragments, and a TDC sending an ID again decides the older event first, so
+// events 4096 IDs apart are never merged. Accepted events are written in full, one in
+// online_filter_prescale rejected events is written as well (0 drops them all).
+// A FILT bank in each block holds the counts and the IDs of the prescaled events.
+class OnlineFilter {
+public:
+    OnlineFilter(int nTdcs);
+
+    void configure(std::map<std::string, std::string>& config);    // and reset, at the run start
+    bool enabled() const { return active; }
+    bool hasPending() const { return !pending.empty(); }
+
+    // Takes the TDC banks of a block and returns the TDC banks of the decided
+    // events and the FILT bank. With flush all events are decided, also those
+    // not complete yet (end of a run).
+    std::vector<DataBank> process(std::vector<DataBank>& tdcBanks, bool flush);
+
+    uint64_t acceptedEvents() const { return accepted; }
+    uint64_t rejectedEvents() const { return rejected; }
+
+private:
+    struct Pending {
+        explicit Pending(uint32_t id) : id(id) {}
+
+        uint32_t id;
+        uint32_t tdcMask = 0;               // TDCs that sent the event
+        uint32_t outerDs = 0, outerUs = 0;  // bars with hits
+        uint32_t innerDs = 0, innerUs = 0;
+        uint64_t bgo = 0;                   // BGO channels with hits
+        int age = 0;                        // blocks since the first fragment
+        std::vector<std::pair<int, Event>> fragments;
+    };
+
+    void addFragment(Pending& event, int tdc, Event&& fragment);
+    bool accept(const Pending& event) const;
+
+    int nTdcs;
+    bool active = false;
+    bool requireBars = true;
+    int bgoMin = 2;
+    uint32_t prescale = 100;
+
+    std::list<Pending> pending;             // in the order of the first fragment
+    std::unordered_map<uint32_t, std::list<Pending>::iterator> byId;
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    uint64_t rejectedSeen = 0;
+
+    static constexpr int MAX_AGE = 4;               // blocks an incomplete event is kept
+    static constexpr size_t MAX_PENDING = 1024;     // well below the 4096 IDs of the TDCs
+};
+
+#endif  // ONLINE_FILTER_HH
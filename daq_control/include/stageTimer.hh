@@ -0,0 +1,47 @@
+#ifndef STAGE_TIMER_HH
+#define STAGE_TIMER_HH
+
+#include <chrono>
+#include <string>
+#include "logger.hh"
+
+// Logs the time spent in consecutive stages of a longer operation, e.g. the
+// initialisation of one module:
+//
+//   StageTimer timer("TDC 0");
+//   ...; timer.stage("reset");
+//   ...; timer.stage("opcodes");
+//   timer.done();              // "TDC 0 took 12.3 ms (reset 1.1 ms, opcodes 11.2 ms)"
+class StageTimer {
+public:
+    explicit StageTimer(std::string name)
+        : name(std::move(name)), start(std::chrono::steady_clock::now()), last(start) {}
+
+    // Ends the current stage and returns its duration in ms.
+    double stage(const char* stageName) {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - last).count();
+        last = now;
+        stages += fmt::format("{}{} {:.1f} ms", stages.empty() ? "" : ", ", stageName, ms);
+        return ms;
+    }
+
+    // Total time since construction in ms.
+    double elapsed() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double done() const {
+        double ms = elapsed();
+        Logger::getLogger()->info("{} took {:.1f} ms ({})", name, ms, stages);
+        return ms;
+    }
+
+private:
+    std::string name;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point last;
+    std::string stages;
+};
+
+#endif  // STAGE_TIMER_HH
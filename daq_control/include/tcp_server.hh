@@ -4,7 +4,30 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <chrono>
+#include <functional>
 
+/*
+ * Control server of the DAQ. Clients keep their connection open and send one
+ * command per line, every command is answered with one line:
+ *
+ *   start, stop,       "OK <cmd>" at once, "DONE <cmd> ok|failed" when finished,
+ *   switch             "BUSY" while another transition is running. switch ends
+ *                      the run and starts the next one without stopping the DAQ
+ *   pause, resume      "OK <cmd>" or "ERROR <reason>"
+ *   status             "STATUS state=... run=... paused=... blocks=... block_rate=... mb=... mb_rate=...
+ *                      evid=ok|skip|drift evid_skips=... evid_drift=..."
+ *   subscribe          "OK subscribe", then a STATUS line every second and on every state change
+ *   unsubscribe, !     "OK <cmd>", ! stops the DAQ
+ *
+ * A single command without newline before the connection is closed is also
+ * accepted, as sent by the old GUI. All sockets are handled by one epoll
+ * thread, start, stop and switch run on their own thread so status requests
+ * are answered while a run is stopped.
+ */
 class TCPServer {
 public:
     TCPServer(int port);
@@ -16,15 +39,59 @@ public:
     bool isRunning() const {
         return running;
     }
-    
+
 
 private:
+    enum class RunState { Idle, Starting, Running, Stopping, Switching };
+
+    struct Client {
+        uint64_t id;
+        std::string in;
+        std::string out;
+        bool subscribed = false;
+    };
+
+    static constexpr uint64_t SUBSCRIBERS = 0;          // notification target: all subscribers
+    static constexpr size_t MAX_LINE = 1024;
+    static constexpr int STATUS_INTERVAL_MS = 1000;
+
     void run();  // Main loop for handling client connections
+    bool listenOn();
+    void acceptClients();
+    void readClient(int fd);
+    void writeClient(int fd);
+    void closeClient(int fd);
+    void handleCommand(int fd, std::string command);
+    void runTransition(int fd, const std::string& name, RunState during, RunState after, std::function<bool()> action);
+    void send(int fd, const std::string& line);
+    void post(uint64_t clientId, const std::string& line);
+    void deliverNotifications();
+    void updateRates();
+    std::string statusLine() const;
 
     int server_fd;
+    int epoll_fd = -1;
+    int wake_fd = -1;
     int port;
     std::thread serverThread;
     std::atomic<bool> running;
+
+    std::map<int, Client> clients;                      // by socket, only used by the server thread
+    uint64_t nextClientId = 1;
+
+    std::atomic<RunState> state{RunState::Idle};
+    std::atomic<bool> paused{false};
+    std::atomic<bool> transitionBusy{false};
+    std::thread transitionThread;
+
+    std::mutex notifyMutex;                             // notifications from the transition thread
+    std::vector<std::pair<uint64_t, std::string>> notifications;
+
+    std::chrono::steady_clock::time_point lastRateUpdate;
+    uint64_t lastBlocks = 0;
+    uint64_t lastBytes = 0;
+    double blockRate = 0;                               // blocks/s
+    double dataRate = 0;                                // MB/s
 };
 
-#endif  // TCP_SERVER_HH
\ No newline at end of file
+#endif  // TCP_SERVER_HH
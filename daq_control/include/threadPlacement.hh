@@ -0,0 +1,55 @@
+#ifndef THREAD_PLACEMENT_HH
+#define THREAD_PLACEMENT_HH
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// CPU pinning and scheduling of the DAQ threads, so the readout does not
+// compete with the GUI or hodo_analysis on the same host. Per role:
+//
+//   cpu_<role>=2,3 or 4-7     CPUs the thread may run on, empty for all
+//   rt_priority_<role>=50     SCHED_FIFO priority 1-99, 0 for the normal scheduler
+//
+// with the roles polling, readout, processing, writer and server, and
+// lock_memory=1 to lock all pages of the process in RAM (mlockall).
+//
+// The polling thread never sleeps while a run is taken, a SCHED_FIFO priority
+// for it should only be used together with a CPU of its own (isolcpus).
+// Real-time priorities and mlockall need CAP_SYS_NICE / CAP_IPC_LOCK or
+// matching limits in /etc/security/limits.conf, if they fail the thread
+// keeps running with the normal settings and the error is logged.
+//
+// Every thread calls apply() with its role when it starts, roles without
+// settings get all CPUs and the normal scheduler. The settings that
+// were actually applied are read back from the kernel and logged once per
+// role and run.
+class ThreadPlacement {
+public:
+    enum Role { Polling, Readout, Processing, Writer, Server, NUM_ROLES };
+
+    static void configure(std::map<std::string, std::string>& config);
+    static void apply(Role role);
+    static void lockMemory(std::map<std::string, std::string>& config);
+
+    static std::string report();            // the applied settings of all roles, for the log
+
+private:
+    struct Settings {
+        std::vector<int> cpus;
+        int priority = 0;
+        std::atomic<bool> reported{false};
+        std::string applied;                // as read back from the kernel
+    };
+
+    static std::vector<int> parseCpus(const std::string& list);
+    static std::string currentSettings();
+
+    static Settings roles[NUM_ROLES];
+    static std::vector<int> processCpus;    // CPUs of the main thread at the first configure()
+    static std::mutex mutex;
+};
+
+#endif  // THREAD_PLACEMENT_HH
@@ -39,6 +39,7 @@ extern "C" {
 #define EV_FIFO      0x1038
 #define EV_FIFO_STOR 0x103C
 #define EV_FIFO_STAT 0x103E
+#define DUMMY32      0x1200
 #define DUMMY        0x1204
 #define CR_BOARDID0  0x403C
 #define CR_BOARDID1  0x4038
@@ -76,6 +77,7 @@ extern "C" {
 
 unsigned short V1190ReadRegister(unsigned short RegAddr, int handle, int BaseAddress);
 void V1190WriteRegister(unsigned short RegAddr, unsigned short RegData, int handle, int BaseAddress);
+int V1190WaitWriteOk(int handle, int BaseAddress);
 int V1190WriteOpcode(int nw, const unsigned short* Data, int handle, int BaseAddress);
 void V1190SoftClear(unsigned short RegData, int handle, int BaseAddress);
 void V1190SoftReset(unsigned short RegData, int handle, int BaseAddress);
@@ -85,6 +87,10 @@ int V1190SetBltEvtNr(unsigned short RegData, int handle, int BaseAddress);
 void V1190SetAlmostFullLevel(unsigned short RegData, int handle, int BaseAddress);
 void V1190WriteDummyValue(unsigned short RegData, int handle, int BaseAddress);
 unsigned short V1190ReadDummyValue(int handle, int BaseAddress);
+void V1190WriteDummy32(unsigned int RegData, int handle, int BaseAddress);
+unsigned int V1190ReadDummy32(int handle, int BaseAddress);
+unsigned short V1190ReadBltEvtNr(int handle, int BaseAddress);
+unsigned short V1190ReadAlmostFullLevel(int handle, int BaseAddress);
 unsigned short V1190ReadFirmwareRevision(int handle, int BaseAddress);
 unsigned short V1190ReadStatusRegister(int handle, int BaseAddress);
 unsigned short V1190DataReady(int handle, int BaseAddress);
@@ -14,8 +14,9 @@ class v1190 {
 public:     
     v1190(int vmeBaseAddress, int handle);
 
-    bool init(int);
+    bool init(int, bool warm = false);
     bool setupV1190(int);
+    bool isConfigured();
     bool checkModuleResponse();
     float getFirmwareRevision();
     bool almostFull();
@@ -28,6 +29,16 @@ public:
 
 private:
 
+struct Opcode {
+    int nw;
+    unsigned short words[2];
+};
+static const Opcode setupOpcodes[];
+static const unsigned short BLT_EVENTS = 0xff;
+static const unsigned short ALMOST_FULL_LEVEL = 512;   // Maximum nr of 32-bit words per BLT
+
+static uint32_t configFingerprint();
+
 int vmeBaseAddress;
 int handle;
 
@@ -53,6 +53,11 @@
 
 
 
+// Counters in the SCLR bank, in the order of v2495::readScalers
+#define SCALER_WORDS 7
+#define SCALER_TRIGGER_IDX 5
+#define SCALER_GATED_IDX 6
+
 #define GATE_EVENT(r)   ((r) & 0x3FFFFFFF)
 #define GATE_BOOL(r)    (((r)>>31) & 0x1)
 #define DUMP_BOOL(r)    (((r)>>30) & 0x1)
@@ -86,6 +91,7 @@ public:
     int readList(DataBank& dataBank, uint32_t regAddressList, uint32_t regAddressStatus);
     int readTwoLists(DataBank& dataBank, uint32_t regAddressListOne, uint32_t regAddressStatusOne, uint32_t regAddressListTwo, uint32_t regAddressStatusTwo);
     int resetCounter();
+    int readScalers(DataBank& dataBank);
     void WriteDummyValue(unsigned short RegData, int handle, int vmeBaseAddress);
     unsigned short ReadDummyValue(int handle, int vmeBaseAddress);
     bool checkModuleResponse();
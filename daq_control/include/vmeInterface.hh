@@ -2,6 +2,9 @@
 #define VME_INTERFACE_HH
 
 #include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include "logger.hh"
 
 #define VME_STATUS      0x00
@@ -48,9 +51,26 @@ public:
 
     int setupVeto();
     int startVeto();
-    int stopVeto();
+    int stopVeto();                 // the veto stays on while holdVeto() holds it
+    int holdVeto(bool hold);        // back-pressure of the DAQ, independent of start/stopVeto
+    uint32_t vetoHolds() const { return holds; }
+
+    uint64_t vetoTime_us();         // time under veto since resetVetoTime(), including the current veto
+    void resetVetoTime();
 
 private:
+    void vetoChanged(bool on);
+
+    std::mutex holdMutex;           // who wants the veto
+    bool controlVeto = false;
+    bool held = false;
+    std::atomic<uint32_t> holds{0};
+
+    std::mutex vetoMutex;
+    bool vetoOn = false;
+    std::chrono::steady_clock::time_point vetoSince;
+    uint64_t vetoTotal_us = 0;
+
     int handle = -1;
     uint32_t vmeBaseAddress;
     char* vmeIPAddress;
@@ -0,0 +1,118 @@
+#include "eventIdChecker.hh"
+#include "v2495.hh"
+#include "logger.hh"
+
+#include <cstdlib>
+#include <cstring>
+
+EventIdChecker::EventIdChecker(int nTdcs) {
+    for (int i = 0; i < nTdcs; i++) {
+        sources.push_back({"TDC" + std::to_string(i), 0xFFF});
+    }
+    sources.push_back({"GATE", 0x3FFFFFFF});
+}
+
+/**
+ * @brief Forgets all IDs and counts, called at the start of a run.
+ *
+ * @param tolerance Allowed difference of the event counts of a TDC and the GATE list.
+ */
+void EventIdChecker::reset(int64_t tolerance) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& source : sources) {
+        source.seen = false;
+        source.last = 0;
+        source.events = 0;
+    }
+    this->tolerance = tolerance;
+    skips = 0;
+    blockSkips = 0;
+    drift = 0;
+    state = State::Ok;
+}
+
+void EventIdChecker::checkId(Source& source, uint32_t id) {
+    id &= source.mask;
+    if (source.seen) {
+        uint32_t expected = (source.last + 1) & source.mask;
+        if (id != expected) {
+            // a gap counts the missing IDs, a repeated or earlier ID counts once
+            uint32_t gap = (id - expected) & source.mask;
+            uint64_t missing = gap <= source.mask / 2 ? gap : 1;
+            if (blockSkips == 0) {
+                Logger::getLogger()->warn("Event ID skip in {}: {:d} after {:d}", source.name, id, source.last);
+            }
+            blockSkips += missing;
+        }
+    }
+    source.seen = true;
+    source.last = id;
+    source.events++;
+}
+
+/**
+ * @brief Checks the IDs of all events in a TDC or GATE bank, other banks are ignored.
+ */
+void EventIdChecker::check(const DataBank& bank) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (strncmp(bank.bankName, "TDC", 3) == 0) {
+        size_t tdc = bank.bankName[3] - '0';
+        if (tdc >= sources.size() - 1) return;
+        for (const auto& event : bank.getEvents()) {
+            checkId(sources[tdc], event.eventID);
+        }
+    } else if (strncmp(bank.bankName, "GATE", 4) == 0) {
+        for (const auto& event : bank.getEvents()) {
+            if (!event.data.empty()) checkId(sources.back(), GATE_EVENT(event.data[0]));
+        }
+    }
+}
+
+/**
+ * @brief Compares the event counts of the modules after all banks of a block were checked.
+ *
+ * @param blockID The block, for the log.
+ * @return The state of this block.
+ */
+EventIdChecker::State EventIdChecker::endBlock(uint32_t blockID) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto log = Logger::getLogger();
+
+    const Source& gate = sources.back();
+    drift = 0;
+    for (size_t i = 0; i + 1 < sources.size(); i++) {
+        if (!sources[i].seen || !gate.seen) continue;
+        int64_t diff = sources[i].events - gate.events;
+        if (std::llabs(diff) > std::llabs(drift)) drift = diff;
+    }
+
+    State previous = state;
+    if (blockSkips > 0) {
+        state = State::Skip;
+    } else if (std::llabs(drift) > tolerance) {
+        state = State::Drift;
+    } else {
+        state = State::Ok;
+    }
+    skips += blockSkips;
+
+    if (state == State::Skip) {
+        log->error("Block {:d}: {:d} event IDs skipped ({:d} in this run)", blockID, blockSkips, skips);
+    } else if (state == State::Drift && previous != State::Drift) {
+        log->error("Block {:d}: TDC and GATE event counts differ by {:d}", blockID, drift);
+    } else if (state == State::Ok && previous != State::Ok) {
+        log->info("Block {:d}: event IDs in sync again", blockID);
+    }
+    blockSkips = 0;
+
+    return state;
+}
+
+std::string EventIdChecker::status() const {
+    static const char* names[] = { "ok", "skip", "drift" };
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::string("evid=") + names[static_cast<int>(state)]
+        + " evid_skips=" + std::to_string(skips)
+        + " evid_drift=" + std::to_string(drift);
+}
@@ -0,0 +1,151 @@
+#include "onlineFilter.hh"
+#include "channelMap.hh"
+#include "v1190.h"
+#include "logger.hh"
+
+#include <chrono>
+#include <cstring>
+
+OnlineFilter::OnlineFilter(int nTdcs) : nTdcs(nTdcs) {}
+
+/**
+ * @brief Reads the filter settings and forgets all pending events.
+ *
+ * @param config The DAQ config, online_filter=1 enables the filter.
+ */
+void OnlineFilter::configure(std::map<std::string, std::string>& config) {
+    auto log = Logger::getLogger();
+
+    active = config.count("online_filter") && config["online_filter"] == "1";
+    requireBars = !config.count("online_filter_bars") || config["online_filter_bars"] != "0";
+    bgoMin = config.count("online_filter_bgo_min") ? std::stoi(config["online_filter_bgo_min"]) : 2;
+    prescale = config.count("online_filter_prescale") ? std::stoul(config["online_filter_prescale"]) : 100;
+
+    pending.clear();
+    byId.clear();
+    accepted = 0;
+    rejected = 0;
+    rejectedSeen = 0;
+
+    if (active) {
+        log->info("Online filter: bars {}, at least {:d} BGO channels, prescale {:d}", requireBars ? "on" : "off", bgoMin, prescale);
+    }
+}
+
+/**
+ * @brief Adds the hits of one TDC fragment to the pending event.
+ *
+ * Only the channel of the data words is looked at, no edges or times.
+ */
+void OnlineFilter::addFragment(Pending& event, int tdc, Event&& fragment) {
+    event.tdcMask |= 1u << tdc;
+
+    for (uint32_t word : fragment.data) {
+        if (!IS_TDC_DATA(word)) continue;
+        int ch = mapChannel(DATA_CH(word) + tdc * 128);
+
+        if (ch <= -1 && ch > -50)        event.innerDs |= 1u << (-ch % 32);
+        else if (ch <= -50 && ch > -90)  event.innerUs |= 1u << ((-ch - 50) % 32);
+        else if (ch >= 1 && ch < 50)     event.outerDs |= 1u << (ch % 32);
+        else if (ch >= 50 && ch < 90)    event.outerUs |= 1u << ((ch - 50) % 32);
+        else if (ch >= 300 && ch < 364)  event.bgo |= 1ull << (ch - 300);
+    }
+
+    event.fragments.emplace_back(tdc, std::move(fragment));
+}
+
+bool OnlineFilter::accept(const Pending& event) const {
+    if (requireBars && (!(event.outerDs & event.outerUs) || !(event.innerDs & event.innerUs))) return false;
+    return __builtin_popcountll(event.bgo) >= bgoMin;
+}
+
+std::vector<DataBank> OnlineFilter::process(std::vector<DataBank>& tdcBanks, bool flush) {
+
+    std::vector<DataBank> out;
+    for (int i = 0; i < nTdcs; i++) {
+        out.emplace_back(("TDC" + std::to_string(i)).c_str());
+    }
+
+    uint32_t blockAccepted = 0, blockRejected = 0;
+    std::vector<uint32_t> prescaledIds;
+    const uint32_t allTdcs = (1u << nTdcs) - 1;
+
+    // decided in the order of arrival, so the IDs in every bank keep counting up
+    auto decideFront = [&]() {
+        Pending& event = pending.front();
+        bool keep = accept(event);
+        if (keep) {
+            blockAccepted++;
+        } else {
+            blockRejected++;
+            if (prescale > 0 && rejectedSeen++ % prescale == 0) {
+                keep = true;
+                prescaledIds.push_back(event.id);
+            }
+        }
+
+        if (keep) {
+            for (auto& [tdc, fragment] : event.fragments) {
+                out[tdc].addEvent(fragment);
+            }
+        }
+
+        byId.erase(event.id);
+        pending.pop_front();
+    };
+
+    for (auto& bank : tdcBanks) {
+        int tdc = bank.bankName[3] - '0';
+        if (tdc < 0 || tdc >= nTdcs) continue;
+
+        for (const auto& constFragment : bank.getEvents()) {
+            Event fragment = constFragment;
+            uint32_t id = fragment.eventID & 0xFFF;
+            auto it = byId.find(id);
+
+            // A second fragment of this TDC with the same 12 bit ID belongs to
+            // the event 4096 IDs later, the older one is decided first
+            if (it != byId.end() && (it->second->tdcMask & (1u << tdc))) {
+                while (byId.count(id)) decideFront();
+                it = byId.end();
+            }
+            if (it == byId.end()) {
+                while (pending.size() >= MAX_PENDING) decideFront();
+                pending.push_back(Pending(id));
+                it = byId.emplace(id, std::prev(pending.end())).first;
+            }
+            addFragment(*it->second, tdc, std::move(fragment));
+        }
+    }
+
+    while (!pending.empty()) {
+        const Pending& event = pending.front();
+        bool complete = event.tdcMask == allTdcs;
+        if (!complete && !flush && event.age < MAX_AGE) break;
+        decideFront();
+    }
+    for (auto& event : pending) event.age++;
+
+    accepted += blockAccepted;
+    rejected += blockRejected;
+
+    // drop empty TDC banks
+    std::vector<DataBank> banks;
+    for (auto& bank : out) {
+        if (!bank.getEvents().empty()) banks.push_back(std::move(bank));
+    }
+
+    Event counts;
+    counts.eventID = 0;
+    counts.timestamp = 0;
+    counts.timestamp64 = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    counts.data = {blockAccepted, blockRejected, static_cast<uint32_t>(prescaledIds.size())};
+    counts.data.insert(counts.data.end(), prescaledIds.begin(), prescaledIds.end());
+
+    DataBank filt("FILT");
+    filt.addEvent(counts);
+    banks.push_back(std::move(filt));
+
+    return banks;
+}
@@ -1,18 +1,32 @@
 #include "tcp_server.hh"
 #include "logger.hh"
+#include "eventIdChecker.hh"
+#include "threadPlacement.hh"
 
 #include <iostream>
+#include <sstream>
+#include <iomanip>
 #include <cstring>
+#include <algorithm>
+#include <cerrno>
 #include <unistd.h>
+#include <fcntl.h>
 #include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 
 extern bool start_run();
 extern void stop_run();
+extern bool switch_run();
 extern bool pause_run();
 extern bool resume_run();
 extern int daq_exit();
 extern bool all_init;
+extern std::atomic<uint32_t> currentRunNumber;
+extern std::atomic<uint64_t> blocksWritten;
+extern std::atomic<uint64_t> bytesWritten;
+extern EventIdChecker eventIdChecker;
 
 TCPServer::TCPServer(int port) : port(port), server_fd(-1), running(false) {}
 
@@ -31,11 +45,33 @@ void TCPServer::stop() {
     log->debug("TCPServer::stop() was called");
 
     running = false;
+    if (wake_fd != -1) {
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) == -1) {
+            log->warn("Could not wake up the TCP server");
+        }
+    }
     if (serverThread.joinable()) {
         serverThread.join();
     }
+    if (transitionThread.joinable()) {
+        transitionThread.join();
+    }
+    for (auto& [fd, client] : clients) {
+        close(fd);
+    }
+    clients.clear();
     if (server_fd != -1) {
         close(server_fd);
+        server_fd = -1;
+    }
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+    if (wake_fd != -1) {
+        close(wake_fd);
+        wake_fd = -1;
     }
 }
 
@@ -44,89 +80,358 @@ void trim(std::string &str) {
     str.erase(0, str.find_first_not_of(" \t\r\n"));
 }
 
-void TCPServer::run() {
+static bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
 
+bool TCPServer::listenOn() {
     auto log = Logger::getLogger();
-    log->info("Starting TCP server on port {}", port);
 
-    struct sockaddr_in server_addr, client_addr;
-    socklen_t client_len = sizeof(client_addr);
-    
+    struct sockaddr_in server_addr;
+
     server_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (server_fd == -1) {
         log->error("Failed to create socket");
-        return;
+        return false;
     }
 
+    int reuse = 1;
+    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
     server_addr.sin_port = htons(port);
 
     if (bind(server_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
         log->error("Bind failed");
-        return;
+        return false;
     }
 
-    if (listen(server_fd, 5) < 0) {
+    if (listen(server_fd, 16) < 0 || !setNonBlocking(server_fd)) {
         log->error("Listen failed");
+        return false;
+    }
+
+    epoll_fd = epoll_create1(0);
+    wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (epoll_fd == -1 || wake_fd == -1) {
+        log->error("Failed to create epoll instance: {}", strerror(errno));
+        return false;
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = server_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &ev);
+    ev.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+    return true;
+}
+
+/**
+ * @brief Main loop of the server thread.
+ *
+ * Waits on all sockets with epoll. Besides the client sockets an eventfd
+ * wakes the loop when the transition thread has a notification, and the
+ * timeout sends the periodic STATUS line to the subscribers.
+ */
+void TCPServer::run() {
+
+    auto log = Logger::getLogger();
+    log->info("Starting TCP server on port {}", port);
+    ThreadPlacement::apply(ThreadPlacement::Server);
+
+    if (!listenOn()) {
+        running = false;
         return;
     }
 
     log->info("TCP server listening on port {}", port);
 
+    lastRateUpdate = std::chrono::steady_clock::now();
+    auto nextStatus = lastRateUpdate + std::chrono::milliseconds(STATUS_INTERVAL_MS);
+    struct epoll_event events[32];
+
     while (running) {
-        int client_fd = accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
-        if (client_fd < 0) {
-            log->warn("Client connection failed");
-            continue;
+        int timeout = std::max<int>(0, std::chrono::duration_cast<std::chrono::milliseconds>(nextStatus - std::chrono::steady_clock::now()).count());
+        int n = epoll_wait(epoll_fd, events, 32, timeout);
+        if (n < 0 && errno != EINTR) {
+            log->error("epoll_wait failed: {}", strerror(errno));
+            break;
         }
 
-        char buffer[1024] = {0};
-        ssize_t bytesRead = read(client_fd, buffer, sizeof(buffer) - 1);
-        if (bytesRead > 0) {
-            buffer[bytesRead] = '\0';
-            std::string command(buffer);
-            trim(command);
-            log->info("Received command: {}", command);
-
-            if (command == "start") {
-                if (all_init) {
-                    start_run();
-                } else {
-                    log->error("Run cannot be started. Modules are not initialised.");
-                }
-                
-                if (write(client_fd, "Started\n", 8) == -1) {
-                    log->error("Error writing to client");
-                }
-            } else if (command == "stop") {
-                stop_run();
-                if (write(client_fd, "Stopped\n", 8) == -1) {
-                    log->error("Error writing to client");
-                }
-            } else if (command == "pause") {
-                pause_run();
-                if (write(client_fd, "Paused\n", 7) == -1) {
-                    log->error("Error writing to client");
-                }
-            } else if (command == "resume") {
-                resume_run();
-                if (write(client_fd, "Resumed\n", 8) == -1) {
-                    log->error("Error writing to client");
-                }
-            } else if (command == "!") {
-                daq_exit();
-                if (write(client_fd, "Stopping DAQ\n", 18) == -1) {
-                    log->error("Error writing to client");
-                }
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == server_fd) {
+                acceptClients();
+            } else if (fd == wake_fd) {
+                uint64_t count;
+                while (read(wake_fd, &count, sizeof(count)) > 0) {}
             } else {
-                if (write(client_fd, "Unknown command\n", 16) == -1) {
-                    log->error("Error writing to client");
-                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) readClient(fd);
+                if (clients.count(fd) && (events[i].events & EPOLLOUT)) writeClient(fd);
+            }
+        }
+
+        deliverNotifications();
+
+        if (std::chrono::steady_clock::now() >= nextStatus) {
+            updateRates();
+            std::string status = statusLine();
+            for (auto& [fd, client] : clients) {
+                if (client.subscribed) send(fd, status);
+            }
+            nextStatus += std::chrono::milliseconds(STATUS_INTERVAL_MS);
+            if (nextStatus < std::chrono::steady_clock::now()) {
+                nextStatus = std::chrono::steady_clock::now() + std::chrono::milliseconds(STATUS_INTERVAL_MS);
             }
         }
-        close(client_fd);
     }
 
     log->info("TCP server stopped");
 }
+
+void TCPServer::acceptClients() {
+    auto log = Logger::getLogger();
+    while (true) {
+        int client_fd = accept(server_fd, nullptr, nullptr);
+        if (client_fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) log->warn("Client connection failed");
+            return;
+        }
+        setNonBlocking(client_fd);
+
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = client_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &ev);
+
+        clients[client_fd].id = nextClientId++;
+        log->debug("Client {} connected", clients[client_fd].id);
+    }
+}
+
+/**
+ * @brief Reads from a client and handles every complete line.
+ *
+ * A command that is not terminated by a newline when the client closes the
+ * connection is handled as well.
+ */
+void TCPServer::readClient(int fd) {
+    auto log = Logger::getLogger();
+    char buffer[1024];
+    bool closed = false;
+
+    while (true) {
+        ssize_t bytesRead = read(fd, buffer, sizeof(buffer));
+        if (bytesRead > 0) {
+            clients[fd].in.append(buffer, bytesRead);
+        } else if (bytesRead == 0) {
+            closed = true;
+            break;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) closed = true;
+            break;
+        }
+    }
+
+    size_t newline;
+    while (clients.count(fd) && (newline = clients[fd].in.find('\n')) != std::string::npos) {
+        std::string command = clients[fd].in.substr(0, newline);
+        clients[fd].in.erase(0, newline + 1);
+        handleCommand(fd, command);
+    }
+    if (!clients.count(fd)) return;
+
+    if (closed && !clients[fd].in.empty()) {
+        std::string command;
+        command.swap(clients[fd].in);
+        handleCommand(fd, command);
+    } else if (clients[fd].in.size() > MAX_LINE) {
+        log->warn("Command of client {} too long, closing connection", clients[fd].id);
+        closed = true;
+    }
+
+    if (closed && clients.count(fd)) {
+        // Send what is left before closing, the client may only have closed its sending side
+        writeClient(fd);
+        closeClient(fd);
+    }
+}
+
+void TCPServer::writeClient(int fd) {
+    Client& client = clients[fd];
+    while (!client.out.empty()) {
+        ssize_t written = write(fd, client.out.data(), client.out.size());
+        if (written <= 0) break;
+        client.out.erase(0, written);
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP | (client.out.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+    ev.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void TCPServer::closeClient(int fd) {
+    Logger::getLogger()->debug("Client {} disconnected", clients[fd].id);
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients.erase(fd);
+}
+
+// Queues a line for a client, it is written as far as the socket accepts it
+void TCPServer::send(int fd, const std::string& line) {
+    auto it = clients.find(fd);
+    if (it == clients.end()) return;
+    it->second.out += line;
+    it->second.out += '\n';
+    writeClient(fd);
+}
+
+void TCPServer::handleCommand(int fd, std::string command) {
+    auto log = Logger::getLogger();
+    trim(command);
+    if (command.empty()) return;
+    log->info("Received command: {}", command);
+
+    if (command == "start") {
+        if (!all_init) {
+            log->error("Run cannot be started. Modules are not initialised.");
+            send(fd, "ERROR modules not initialised");
+        } else if (transitionBusy) {
+            send(fd, "BUSY");
+        } else if (state == RunState::Running) {
+            send(fd, "ERROR run already started");
+        } else {
+            runTransition(fd, "start", RunState::Starting, RunState::Running, start_run);
+        }
+    } else if (command == "stop") {
+        if (transitionBusy) {
+            send(fd, "BUSY");
+        } else if (state == RunState::Idle) {
+            send(fd, "ERROR nothing is running");
+        } else {
+            runTransition(fd, "stop", RunState::Stopping, RunState::Idle, []() { stop_run(); return true; });
+        }
+    } else if (command == "switch") {
+        if (transitionBusy) {
+            send(fd, "BUSY");
+        } else if (state == RunState::Idle) {
+            send(fd, "ERROR nothing is running");
+        } else {
+            runTransition(fd, "switch", RunState::Switching, RunState::Running, switch_run);
+        }
+    } else if (command == "pause" || command == "resume") {
+        bool pause = (command == "pause");
+        if (pause ? pause_run() : resume_run()) {
+            paused = pause;
+            send(fd, "OK " + command);
+            post(SUBSCRIBERS, "");
+        } else {
+            send(fd, "ERROR " + command + " failed");
+        }
+    } else if (command == "status") {
+        send(fd, statusLine());
+    } else if (command == "subscribe" || command == "unsubscribe") {
+        clients[fd].subscribed = (command == "subscribe");
+        send(fd, "OK " + command);
+        if (clients[fd].subscribed) send(fd, statusLine());
+    } else if (command == "!") {
+        send(fd, "OK Stopping DAQ");
+        daq_exit();
+    } else {
+        send(fd, "ERROR unknown command");
+    }
+}
+
+/**
+ * @brief Runs start or stop on the transition thread.
+ *
+ * The client gets "OK <name>" at once and "DONE <name> ok|failed" when the
+ * transition has finished, the subscribers get the new state. Only one
+ * transition runs at a time.
+ */
+void TCPServer::runTransition(int fd, const std::string& name, RunState during, RunState after, std::function<bool()> action) {
+    if (transitionBusy.exchange(true)) {
+        send(fd, "BUSY");
+        return;
+    }
+    if (transitionThread.joinable()) {
+        transitionThread.join();   // the previous transition has already finished
+    }
+
+    const RunState before = state;
+    const uint64_t clientId = clients[fd].id;
+    state = during;
+    send(fd, "OK " + name);
+    post(SUBSCRIBERS, "");
+
+    transitionThread = std::thread([this, name, before, after, action, clientId]() {
+        bool ok = action();
+        state = ok ? after : before;
+        if (after == RunState::Idle) paused = false;
+        post(clientId, "DONE " + name + (ok ? " ok" : " failed"));
+        post(SUBSCRIBERS, "");      // the status line is made by the server thread
+        transitionBusy = false;
+    });
+}
+
+// Thread safe, hands a line to the server thread, an empty line is replaced by the current status
+void TCPServer::post(uint64_t clientId, const std::string& line) {
+    {
+        std::lock_guard<std::mutex> lock(notifyMutex);
+        notifications.emplace_back(clientId, line);
+    }
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) == -1) {
+        Logger::getLogger()->warn("Could not wake up the TCP server");
+    }
+}
+
+void TCPServer::deliverNotifications() {
+    std::vector<std::pair<uint64_t, std::string>> pending;
+    {
+        std::lock_guard<std::mutex> lock(notifyMutex);
+        pending.swap(notifications);
+    }
+    for (auto& [clientId, line] : pending) {
+        if (line.empty()) line = statusLine();
+        for (auto& [fd, client] : clients) {
+            if ((clientId == SUBSCRIBERS && client.subscribed) || client.id == clientId) {
+                send(fd, line);
+            }
+        }
+    }
+}
+
+void TCPServer::updateRates() {
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - lastRateUpdate).count();
+    uint64_t blocks = blocksWritten.load();
+    uint64_t bytes = bytesWritten.load();
+    if (seconds > 0) {
+        // the counters are reset at the start of a run
+        blockRate = (blocks >= lastBlocks) ? (blocks - lastBlocks) / seconds : blocks / seconds;
+        dataRate = ((bytes >= lastBytes) ? (bytes - lastBytes) : bytes) / seconds / 1e6;
+    }
+    lastBlocks = blocks;
+    lastBytes = bytes;
+    lastRateUpdate = now;
+}
+
+std::string TCPServer::statusLine() const {
+    static const char* names[] = { "idle", "starting", "running", "stopping", "switching" };
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2)
+       << "STATUS state=" << names[static_cast<int>(state.load())]
+       << " run=" << currentRunNumber
+       << " paused=" << (paused ? 1 : 0)
+       << " blocks=" << blocksWritten.load()
+       << " block_rate=" << blockRate
+       << " mb=" << bytesWritten.load() / 1e6
+       << " mb_rate=" << dataRate
+       << " " << eventIdChecker.status();
+    return ss.str();
+}
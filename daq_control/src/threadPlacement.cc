@@ -0,0 +1,185 @@
+#include "threadPlacement.hh"
+#include "logger.hh"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+ThreadPlacement::Settings ThreadPlacement::roles[ThreadPlacement::NUM_ROLES];
+std::vector<int> ThreadPlacement::processCpus;
+std::mutex ThreadPlacement::mutex;
+
+static const char* roleNames[ThreadPlacement::NUM_ROLES] = {"polling", "readout", "processing", "writer", "server"};
+
+/**
+ * @brief Parses a CPU list like "2", "2,3" or "4-7,9".
+ *
+ * @return The CPUs, empty if the list is empty or invalid.
+ */
+std::vector<int> ThreadPlacement::parseCpus(const std::string& list) {
+    std::vector<int> cpus;
+    std::istringstream ss(list);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) continue;
+        try {
+            size_t dash = item.find('-');
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+                if (cpu >= 0) cpus.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            Logger::getLogger()->warn("Invalid CPU list '{}', not pinned", list);
+            return {};
+        }
+    }
+    return cpus;
+}
+
+/**
+ * @brief Reads the thread placement from the config, at the start and before each run.
+ *
+ * Threads that are already running keep their settings until they call
+ * apply() again.
+ */
+void ThreadPlacement::configure(std::map<std::string, std::string>& config) {
+    auto log = Logger::getLogger();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (processCpus.empty()) {
+        // the first call is made by the main thread, before any thread is pinned
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &set)) processCpus.push_back(cpu);
+            }
+        }
+    }
+
+    for (int i = 0; i < NUM_ROLES; i++) {
+        std::string name = roleNames[i];
+        Settings& role = roles[i];
+
+        role.cpus = config.count("cpu_" + name) ? parseCpus(config["cpu_" + name]) : std::vector<int>();
+        role.priority = config.count("rt_priority_" + name) ? std::stoi(config["rt_priority_" + name]) : 0;
+        if (role.priority < 0 || role.priority > 99) {
+            log->warn("rt_priority_{} must be 0-99, using the normal scheduler", name);
+            role.priority = 0;
+        }
+        if (i == Polling && role.priority > 0 && role.cpus.empty()) {
+            log->warn("rt_priority_polling without cpu_polling, the polling thread may starve other threads");
+        }
+        role.reported = false;
+    }
+}
+
+/**
+ * @brief Pins the calling thread and sets its scheduler for the given role.
+ *
+ * Roles without settings get all CPUs of the process and the normal scheduler.
+ */
+void ThreadPlacement::apply(Role role) {
+    auto log = Logger::getLogger();
+    Settings& settings = roles[role];
+    std::vector<int> cpus, processCpus;
+    int priority;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cpus = settings.cpus;
+        processCpus = ThreadPlacement::processCpus;
+        priority = settings.priority;
+    }
+
+    // threads inherit the settings of the thread that started them, e.g. the
+    // readout threads those of the polling thread, so the defaults are set as well
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus.empty() ? processCpus : cpus) CPU_SET(cpu, &set);
+    if (CPU_COUNT(&set) > 0) {
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            log->warn("Could not pin the {} thread: {}", roleNames[role], strerror(err));
+        }
+    }
+
+    sched_param param{};
+    param.sched_priority = priority;
+    int err = pthread_setschedparam(pthread_self(), priority > 0 ? SCHED_FIFO : SCHED_OTHER, &param);
+    if (err != 0) {
+        log->warn("Could not set the scheduler of the {} thread: {}", roleNames[role], strerror(err));
+    }
+
+    // readout threads are started for every readout, only the first one is logged
+    if (!settings.reported.exchange(true)) {
+        std::string applied = currentSettings();
+        log->info("{} thread: {}", roleNames[role], applied);
+        std::lock_guard<std::mutex> lock(mutex);
+        settings.applied = applied;
+    }
+}
+
+/**
+ * @brief Locks all current and future pages of the process if lock_memory=1.
+ *
+ * Called once at the start, before the buffers of the readout are allocated.
+ */
+void ThreadPlacement::lockMemory(std::map<std::string, std::string>& config) {
+    auto log = Logger::getLogger();
+    if (!config.count("lock_memory") || config["lock_memory"] != "1") return;
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        log->warn("Could not lock the memory: {}", strerror(errno));
+    } else {
+        log->info("Memory locked");
+    }
+}
+
+/**
+ * @brief The CPUs and scheduler of the calling thread, as the kernel reports them.
+ */
+std::string ThreadPlacement::currentSettings() {
+    std::string result = "cpus ";
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        int count = CPU_COUNT(&set);
+        std::string list;
+        for (int cpu = 0; cpu < CPU_SETSIZE && count > 0; cpu++) {
+            if (!CPU_ISSET(cpu, &set)) continue;
+            list += (list.empty() ? "" : ",") + std::to_string(cpu);
+            count--;
+        }
+        result += list;
+    } else {
+        result += "?";
+    }
+
+    int policy;
+    sched_param param{};
+    if (pthread_getschedparam(pthread_self(), &policy, &param) == 0) {
+        if (policy == SCHED_FIFO) result += ", SCHED_FIFO " + std::to_string(param.sched_priority);
+        else if (policy == SCHED_RR) result += ", SCHED_RR " + std::to_string(param.sched_priority);
+        else result += ", SCHED_OTHER";
+    }
+    return result;
+}
+
+/**
+ * @brief The settings applied to each role so far, "polling: cpus 2, SCHED_FIFO 50; ...".
+ */
+std::string ThreadPlacement::report() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string result;
+    for (int i = 0; i < NUM_ROLES; i++) {
+        if (roles[i].applied.empty()) continue;
+        result += (result.empty() ? "" : "; ") + std::string(roleNames[i]) + ": " + roles[i].applied;
+    }
+    return result;
+}
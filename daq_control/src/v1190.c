@@ -1,10 +1,18 @@
 #include <CAENVMElib.h>
 #include "v1190.h"
 #include <unistd.h>
+#include <sched.h>
+#include <time.h>
 
 #define Sleep(x) usleep((x)*1000)
 
-int VMEerror = 0;
+#define HS_SPIN_READS    16         // handshake reads before yielding
+#define HS_YIELD_READS   64         // handshake reads before sleeping
+#define HS_MAX_SLEEP_US  1000
+#define HS_TIMEOUT_US    3000000    // same limit as the former 3000 x 1 ms
+
+// per thread, so modules can be initialised in parallel
+__thread int VMEerror = 0;
 
 // ---------------------------------------------------------------------------
 // Read a 16 bit register of the V1190
@@ -25,21 +33,58 @@ void V1190WriteRegister(unsigned short RegAddr, unsigned short RegData, int hand
 	VMEerror |= CAENVME_WriteCycle(handle, BaseAddress + RegAddr, &reg, cvA32_U_DATA, cvD16);
 }
 
+static long long MonotonicUs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// ---------------------------------------------------------------------------
+// Wait until the micro controller accepts the next opcode word.
+// The handshake bit is usually set again after a few us, so the register is
+// polled back to back first, then with sched_yield and only then with a
+// sleep that doubles up to 1 ms. Returns 0 when ready.
+// ---------------------------------------------------------------------------
+int V1190WaitWriteOk(int handle, int BaseAddress)
+{
+	int n = 0;
+	unsigned int wait_us = 10;
+	long long start = 0;
+	unsigned short hs = 0;
+
+	for (;;) {
+		hs = V1190ReadRegister(PROG_HS, handle, BaseAddress);
+		if (VMEerror)
+			return 1;
+		if (hs & 0x01)
+			return 0;
+		n++;
+		if (n <= HS_SPIN_READS)
+			continue;
+		if (start == 0)
+			start = MonotonicUs();
+		else if (MonotonicUs() - start > HS_TIMEOUT_US)
+			return 1;
+		if (n <= HS_YIELD_READS) {
+			sched_yield();
+		} else {
+			usleep(wait_us);
+			if (wait_us < HS_MAX_SLEEP_US)
+				wait_us *= 2;
+		}
+	}
+}
+
 // ---------------------------------------------------------------------------
 // Write Opcode
 // ---------------------------------------------------------------------------
 int V1190WriteOpcode(int nw, const unsigned short* Data, int handle, int BaseAddress)
 {
-	int i, timeout = 0;
-	unsigned short hs = 0;
+	int i;
 
 	for (i = 0; i < nw; i++) {
-		do {
-			hs = V1190ReadRegister(PROG_HS, handle, BaseAddress);
-			timeout++;
-			Sleep(1);
-		} while (!VMEerror && ((hs & 0x01) == 0) && (timeout < 3000)); /* wait to write */
-		if ((timeout == 3000) || VMEerror)
+		if (V1190WaitWriteOk(handle, BaseAddress))  /* wait to write */
 			return 1;
 		V1190WriteRegister(OPCODE, Data[i], handle, BaseAddress);
 		if (VMEerror) {
@@ -135,6 +180,33 @@ unsigned short V1190ReadDummyValue(int handle, int BaseAddress)
 	return reg;
 }
 
+void V1190WriteDummy32(unsigned int RegData, int handle, int BaseAddress)
+{
+    unsigned int reg = RegData;
+    VMEerror |= CAENVME_WriteCycle(handle, BaseAddress + DUMMY32, &reg, cvA32_U_DATA, cvD32);
+}
+
+unsigned int V1190ReadDummy32(int handle, int BaseAddress)
+{
+    unsigned int reg = 0;
+    VMEerror |= CAENVME_ReadCycle(handle, BaseAddress + DUMMY32, &reg, cvA32_U_DATA, cvD32);
+    return reg;
+}
+
+unsigned short V1190ReadBltEvtNr(int handle, int BaseAddress)
+{
+    unsigned short reg = 0;
+    VMEerror |= CAENVME_ReadCycle(handle, BaseAddress + BLT_EVNUM, &reg, cvA32_U_DATA, cvD16);
+    return reg;
+}
+
+unsigned short V1190ReadAlmostFullLevel(int handle, int BaseAddress)
+{
+    unsigned short reg = 0;
+    VMEerror |= CAENVME_ReadCycle(handle, BaseAddress + AF_LEV, &reg, cvA32_U_DATA, cvD16);
+    return reg;
+}
+
 unsigned short V1190ReadFirmwareRevision(int handle, int BaseAddress)
 {
     unsigned short reg = 0;
@@ -10,6 +10,7 @@
 #include <unistd.h>
 #include <chrono>
 #include "v1190.hh"
+#include "stageTimer.hh"
 
 
 v1190::v1190(int vmeBaseAddress, int handle) 
@@ -24,24 +25,120 @@ v1190::v1190(int vmeBaseAddress, int handle)
  * parameters, and updates the status register. If any step fails, the 
  * initialization process returns false.
  *
+ * With warm set, the reset and reprogramming are skipped if the module still
+ * holds the settings of setupV1190, see isConfigured(). Only its buffers are
+ * cleared then.
+ *
  * @param tdcId The ID of the TDC to initialize.
+ * @param warm Reuse the settings in the module if they are unchanged.
  * @return True if initialization is successful, false otherwise.
  */
 
-bool v1190::init(int tdcId){
+bool v1190::init(int tdcId, bool warm){
+
+    auto log = Logger::getLogger();
+    StageTimer timer(fmt::format("TDC {:d} init", tdcId));
 
-   if(!checkModuleResponse()) return false;
+    if(!checkModuleResponse()) return false;
+    timer.stage("response");
 
     bool retVal = true;
-    retVal &= setupV1190(tdcId);
+    if (warm && isConfigured()) {
+        log->info("TDC {:d} is still set up, skipping reset and opcodes", tdcId);
+        V1190SoftClear(0, handle, vmeBaseAddress);
+        timer.stage("warm");
+    } else {
+        retVal &= setupV1190(tdcId);
+        timer.stage("setup");
+    }
 
     getPara();
     getStatusReg();
+    timer.stage("read back");
 
+    timer.done();
     return retVal;
 }
 
+/**
+ * @brief Opcodes written by setupV1190, in this order.
+ *
+ * Every entry is one micro controller command with its arguments. The whole
+ * table goes through the handshake back to back, without reading anything
+ * back in between.
+ */
+const v1190::Opcode v1190::setupOpcodes[] = {
+    // all values in units of 25 ns (cycle length of the TDCs)
+    {1, {0x0000}},              // Trigger matching Flag
+    {2, {0x1000, 0x38}},        // Width: 1400 ns
+    {2, {0x1100, 0xFFF0}},      // Offset: -400 ns
+    {1, {0x1400}},              // Subtraction flag, reference point: beginning of trigger window
+    // {1, {0x1500}},           // Disable subtraction flag, reference point: last bunch reset
+    // Extra search and reject margin = 0 => only events in trigger window recorded
+    {2, {0x1200, 0x0}},         // Extra search margin: none
+    {2, {0x1300, 0x0}},         // Reject margin: none
+    {2, {0x2200, 0x3}},         // Edge Detection: trailing + leading edge
+    {2, {0x2400, 0x0002}},      // Resolution 100ps
+    {2, {0x3000, 0x1}},         // TDC Header/Trailer enable
+    {2, {0x3500, 0x1}},         // TDC Error enable (0x3600: disable)
+    {2, {0x4200, 0x1}},         // enable all channels (0x4300: disable)
+};
+
+/**
+ * @brief Hash (FNV-1a) of all settings written by setupV1190.
+ *
+ * Stored in the 32 bit dummy register after a successful setup. The register
+ * is cleared by a power cycle, so a matching value means the module was set up
+ * with exactly these settings and not switched off since.
+ */
+uint32_t v1190::configFingerprint(){
+
+    uint32_t hash = 2166136261u;
+    auto add = [&hash](unsigned short word) {
+        for (int shift : {0, 8}) {
+            hash ^= (word >> shift) & 0xff;
+            hash *= 16777619u;
+        }
+    };
+
+    add(ETTT_ENABLE_MASK | BERR_ENABLE_MASK);
+    add(BLT_EVENTS);
+    add(ALMOST_FULL_LEVEL);
+    for (const auto& op : setupOpcodes) {
+        add(op.nw);
+        for (int i = 0; i < op.nw; i++) add(op.words[i]);
+    }
+
+    return hash ? hash : 1;     // 0 is the power-up value
+}
+
+/**
+ * @brief Checks if the module still holds the settings of setupV1190.
+ *
+ * Compares the fingerprint in the dummy register with configFingerprint() and
+ * reads back the control register, the BLT event number and the almost full
+ * level, which are lost by a reset.
+ *
+ * @return true if setupV1190 can be skipped.
+ */
+bool v1190::isConfigured(){
+
+    auto log = Logger::getLogger();
+
+    unsigned int stored = V1190ReadDummy32(handle, vmeBaseAddress);
+    unsigned short cr = V1190ReadControlRegister(handle, vmeBaseAddress);
+    unsigned short blt = V1190ReadBltEvtNr(handle, vmeBaseAddress);
+    unsigned short afl = V1190ReadAlmostFullLevel(handle, vmeBaseAddress);
 
+    const unsigned short crMask = ETTT_ENABLE_MASK | BERR_ENABLE_MASK;
+    bool match = stored == configFingerprint() && (cr & crMask) == crMask
+        && blt == BLT_EVENTS && afl == ALMOST_FULL_LEVEL;
+
+    log->debug("Stored settings {:#x} (expected {:#x}), CR {:#x}, BLT {:d}, AFL {:d}: {}",
+        stored, configFingerprint(), cr, blt, afl, match ? "unchanged" : "set up again");
+
+    return match;
+}
 
 /**
  * @brief Configures the V1190 module with specific settings for a given TDC.
@@ -71,6 +168,9 @@ bool v1190::setupV1190(int tdcId){
     int cr, ettt, al64, blt, fifo, berr;
     
 
+    // invalidate the stored settings until the setup is complete
+    V1190WriteDummy32(0, handle, vmeBaseAddress);
+
     // perform board reset
     V1190SoftClear(0, handle, vmeBaseAddress);
     V1190SoftReset(0, handle, vmeBaseAddress);
@@ -87,7 +187,7 @@ bool v1190::setupV1190(int tdcId){
     ettt = V1190_EnableETTT(handle, vmeBaseAddress);
     log->debug("ETTT enabled           CR  : {:#x}", ettt );
 
-    blt = V1190SetBltEvtNr(0xff, handle, vmeBaseAddress);
+    blt = V1190SetBltEvtNr(BLT_EVENTS, handle, vmeBaseAddress);
     log->debug("BLT set                CR  : {:#x}", blt);
 
     // fifo = V1190_EnableFIFO(handle, vmeBaseAddress);
@@ -106,95 +206,19 @@ bool v1190::setupV1190(int tdcId){
 
     //////////////////////////////////////////////////////////////
 
-    unsigned short int almost_full_level = 512; //512;  //Maximum nr of 32-bit words per BLT
     // 16383;  //Maximum nr of 32-bit words per BLT for 1000 Hz
-    V1190SetAlmostFullLevel(almost_full_level, handle, vmeBaseAddress);
-
-    code[0] = 0x0000;  // Trigger matching Flag
-    retVal |= V1190WriteOpcode(1, code, handle, vmeBaseAddress);
-    if (retVal) {
-        log->error("Opcode 0x{:x} failed at TDC {}", code[0], tdcId);
-    }
-
-    // all values in units of 25 ns (cycle length of the TDCs)
-
-    code[0] = 0x1000;  // Width
-    code[1] = 0x38; // 1400 ns
-    retVal |= V1190WriteOpcode(2, code, handle, vmeBaseAddress);
-    if (retVal) {
-        log->error("Opcode 0x{:x} failed at TDC {}", code[0], tdcId);
-    }
-
-    code[0] = 0x1100;  // Offset
-    code[1] = 0xFFF0; //  -400ns
-    retVal |= V1190WriteOpcode(2, code, handle, vmeBaseAddress);
-    if (retVal) {
-        log->error("Opcode 0x{:x} failed at TDC {}", code[0], tdcId);
-    }
-
-    code[0] = 0x1400;  // Subtraction flag
-    retVal |= V1190WriteOpcode(1, code, handle, vmeBaseAddress); // reference point: beginning of trigger window
-    if (retVal) {
-        log->error("Opcode 0x{:x} failed at TDC {}", code[0], tdcId);
-    }
-    
-    // code[0] = 0x1500;  // Disable subtraction flag
-    // value = V1190WriteOpcode(1, code); // reference point: last bunch reset
-
-    // Extra search and reject margin = 0 => only events in trigger window recorded
-    code[0] = 0x1200;  // Extra search margin
-    code[1] = 0x0;  // no extra search margin
-    retVal |= V1190WriteOpcode(2, code, handle, vmeBaseAddress);
-    if (retVal) {
-        log->error("Opcode 0x{:x} failed at TDC {}", code[0], tdcId);
-    }
+    V1190SetAlmostFullLevel(ALMOST_FULL_LEVEL, handle, vmeBaseAddress);
 
-    code[0] = 0x1300;  // reject margin
-    code[1] = 0x0;  // no reject margin
-    retVal |= V1190WriteOpcode(2, code, handle, vmeBaseAddress);
-    if (retVal) {
-        log->error("Opcode 0x{:x} failed at TDC {}", code[0], tdcId);
-    }
-
-    code[0] = 0x2200;  // Edge Detection
-    code[1] = 0x3;  // trailing + leading edge
-    retVal |= V1190WriteOpcode(2, code, handle, vmeBaseAddress);
-    if (retVal) {
-        log->error("Opcode 0x{:x} failed at TDC {}", code[0], tdcId);
-    }
-
-    // Resolution 100ps
-    code[0] = 0x2400;
-    code[1] = 0x0002;
-    retVal |= V1190WriteOpcode(2, code, handle, vmeBaseAddress);
-    if (retVal) {
-        log->error("Opcode 0x{:x} failed at TDC {}", code[0], tdcId);
-    }
-
-    code[0] = 0x3000;  // TDC Header/Trailer enable
-    code[1] = 0x1;
-    retVal |= V1190WriteOpcode(2, code, handle, vmeBaseAddress);
-    if (retVal) {
-        log->error("Opcode 0x{:x} failed at TDC {}", code[0], tdcId);
-    }
-
-    code[0] = 0x3500;  // TDC Error enable
-    // code[0] = 0x3600;  // TDC Error disable
-    code[1] = 0x1;
-    retVal |= V1190WriteOpcode(2, code, handle, vmeBaseAddress);
-    if (retVal) {
-        log->error("Opcode 0x{:x} failed at TDC {}", code[0], tdcId);
+    for (const auto& op : setupOpcodes) {
+        if (V1190WriteOpcode(op.nw, op.words, handle, vmeBaseAddress)) {
+            log->error("Opcode 0x{:x} failed at TDC {}", op.words[0], tdcId);
+            retVal = 1;
+            break;
+        }
     }
 
-    code[0] = 0x4200;  // enable all channels
-    // code[1] = 0x1;
-    // value = V1190WriteOpcode(2, code, handle, vmeBaseAddress);
-
-    //code[0] = 0x4300;  // disable all channels
-    code[1] = 0x1;
-    retVal |= V1190WriteOpcode(2, code, handle, vmeBaseAddress);
-    if (retVal) {
-        log->error("Opcode 0x{:x} failed at TDC {}", code[0], tdcId);
+    if (retVal == 0) {
+        V1190WriteDummy32(configFingerprint(), handle, vmeBaseAddress);
     }
 
     log->info("TDC {:d} was set up", tdcId);
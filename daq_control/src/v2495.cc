@@ -2,6 +2,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <cstdlib>
+#include <chrono>
 #include "v2495.hh"
 
 // v2495::v2495(int ConnType, char* IpAddr, int SerialNumber, char* vmeBaseAddress, int handle) 
@@ -144,6 +145,62 @@ int v2495::resetCounter() {
     return vmeError;
 }
 
+/**
+ * @brief Reads all counters of the FPGA with a single VME multi read.
+ *
+ * Adds one event to the bank: the system time of the readout in ns as
+ * timestamp and the SCALER_WORDS counters as data, in the order of
+ * scalerRegisters. The counters are not reset, rates are the differences
+ * between consecutive readouts.
+ *
+ * @param dataBank The SCLR bank.
+ * @return The number of words read, -1 on a VME error.
+ */
+int v2495::readScalers(DataBank& dataBank) {
+
+    static const uint32_t scalerRegisters[SCALER_WORDS] = {
+        SCI_REG_event_cnt,
+        SCI_REG_freq,
+        SCI_REG_coincidences_upper,
+        SCI_REG_coincidences_lower,
+        SCI_REG_signals_bgo,
+        SCI_REG_trigger_cnt,
+        SCI_REG_gated_cnt,
+    };
+
+    auto log = Logger::getLogger();
+
+    uint32_t addrs[SCALER_WORDS];
+    uint32_t values[SCALER_WORDS] = { 0 };
+    CVAddressModifier am[SCALER_WORDS];
+    CVDataWidth dw[SCALER_WORDS];
+    CVErrorCodes ec[SCALER_WORDS];
+
+    uint64_t baseAddr = getBaseAddr();
+    for (int i = 0; i < SCALER_WORDS; i++) {
+        addrs[i] = baseAddr + scalerRegisters[i];
+        am[i] = cvA32_U_DATA;
+        dw[i] = cvD32;
+    }
+
+    auto now = std::chrono::system_clock::now();
+    int ret = CAENVME_MultiRead(handle, addrs, values, SCALER_WORDS, am, dw, ec);
+    if (ret != cvSuccess) {
+        log->error("Scaler readout failed: {:d}", ret);
+        vmeError |= ret;
+        return -1;
+    }
+
+    Event event;
+    event.eventID = 0;
+    event.timestamp = 0;
+    event.timestamp64 = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+    event.data.assign(values, values + SCALER_WORDS);
+    dataBank.addEvent(event);
+
+    return SCALER_WORDS;
+}
+
 int v2495::startGateList() {
     vmeError |= setRegister(0x2, SCI_REG_Gate_CONFIG);
     vmeError |= setRegister(0x1, SCI_REG_Gate_CONFIG);
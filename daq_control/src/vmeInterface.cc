@@ -3,8 +3,15 @@
 #include <CAENVMElib.h>
 #include <unistd.h>
 
+#include <chrono>
+#include <thread>
+
 #define Sleep(x) usleep((x)*1000)
 
+// The pulser output follows the start/stop calls at once, the veto only has
+// to be visible on the scope while testing.
+static const int VETO_TEST_MS = 10;
+
 // VMEInterface::VMEInterface(uint32_t vmeBaseAddress) : vmeBaseAddress(vmeBaseAddress), handle(-1) {}
 
 VMEInterface::VMEInterface(int ConnType, char* vmeIPAddress) 
@@ -22,8 +29,8 @@ VMEInterface::~VMEInterface() {
  *
  * This function attempts to open the VME controller using the configured
  * base address. If the initialization is successful, it also sets up the
- * veto bits. If the initialization fails, it logs an error and sleeps for
- * 1 second before returning.
+ * veto bits and toggles the veto once for a short test pulse. If the
+ * initialization fails, it logs an error and returns.
  *
  * @return true on success, false on failure.
  */
@@ -55,15 +62,14 @@ bool VMEInterface::init() {
     if (stopVeto() != cvSuccess) {
         log->error("Can't stop veto");
     } else {
-        log->debug("Veto stopped, sleeping 0.5 s.");
-        sleep(0.5);
+        log->debug("Veto stopped.");
     }
 
     if (startVeto() != cvSuccess) {
         log->error("Can't start veto");
     } else {
-        log->debug("Veto started, sleeping 1 s.");
-        sleep(1);
+        log->debug("Veto started, holding it for {:d} ms.", VETO_TEST_MS);
+        std::this_thread::sleep_for(std::chrono::milliseconds(VETO_TEST_MS));
     }    
 
     if (stopVeto() != cvSuccess) {
@@ -156,8 +162,11 @@ int VMEInterface::startVeto() {
     // bool ret = true;
     // ret = write(PULSE_A_START, 0x1);    // bit 1 is SW trigger
     // return ret;
+    std::lock_guard<std::mutex> lock(holdMutex);
+    controlVeto = true;
     int re = 0;
     re = CAENVME_StartPulser(handle, cvPulserA);
+    if (re == cvSuccess) vetoChanged(true);
     return re;
 }
 
@@ -177,9 +186,90 @@ int VMEInterface::stopVeto() {
     // ret &= write(PULSE_A_CLEAR, 0x1);    // bit 1 is SW clear
     // ret &= write(PULSE_A_CLEAR, 0x0);    // bit 1 is SW clear
     // return ret;
+    std::lock_guard<std::mutex> lock(holdMutex);
+    controlVeto = false;
+    if (held) return cvSuccess;     // released by holdVeto(false)
     int re = 0;
     re = CAENVME_StopPulser(handle, cvPulserA);
+    if (re == cvSuccess) vetoChanged(false);
     return re;
 
 }
 
+/**
+ * @brief Holds or releases the veto independent of start/stopVeto.
+ *
+ * Used by the DAQ while its queues are too full. The veto stays on as long
+ * as either startVeto() or holdVeto(true) asks for it, so a pause is not
+ * ended by the release of the hold and the other way round.
+ *
+ * @param hold true to hold the veto.
+ * @return cvSuccess or the CAENVME error.
+ */
+int VMEInterface::holdVeto(bool hold) {
+    std::lock_guard<std::mutex> lock(holdMutex);
+    if (hold == held) return cvSuccess;
+
+    int re = cvSuccess;
+    if (hold) {
+        if (!controlVeto) {
+            re = CAENVME_StartPulser(handle, cvPulserA);
+            if (re == cvSuccess) vetoChanged(true);
+        }
+        if (re == cvSuccess) {
+            held = true;
+            holds++;
+        }
+    } else {
+        if (!controlVeto) {
+            re = CAENVME_StopPulser(handle, cvPulserA);
+            if (re == cvSuccess) vetoChanged(false);
+        }
+        if (re == cvSuccess) held = false;
+    }
+    return re;
+}
+
+/**
+ * @brief Accumulates the time under veto when the veto is switched.
+ *
+ * @param on The new state of the veto.
+ */
+void VMEInterface::vetoChanged(bool on) {
+    std::lock_guard<std::mutex> lock(vetoMutex);
+    auto now = std::chrono::steady_clock::now();
+    if (vetoOn && !on) {
+        vetoTotal_us += std::chrono::duration_cast<std::chrono::microseconds>(now - vetoSince).count();
+    } else if (!vetoOn && on) {
+        vetoSince = now;
+    }
+    vetoOn = on;
+}
+
+/**
+ * @brief Returns the time under veto since the last resetVetoTime().
+ *
+ * A veto that is still on is counted up to now.
+ *
+ * @return The veto time in us.
+ */
+uint64_t VMEInterface::vetoTime_us() {
+    std::lock_guard<std::mutex> lock(vetoMutex);
+    uint64_t total = vetoTotal_us;
+    if (vetoOn) {
+        total += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - vetoSince).count();
+    }
+    return total;
+}
+
+/**
+ * @brief Starts a new veto time count, e.g. at the start of a run.
+ *
+ * A veto that is on stays on and is counted from now.
+ */
+void VMEInterface::resetVetoTime() {
+    std::lock_guard<std::mutex> lock(vetoMutex);
+    vetoTotal_us = 0;
+    vetoSince = std::chrono::steady_clock::now();
+}
+
@@ -7,10 +7,18 @@
 #include <sys/stat.h>  // For file size checking
 #include <cstdlib>
 #include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include "logger.hh"
 #include "fileReader.hh"
 #include "dataDecoder.hh"
 #include "dataFilter.hh"
+#include "guiPublisher.hh"
+#include "monitorHistograms.hh"
+#include "liveEventBuilder.hh"
+#include "shmRing.hh"
+#include "summaryPlots.hh"
 
 namespace fs = std::filesystem;
 
@@ -24,6 +32,7 @@ long get_file_size(const std::string& filename) {
 // Config file for run number: 
 const std::string runconfig = "../../config/daq_config.conf";
 std::map<std::string, std::string> config;
+std::mutex configMutex;     // the batch mode loads the config from several threads
 
 
 /**
@@ -39,6 +48,7 @@ std::map<std::string, std::string> config;
 std::map<std::string, std::string> loadConfig() {
 
     auto log = Logger::getLogger();
+    std::lock_guard<std::mutex> lock(configMutex);
 
     std::ifstream file(runconfig);
     // std::map<std::string, std::string> config;
@@ -113,13 +123,87 @@ std::string getTmpDataFilename(int runNumber) {
     return filename.str(); 
 }
 
-void createPlotsPython(int runNumber) {
-    std::string command = "/home/hododaq/anaconda3/bin/python ../create_plots.py " + std::to_string(runNumber);
-    int result = std::system(command.c_str());
+OutputBackend getOutputBackend() {
+    std::map<std::string, std::string> config = loadConfig();
+    return parseOutputBackend(config["output_backend"]);
+}
+
+ExportFormat getExportFormat() {
+    std::map<std::string, std::string> config = loadConfig();
+    return parseExportFormat(config["export_format"]);
+}
+
+HodoGeometry getHodoGeometry() {
+    return HodoGeometry::fromConfig(loadConfig());
+}
+
+IOProfile getIOProfile() {
+    return IOProfile::fromConfig(loadConfig());
+}
+
+std::string getShmRingName() {
+    std::map<std::string, std::string> config = loadConfig();
+    return config.count("shm_ring_name") ? config["shm_ring_name"] : "/hodo_daq_ring";
+}
+
+// Interval of the monitoring snapshots sent to the GUI during live analysis
+int getMonitorInterval() {
+    std::map<std::string, std::string> config = loadConfig();
+    try {
+        return config.count("monitor_interval_ms") ? std::stoi(config["monitor_interval_ms"]) : 1000;
+    } catch (const std::exception& e) {
+        Logger::getLogger()->error("Invalid monitor_interval_ms in config: {}", e.what());
+        return 1000;
+    }
+}
 
-    if (result != 0) {
-        std::cerr << "Python script failed with code " << result << std::endl;
+/**
+ * @brief Seconds between two decoder checkpoints, 0 if the decoding is not checkpointed.
+ *
+ * Only a TTree raw file can be resumed: an RNTuple gets its footer when the
+ * writer is closed, so the file of a checkpoint cannot be read. A save by
+ * io_flush_every after a checkpoint adds entries, then the resume starts over.
+ */
+int getCheckpointInterval(OutputBackend backend, const IOProfile& io) {
+    auto log = Logger::getLogger();
+    std::map<std::string, std::string> config = loadConfig();
+    int interval = 60;
+    try {
+        interval = config.count("checkpoint_interval_s") ? std::stoi(config["checkpoint_interval_s"]) : 60;
+    } catch (const std::exception& e) {
+        log->error("Invalid checkpoint_interval_s in config: {}", e.what());
     }
+    if (interval > 0 && backend == OutputBackend::RNTuple) {
+        log->info("No decoder checkpoints with the rntuple backend");
+        return 0;
+    }
+    if (interval > 0 && io.flushEvery > 0) {
+        log->warn("io_flush_every={} saves the raw file after the checkpoints, an interrupted decoding can only be resumed with io_flush_every=0", io.flushEvery);
+    }
+    return interval;
+}
+
+std::string getBenchmarkFilename(int runNumber) {
+    std::map<std::string, std::string> config = loadConfig();
+
+    std::ostringstream filename;
+    filename << config["daq_path"] 
+             << config["ana_path"] << "/"
+             << "io_benchmark_"
+             << std::setw(6) << std::setfill('0') << runNumber
+             << ".csv";
+
+    return filename.str(); 
+}
+
+std::string getBatchStatusFilename() {
+    std::map<std::string, std::string> config = loadConfig();
+    return config["daq_path"] + config["ana_path"] + "/batch_status.csv";
+}
+
+std::string getBgoGeomFilename() {
+    std::map<std::string, std::string> config = loadConfig();
+    return config["daq_path"] + "config/bgo_geom.csv";
 }
 
 std::string getLockFilename(int runNumber) {
@@ -133,109 +217,274 @@ std::string getLockFilename(int runNumber) {
 }
 
 
-void runOfflineAnalysis(int runNumber) {
+/**
+ * @brief Cuts the binary file of a run back to its last complete block.
+ *
+ * After a crash of the DAQ the file can end in a half written block. The
+ * blocks are read from the start, the file is truncated after the last one
+ * that could be read completely. The .commit file of the DAQ holds the size
+ * that was durable on disk; if the readable part is shorter, the file is
+ * damaged before that point and is left as it is.
+ *
+ * @param runNumber The run to recover.
+ * @return true if the file is complete now.
+ */
+bool recoverRun(int runNumber) {
+    auto log = Logger::getLogger();
+    std::string binFile = getBinFilename(runNumber);
+    std::string commitFile = binFile.substr(0, binFile.size() - 4) + ".commit";
+
+    long committed = -1;
+    unsigned long long committedBlocks = 0;
+    std::ifstream commit(commitFile);
+    std::string line;
+    while (std::getline(commit, line)) {
+        if (line.rfind("offset=", 0) == 0) committed = std::stol(line.substr(7));
+        if (line.rfind("blocks=", 0) == 0) committedBlocks = std::stoull(line.substr(7));
+    }
+
+    long fileSize = 0;
+    long end = 0;
+    uint64_t blocks = 0;
+    {   // the reader is closed before the file is truncated
+        FileReader reader(binFile);
+        if (!reader.isOpen()) {
+            log->error("Could not open file {0}", binFile);
+            return false;
+        }
+        fileSize = reader.getFileSize();
+
+        Block block;
+        while (end < fileSize && reader.readNextBlock(block, end)) {
+            end = reader.currentPos;
+            blocks++;
+        }
+    }
+
+    if (committed >= 0) {
+        log->info("{}: {} bytes, {} blocks readable, {} bytes in {} blocks committed", binFile, fileSize, blocks, committed, committedBlocks);
+        if (end < committed) {
+            log->error("The file is damaged within the committed part at offset {}, not truncated", end);
+            return false;
+        }
+    } else {
+        log->warn("{}: no {}, {} bytes, {} blocks readable", binFile, commitFile, fileSize, blocks);
+    }
+
+    if (end == fileSize) {
+        log->info("{} is complete", binFile);
+        return true;
+    }
+
+    std::error_code error;
+    fs::resize_file(binFile, end, error);
+    if (error) {
+        log->error("Could not truncate {}: {}", binFile, error.message());
+        return false;
+    }
+    log->info("Truncated {} from {} to {} bytes, {} bytes of an incomplete block removed", binFile, fileSize, end, fileSize - end);
+    return true;
+}
+
+/**
+ * @brief Saves the state of a decoding next to the raw ROOT file.
+ *
+ * @param decoder The decoder, its file is saved first.
+ * @param reader The reader of the binary file.
+ * @param offset Position of the next block in the binary file.
+ * @param lastEvent Last decoded event ID.
+ * @param fileName The checkpoint file.
+ */
+void saveCheckpoint(DataDecoder& decoder, const FileReader& reader, long offset, uint32_t lastEvent, const std::string& fileName) {
+    DecoderCheckpoint state = decoder.checkpoint();
+    state.offset = offset;
+    state.readerFlag64 = reader.timestamps64();
+    state.lastEvent = lastEvent;
+    if (!state.save(fileName)) {
+        Logger::getLogger()->warn("Could not save checkpoint {}", fileName);
+    }
+}
+
+/**
+ * @brief Decodes the binary file of a run into the raw ROOT file.
+ *
+ * The decoding is checkpointed every checkpoint_interval_s. If an earlier
+ * decoding was interrupted, it continues at its last checkpoint. The
+ * checkpoint is kept, also after the last block, until the caller has
+ * finished the run and removes it.
+ *
+ * @param runNumber The run to decode.
+ * @param backend Output backend of the raw file.
+ * @param io I/O settings of the raw file.
+ * @return false if the binary file could not be opened.
+ */
+bool decodeRun(int runNumber, OutputBackend backend, const IOProfile& io) {
     auto log = Logger::getLogger();
     std::string binFile = getBinFilename(runNumber);
 
     FileReader reader(binFile);
     if (!reader.isOpen()) {
         log->error("Could not open file {0}", binFile);
-        return;
+        return false;
     }
 
-    DataDecoder decoder(getRootFilename(runNumber));
+    std::string checkpointFile = DecoderCheckpoint::fileName(getRootFilename(runNumber));
+    DecoderCheckpoint resume;
+    bool hasCheckpoint = resume.load(checkpointFile);
+    const auto checkpointInterval = std::chrono::seconds(getCheckpointInterval(backend, io));
+    auto lastCheckpoint = std::chrono::steady_clock::now();
 
-    log->info("Processing binary data ...");
+    DataDecoder decoder(getRootFilename(runNumber), backend, io, hasCheckpoint ? &resume : nullptr);
+
+    log->info("Processing binary data ({}) ...", outputBackendName(backend));
 
-    std::ifstream file(binFile, std::ios::binary);
     Block block;
     long last_pos = 0;
+    if (decoder.isResumed()) {
+        last_pos = resume.offset;
+        reader.setTimestamps64(resume.readerFlag64);
+        log->info("Continuing {} at byte {} of {}", binFile, last_pos, reader.getFileSize());
+    }
+
     while (reader.readNextBlock(block, last_pos)) {
         for (auto& bank : block.banks) {
             for (auto& event : bank.events) {
-                // log->debug("banks: {}, events in first bank: {}", block.banks.size(), block.banks[0].events.size());
                 decoder.processEvent(bank.bankName, event);
             }
-            // bank.events.clear();  // free per-bank
-            // bank.events.shrink_to_fit();
         }
         block.banks.clear();      // free per-block
         block.banks.shrink_to_fit();
-        decoder.autoSave(); // flush baskets to disk
+        decoder.endBlock(); // saves the tree every io_flush_every blocks
         last_pos = reader.currentPos;
+
+        if (checkpointInterval.count() > 0 && std::chrono::steady_clock::now() - lastCheckpoint >= checkpointInterval) {
+            saveCheckpoint(decoder, reader, last_pos, 0, checkpointFile);
+            lastCheckpoint = std::chrono::steady_clock::now();
+        }
     }
 
     log->info("Saving {}", binFile);
     decoder.writeTree();
-    decoder.flush();
+    if (checkpointInterval.count() > 0) {
+        saveCheckpoint(decoder, reader, last_pos, 0, checkpointFile);   // a failed sort does not need the decoding again
+    } else {
+        decoder.flush();
+    }
+    return true;    // the decoder writes and closes the raw file
+}
+
+/**
+ * @brief Converts the binary file of a run: decodes it into the raw ROOT
+ *        file, merges the TDC data and saves the filtered EventTree.
+ *
+ * @param runNumber The run to convert.
+ * @param summary If not null, the summary histograms are filled in the same event loop.
+ * @return false if the binary file could not be opened.
+ */
+bool convertRun(int runNumber, SummaryPlots* summary = nullptr) {
+    auto log = Logger::getLogger();
+    OutputBackend backend = getOutputBackend();
+    IOProfile io = getIOProfile();
+
+    if (!decodeRun(runNumber, backend, io)) return false;
 
     log->info("Sorting ROOT file, merging TDC Data ...");
-    DataFilter filter;
+    DataFilter filter(backend, io, getExportFormat());
+    filter.setTrackReco(getHodoGeometry());
     filter.fileSorter(getRootFilename(runNumber).c_str(), 0, getDataFilename(runNumber).c_str());
     log->info("Filtering ROOT file, saving as EventTree ...");
-    filter.filterAndSave(getDataFilename(runNumber).c_str(), 0);
-
-    createPlotsPython(runNumber);
+    filter.filterAndSave(getDataFilename(runNumber).c_str(), 0, summary);
 
+    std::filesystem::remove(DecoderCheckpoint::fileName(getRootFilename(runNumber)));
+    return true;
 }
 
-void runOfflineAnalysisAndSend(int runNumber) {
-    auto log = Logger::getLogger();
-    std::string binFile = getBinFilename(runNumber);
+/**
+ * @brief Saves the summary of a converted run: the histograms into the
+ *        data file and the plots to data/plots/<cusp>_run_<run>_*.
+ *
+ * @param runNumber The converted run.
+ * @param summary The summary filled by the event loop of the run.
+ * @param forGui If true, the plots and the overview of the run control
+ *               (data/tmp_events.png, tmp_bgo.png, tmp_overview.csv) are updated too.
+ */
+void saveSummary(int runNumber, SummaryPlots& summary, bool forGui) {
+    std::map<std::string, std::string> config = loadConfig();
+    std::string dataPath = config["daq_path"] + "data/";
 
-    FileReader reader(binFile);
-    if (!reader.isOpen()) {
-        log->error("Could not open file {0}", binFile);
-        return;
-    }
+    summary.write(getDataFilename(runNumber));
 
-    DataDecoder decoder(getRootFilename(runNumber));
+    std::ostringstream prefix;
+    prefix << dataPath << "plots/" << summary.cuspRunNumber() << "_run_"
+           << std::setw(5) << std::setfill('0') << runNumber;
+    summary.savePlots(prefix.str(), forGui ? dataPath + "tmp" : "");
+    if (forGui) summary.writeOverview(dataPath + "tmp_overview.csv", runNumber);
+}
 
-    log->info("Processing binary data ...");
+void runOfflineAnalysis(int runNumber) {
+    SummaryPlots summary(getBgoGeomFilename());
+    if (!convertRun(runNumber, &summary)) return;
 
-    std::ifstream file(binFile, std::ios::binary);
-    Block block;
-    long last_pos = 0;
-    while (reader.readNextBlock(block, last_pos)) {
-        for (auto& bank : block.banks) {
-            for (auto& event : bank.events) {
-                decoder.processEvent(bank.bankName, event);
-            }   
-        }
-        last_pos = reader.currentPos;
-    }
+    saveSummary(runNumber, summary, true);
+}
 
-    log->info("Saving {}", binFile);
-    decoder.writeTree();
-    decoder.flush();
+void runOfflineAnalysisAndSend(int runNumber) {
+    auto log = Logger::getLogger();
+    OutputBackend backend = getOutputBackend();
+    IOProfile io = getIOProfile();
+
+    if (!decodeRun(runNumber, backend, io)) return;
 
     zmq::context_t context(1);
     zmq::socket_t socket(context, ZMQ_PUB);
     socket.bind("tcp://*:5555");
 
     log->info("Sorting ROOT file, merging TDC Data ...");
-    DataFilter filter;
+    DataFilter filter(backend, io, getExportFormat());
+    filter.setTrackReco(getHodoGeometry());
     filter.fileSorter(getRootFilename(runNumber).c_str(), 0, getDataFilename(runNumber).c_str());
     log->info("Filtering ROOT file, saving as EventTree ...");
-    filter.filterAndSaveAndSend(getDataFilename(runNumber).c_str(), 0, socket);
+    SummaryPlots summary(getBgoGeomFilename());
+    filter.filterAndSaveAndSend(getDataFilename(runNumber).c_str(), 0, socket, &summary);
 
+    std::filesystem::remove(DecoderCheckpoint::fileName(getRootFilename(runNumber)));
+    saveSummary(runNumber, summary, true);
 }
 
 long processNewData(FileReader& reader, DataDecoder& decoder, long startPos, uint32_t& lastEvent) {
     Block block;
     long lastPos = startPos;
+    // Stops at the first block that is not completely written yet, it is read again next time
     while (reader.readNextBlock(block, lastPos)) {
         for (auto& bank : block.banks) {
             for (auto& event : bank.events) {
                 lastEvent = decoder.processEvent(bank.bankName, event);
             }
         }
+        decoder.endBlock();
         lastPos = reader.currentPos;
     }
     return lastPos;
 }
 
 
+/**
+ * @brief Live analysis of an ongoing run.
+ *
+ * The blocks are taken from the shared-memory ring of hodo_daq if it exists,
+ * otherwise the binary file is followed. Only new blocks are decoded. The
+ * decoded TDC and GATE entries are merged into events in memory and filtered
+ * one by one, so the work per update does not grow with the run length. The
+ * passing events are filled into monitoring histograms, the GUI gets a
+ * snapshot of them every monitor_interval_ms instead of the single events.
+ *
+ * Reading from the ring never slows down the DAQ, blocks this process is too
+ * slow for are lost for the live view. The ROOT files are therefore made from
+ * the binary file once the run has ended. When following the binary file the
+ * raw ROOT file is written along the way instead.
+ *
+ * @param runNumber The run to follow, it is ongoing while its lockfile exists.
+ */
 void runLiveAnalysis(int runNumber) {
     auto log = Logger::getLogger();
     std::string binFile = getBinFilename(runNumber);
@@ -247,98 +496,384 @@ void runLiveAnalysis(int runNumber) {
         std::this_thread::sleep_for(std::chrono::milliseconds(1000));
     }
 
+    zmq::context_t context(1);
+    zmq::socket_t socket(context, ZMQ_PUB);
+    socket.bind("tcp://*:5555");
+
+    OutputBackend backend = getOutputBackend();
+    IOProfile io = getIOProfile();
+    DataFilter filter(backend, io, getExportFormat());
+    GuiPublisher publisher(socket);
+    MonitorHistograms monitor;
+    const auto snapshotInterval = std::chrono::milliseconds(getMonitorInterval());
+    auto lastSnapshot = std::chrono::steady_clock::now();
+    LiveEventBuilder builder;
+    TickSizes ticks;            // the decoder writes the default tick sizes
+    std::vector<TDCEvent> ready;
+    FilteredEvent result;
+
+    // Filters the finished events into the monitoring histograms, sent to the GUI at a fixed cadence
+    auto publishReady = [&]() {
+        for (const auto& event : ready) {
+            if (filter.filterEvent(event, ticks, result)) monitor.fill(result);
+        }
+        ready.clear();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSnapshot >= snapshotInterval) {
+            publisher.sendSnapshot(monitor);
+            lastSnapshot = now;
+        }
+    };
+
+    // Last snapshot and the event counts of the run
+    auto publishEnd = [&]() {
+        publisher.sendSnapshot(monitor);
+        publisher.sendEnd(monitor.snapshot().eventsCut, monitor.snapshot().eventsCutGate);
+    };
+
+    log->debug("Lockfile: {}", lockfile);
+
+    std::string ringName = getShmRingName();
+    ShmRingReader ring(ringName);
+
+    if (ring.isOpen()) {
+        log->info("Reading blocks from shared-memory ring {}", ringName);
+
+        DataDecoder decoder;    // no raw file, the run is converted from the binary file at the end
+        decoder.setFragmentCallback([&builder](const TDCEvent& fragment) { builder.addFragment(fragment); });
+        FileReader parser;
+        std::vector<uint32_t> data;
+        Block block;
+        uint32_t blockID, blockRun;
+        uint64_t lostReported = 0;
+        const int pollingInterval = 100; // ms
+
+        // Decodes all blocks of this run that are in the ring, returns the number of blocks
+        auto drainRing = [&]() {
+            size_t nBlocks = 0;
+            ShmRingReader::Status status;
+            while ((status = ring.read(data, blockID, blockRun)) != ShmRingReader::Status::Empty) {
+                if (status == ShmRingReader::Status::Lost) continue;
+                if (blockRun != (uint32_t)runNumber || !parser.readBlock(data, block)) continue;
+                for (auto& bank : block.banks) {
+                    for (auto& event : bank.events) {
+                        decoder.processEvent(bank.bankName, event);
+                    }
+                }
+                nBlocks++;
+            }
+            return nBlocks;
+        };
+
+        while (std::filesystem::exists(lockfile)) {
+            if (drainRing() > 0) {
+                builder.takeReady(ready);
+                publishReady();
+            }
+            if (ring.lostBlocks() != lostReported) {
+                lostReported = ring.lostBlocks();
+                log->warn("Live analysis too slow, {} blocks lost from the ring so far", lostReported);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(pollingInterval));
+        }
+
+        drainRing();
+        builder.flush(ready);
+        publishReady();
+
+        try {
+            convertRun(runNumber);
+        } catch (...) {
+            log->error("File {} could not be saved.", getDataFilename(runNumber).c_str());
+        }
+
+        publishEnd();
+        log->debug("Lockfile does not exist, run {:d} is not ongoing.", runNumber);
+        return;
+    }
+
+    log->info("Shared-memory ring {} not available, following {}", ringName, binFile);
+
     FileReader reader(binFile);
     if (!reader.isOpen()) {
         log->error("Could not open file {}", binFile);
         return;
     }
+    reader.watch();
 
-    zmq::context_t context(1);
-    zmq::socket_t socket(context, ZMQ_PUB);
-    socket.bind("tcp://*:5555");
-
-    DataDecoder decoder(getRootFilename(runNumber));
-    std::string rawRoot = getRootFilename(runNumber);
-    std::string tmpRoot = rawRoot + ".tmp";
-
-    const int pollingInterval = 1000; // ms
+    const int pollingInterval = 1000; // ms, longest wait if no file change is reported
     long last_pos = 0;
-    uint32_t last_event = 0;
     uint32_t this_event = 0;
-    size_t last_size = 0;
 
-    log->debug("Lockfile: {}", lockfile);
+    // a restarted live analysis continues the raw file, the histograms start empty
+    std::string checkpointFile = DecoderCheckpoint::fileName(getRootFilename(runNumber));
+    DecoderCheckpoint resume;
+    bool hasCheckpoint = resume.load(checkpointFile);
+    const auto checkpointInterval = std::chrono::seconds(getCheckpointInterval(backend, io));
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+
     log->info("Processing binary data ...");
-    
-    while (std::filesystem::exists(lockfile)) {
-        std::ifstream file(binFile, std::ios::binary | std::ios::ate);
-        if (!file.is_open()) {
-            log->warn("File closed or unavailable, retrying...");
-            std::this_thread::sleep_for(std::chrono::milliseconds(pollingInterval));
-            continue;
+
+    {
+        DataDecoder decoder(getRootFilename(runNumber), backend, io, hasCheckpoint ? &resume : nullptr);
+        decoder.setFragmentCallback([&builder](const TDCEvent& fragment) { builder.addFragment(fragment); });
+        if (decoder.isResumed()) {
+            last_pos = resume.offset;
+            this_event = resume.lastEvent;
+            reader.setTimestamps64(resume.readerFlag64);
+            log->info("Continuing {} at byte {}", binFile, last_pos);
         }
-    
-        size_t this_size = file.tellg();
-        file.close();
-
-        if (this_size > last_size && this_size%4 == 0) {
-            log->info("New data detected, processing...");
-            decoder.openFile();     // added while debugging
-
-            last_pos = processNewData(reader, decoder, last_pos, this_event);
-
-            log->info("Saving {}", binFile);
-            decoder.writeTree();
-            decoder.flush();
-            decoder.closeFile();    // added while debugging
-            last_size = this_size;
-
-            // Ensure full flush to disk
-            while (!decoder.fsyncFile(rawRoot)) {
-                log->error("Could not fsync file before copying!");
-                std::this_thread::sleep_for(std::chrono::milliseconds(200));
-                // return; // or handle appropriately
-            }
 
-            std::ifstream src(rawRoot, std::ios::binary);
-            std::ofstream dst(tmpRoot, std::ios::binary);
-            dst << src.rdbuf();
+        while (std::filesystem::exists(lockfile)) {
+            long pos = processNewData(reader, decoder, last_pos, this_event);
 
-            while (!decoder.isFullyWritten(tmpRoot)) {
-                log->error("File still being copied");
-                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            if (pos != last_pos) {
+                builder.takeReady(ready);
+                log->debug("Decoded {} bytes, {} events ready, {} pending", pos - last_pos, ready.size(), builder.pending());
+                publishReady();
+                last_pos = pos;
             }
 
-            log->info("Sorting ROOT file, merging TDC Data ...");
-            DataFilter filter;
-            filter.fileSorter(tmpRoot.c_str(), last_event, getDataFilename(runNumber).c_str()); // getRootFilename(runNumber).c_str()
-            log->info("Filtering ROOT file, sending to GUI ...");
-            filter.filterAndSend(getDataFilename(runNumber).c_str(), last_event, socket);
-
-            std::filesystem::remove(tmpRoot);
-            last_event = this_event;
+            if (checkpointInterval.count() > 0 && std::chrono::steady_clock::now() - lastCheckpoint >= checkpointInterval) {
+                saveCheckpoint(decoder, reader, last_pos, this_event, checkpointFile);
+                lastCheckpoint = std::chrono::steady_clock::now();
+            }
 
+            reader.waitForData(pollingInterval);
         }
-        
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(pollingInterval));
 
-    }
+        // The run has ended, read what was written after the last update
+        processNewData(reader, decoder, last_pos, this_event);
+        builder.flush(ready);
+        publishReady();
+
+        log->info("Saving {}", getRootFilename(runNumber));
+    }   // the decoder writes and closes the raw file
 
     try {
+        log->info("Sorting ROOT file, merging TDC Data ...");
+        filter.fileSorter(getRootFilename(runNumber).c_str(), 0, getDataFilename(runNumber).c_str());
         log->info("Filtering ROOT file, saving as EventTree ...");
-        DataFilter filter;
         filter.filterAndSave(getDataFilename(runNumber).c_str(), 0);
+        std::filesystem::remove(checkpointFile);
     } catch (...) {
         log->error("File {} could not be saved.", getDataFilename(runNumber).c_str());
     }
 
+    publishEnd();
 
     log->debug("Lockfile does not exist, run {:d} is not ongoing.", runNumber);
 
 }
 
 
+/**
+ * @brief Decodes the binary file of a run once for every I/O profile and
+ *        writes decode throughput and file size of each to a CSV file.
+ *
+ * The ROOT files written by the benchmark are removed again, the CSV is
+ * saved as io_benchmark_<run>.csv in the ana_path.
+ *
+ * @param runNumber The run to decode.
+ */
+void runIOBenchmark(int runNumber) {
+    auto log = Logger::getLogger();
+    std::string binFile = getBinFilename(runNumber);
+    long binSize = get_file_size(binFile);
+
+    if (binSize <= 0) {
+        log->error("Could not open file {0}", binFile);
+        return;
+    }
+
+    OutputBackend backend = getOutputBackend();
+    std::string csvFile = getBenchmarkFilename(runNumber);
+    std::ofstream csv(csvFile);
+    csv << "profile,backend,cluster_size,basket_size,compression,compression_level,flush_every,"
+        << "decode_s,events,bin_MB_per_s,events_per_s,file_bytes,compression_ratio\n";
+
+    for (const auto& [name, io] : benchmarkProfiles(getIOProfile())) {
+        FileReader reader(binFile);
+        if (!reader.isOpen()) {
+            log->error("Could not open file {0}", binFile);
+            return;
+        }
+
+        std::string outFile = getRootFilename(runNumber) + ".bench_" + name;
+        long nEvents = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        {
+            DataDecoder decoder(outFile, backend, io);
+            Block block;
+            long last_pos = 0;
+            while (reader.readNextBlock(block, last_pos)) {
+                for (auto& bank : block.banks) {
+                    for (auto& event : bank.events) {
+                        decoder.processEvent(bank.bankName, event);
+                    }
+                    nEvents += bank.events.size();
+                }
+                block.banks.clear();
+                decoder.endBlock();
+                last_pos = reader.currentPos;
+            }
+        }   // the decoder writes and closes the file
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        long fileBytes = get_file_size(outFile);
+        std::filesystem::remove(outFile);
+
+        double mbPerSec = binSize / 1e6 / seconds;
+        double eventsPerSec = nEvents / seconds;
+        double ratio = (fileBytes > 0) ? static_cast<double>(binSize) / fileBytes : 0.;
+
+        log->info("{:<13} {:.2f} s | {:.1f} MB/s | {:.0f} events/s | {} bytes | ratio {:.2f} | {}",
+            name, seconds, mbPerSec, eventsPerSec, fileBytes, ratio, io.describe());
+
+        csv << name << "," << outputBackendName(backend) << ","
+            << io.clusterSize << "," << io.basketSize << ","
+            << io.compressionName() << "," << io.compressionLevel << "," << io.flushEvery << ","
+            << seconds << "," << nEvents << "," << mbPerSec << "," << eventsPerSec << ","
+            << fileBytes << "," << ratio << "\n";
+    }
+
+    log->info("I/O benchmark saved to {}", csvFile);
+}
+
+/**
+ * @brief Parses a list of runs like "533-540,545".
+ *
+ * @param spec Comma separated run numbers and inclusive ranges.
+ * @return the runs in the given order, without duplicates.
+ * @throws std::invalid_argument if an entry is not a run or a range.
+ */
+std::vector<int> parseRunList(const std::string& spec) {
+    std::vector<int> runs;
+    std::istringstream ss(spec);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) continue;
+        size_t dash = item.find('-', 1);
+        size_t used = 0;
+        int first = std::stoi(item, &used);
+        int last = first;
+        if (dash != std::string::npos) {
+            if (used != dash) throw std::invalid_argument("bad run range " + item);
+            last = std::stoi(item.substr(dash + 1), &used);
+            used += dash + 1;
+        }
+        if (used != item.size() || first < 0 || last < first) throw std::invalid_argument("bad run range " + item);
+        for (int run = first; run <= last; run++) {
+            if (std::find(runs.begin(), runs.end(), run) == runs.end()) runs.push_back(run);
+        }
+    }
+    return runs;
+}
+
+struct BatchRun {
+    explicit BatchRun(int run) : run(run) {}
+
+    int run;
+    std::string status = "pending";     // pending, running, done, failed
+    double seconds = 0;
+    long binBytes = 0;
+    std::string error;
+};
+
+/**
+ * @brief Writes the status of all runs of a batch to a CSV file, replacing
+ *        it atomically so it can be watched while the batch runs.
+ */
+void writeBatchStatus(const std::vector<BatchRun>& runs, const std::string& fileName) {
+    std::string tmpName = fileName + ".tmp";
+    {
+        std::ofstream csv(tmpName);
+        csv << "run,status,seconds,bin_MB,error\n";
+        for (const auto& r : runs) {
+            csv << r.run << "," << r.status << "," << r.seconds << "," << r.binBytes / 1e6 << ",\"" << r.error << "\"\n";
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmpName, fileName, ec);
+    if (ec) Logger::getLogger()->error("Could not write {}: {}", fileName, ec.message());
+}
+
+/**
+ * @brief Converts several runs in one process, jobs of them at a time.
+ *
+ * ROOT is set up once, the runs share the implicit multi-threading pool for
+ * their RDataFrame loops. The status of every run is kept in
+ * batch_status.csv in the ana_path, updated whenever a run starts or ends.
+ * The summary of every run is saved, the files shown by the run control are
+ * left as they are.
+ *
+ * @param runs The runs to convert.
+ * @param jobs Number of runs converted at the same time.
+ * @return the number of runs that failed.
+ */
+int runBatch(const std::vector<int>& runs, unsigned int jobs) {
+    auto log = Logger::getLogger();
+    std::string statusFile = getBatchStatusFilename();
+
+    std::vector<BatchRun> status;
+    for (int run : runs) status.emplace_back(run);
+    std::mutex statusMutex;
+    writeBatchStatus(status, statusFile);
+
+    jobs = std::max(1u, std::min<unsigned int>(jobs, runs.size()));
+    if (jobs > 1) ROOT::EnableThreadSafety();   // already on with implicit MT, needed for single-threaded loops
+    log->info("Converting {} runs, {} at a time, status in {}", runs.size(), jobs, statusFile);
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < status.size(); i = next++) {
+            int run = status[i].run;
+            {
+                std::lock_guard<std::mutex> lock(statusMutex);
+                status[i].status = "running";
+                status[i].binBytes = std::max(0L, get_file_size(getBinFilename(run)));
+                writeBatchStatus(status, statusFile);
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            bool ok = false;
+            std::string error;
+            try {
+                SummaryPlots summary(getBgoGeomFilename());
+                ok = convertRun(run, &summary);
+                if (ok) saveSummary(run, summary, false);
+                if (!ok) error = "could not open binary file";
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (ok) {
+                log->info("Run {} converted in {:.1f} s", run, seconds);
+            } else {
+                log->error("Run {} failed after {:.1f} s: {}", run, seconds, error);
+            }
+
+            std::lock_guard<std::mutex> lock(statusMutex);
+            status[i].status = ok ? "done" : "failed";
+            status[i].seconds = seconds;
+            status[i].error = error;
+            writeBatchStatus(status, statusFile);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int j = 0; j < jobs; j++) workers.emplace_back(worker);
+    for (auto& t : workers) t.join();
+
+    int failed = std::count_if(status.begin(), status.end(), [](const BatchRun& r) { return r.status != "done"; });
+    log->info("Batch finished: {} of {} runs converted", status.size() - failed, status.size());
+    return failed;
+}
+
 
 int main(int argc, char* argv[]) {
 
@@ -350,20 +885,57 @@ int main(int argc, char* argv[]) {
 
     bool liveMode = false;
     bool afterMode = false;
+    bool benchmarkMode = false;
+    bool recoverMode = false;
 
     if (argc < 2) {
-        log->error("Usage: ./hodo_analysis <run_number>");
+        log->error("Usage: ./hodo_analysis [-l|-a|-b|-r] <run_number>");
+        log->error("       ./hodo_analysis -B <runs, e.g. 533-540,545> [jobs]");
         return 1;
     }
 
     int argIndex = 1;
 
+    if (std::string(argv[1]) == "-B") {
+        if (argc < 3) {
+            log->error("Error: Missing runs.");
+            return 1;
+        }
+        std::vector<int> runs;
+        try {
+            runs = parseRunList(argv[2]);
+        } catch (const std::exception& e) {
+            log->error("Invalid runs {}: {}", argv[2], e.what());
+            return 1;
+        }
+        if (runs.empty()) {
+            log->error("Error: Missing runs.");
+            return 1;
+        }
+        log->info("Running in BATCH mode.");
+
+        std::map<std::string, std::string> config = loadConfig();
+        unsigned int nThreads = config.count("analysis_threads") ? std::stoul(config["analysis_threads"]) : 0;
+        unsigned int jobs = config.count("batch_jobs") ? std::stoul(config["batch_jobs"]) : 0;
+        if (argc > 3) jobs = std::stoul(argv[3]);
+        if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+        DataFilter::enableMultiThreading(nThreads);
+
+        return runBatch(runs, jobs) == 0 ? 0 : 1;
+    }
+
     if (std::string(argv[1]) == "-l") {
         liveMode = true;
         argIndex++;
     } else if (std::string(argv[1]) == "-a") {
         afterMode = true;
         argIndex++;
+    } else if (std::string(argv[1]) == "-b") {
+        benchmarkMode = true;
+        argIndex++;
+    } else if (std::string(argv[1]) == "-r") {
+        recoverMode = true;
+        argIndex++;
     }
 
     if (argIndex >= argc) {
@@ -378,17 +950,32 @@ int main(int argc, char* argv[]) {
         log->info("Running in LIVE mode.");
     } else if (afterMode) {
         log->info("Running in AFTER RUN mode.");
+    } else if (benchmarkMode) {
+        log->info("Running in I/O BENCHMARK mode.");
+    } else if (recoverMode) {
+        log->info("Running in RECOVER mode.");
     } else {
         log->info("Running in OFFLINE mode.");
     }
     // log->info("Running in {} mode.", (liveMode ? "LIVE" : "OFFLINE"));
     log->info("Analyzing run: {:d}", runNumber);
 
+    if (recoverMode) {
+        return recoverRun(runNumber) ? 0 : 1;
+    }
+
+    // Number of threads for the RDataFrame event loop, 0 uses all cores
+    std::map<std::string, std::string> config = loadConfig();
+    unsigned int nThreads = config.count("analysis_threads") ? std::stoul(config["analysis_threads"]) : 0;
+    DataFilter::enableMultiThreading(nThreads);
+
     // Now you can call your main logic:
     if (liveMode) {
         runLiveAnalysis(runNumber);
     } else if (afterMode) {
         runOfflineAnalysisAndSend(runNumber);
+    } else if (benchmarkMode) {
+        runIOBenchmark(runNumber);
     } else {
         runOfflineAnalysis(runNumber);
     }
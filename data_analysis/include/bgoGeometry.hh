@@ -0,0 +1,53 @@
+#ifndef BGOGEOMETRY_H
+#define BGOGEOMETRY_H
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include <TH2Poly.h>
+#include <ROOT/RVec.hxx>
+
+// Hits and summed ToT per BGO channel, filled from the bgoToT column
+struct BgoHitMap {
+    static constexpr int N_CHANNELS = 64;
+
+    std::array<ULong64_t, N_CHANNELS> hits{};
+    std::array<Double_t, N_CHANNELS> totSum{};     // ns
+
+    void fill(const ROOT::RVec<Double_t>& bgoToT);
+    void merge(const BgoHitMap& other);
+};
+
+/*
+ * Positions of the BGO channels from config/bgo_geom.csv, read once into
+ * dense tables by channel: the centre in mm and the bin of the channel in the
+ * hit maps. Channels missing in the file have no bin.
+ */
+class BgoGeometry {
+public:
+    static constexpr int N_CHANNELS = BgoHitMap::N_CHANNELS;
+    static constexpr double CHANNEL_W = 10.;    // mm, size of a channel in the hit map
+    static constexpr double CHANNEL_H = 5.;
+    static constexpr double RADIUS = 45.;       // mm, radius of the BGO disc
+
+    static const BgoGeometry& get(const std::string& fileName);
+
+    bool isLoaded() const { return loaded; }
+    double x(int channel) const { return posX[channel]; }
+    double y(int channel) const { return posY[channel]; }
+    int bin(int channel) const { return bins[channel]; }
+
+    std::unique_ptr<TH2Poly> makeMap(const char* name, const char* title) const;
+    std::unique_ptr<TH2Poly> hitMap(const BgoHitMap& map, bool totWeighted, const char* name, const char* title) const;
+
+private:
+    BgoGeometry(const std::string& fileName);
+
+    bool loaded = false;
+    std::array<double, N_CHANNELS> posX;
+    std::array<double, N_CHANNELS> posY;
+    std::array<int, N_CHANNELS> bins;           // bin of each channel in makeMap, 0 without position
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <vector>
 #include <cstdint>
+#include <functional>
 #include <cmath>  // For std::nan
 #include <fcntl.h>      // open
 #include <unistd.h>     // fsync, close
@@ -17,12 +18,21 @@
 
 #include "fileReader.hh"
 #include "tdcEvent.hh"
+#include "eventNTuple.hh"
+#include "ioProfile.hh"
+#include "scalerTree.hh"
+#include "deadTimeTree.hh"
+#include "onlineFilterTree.hh"
+#include "decoderCheckpoint.hh"
 
 
 // DataDecoder Class
 class DataDecoder {
 public:
-    DataDecoder(const std::string& outputFile);
+    DataDecoder();      // No output file, the entries only go to the fragment callback
+    // With resume, the raw file of the checkpoint is continued if it matches (TTree backend only)
+    DataDecoder(const std::string& outputFile, OutputBackend backend = OutputBackend::TTree, const IOProfile& io = IOProfile(),
+                const DecoderCheckpoint* resume = nullptr);
     ~DataDecoder();
     
     void processBlock(const std::vector<uint32_t>& rawData);  // Decode and store data
@@ -32,17 +42,39 @@ public:
     constexpr int getChannel(int ch);
     void flush();
     void autoSave();
+    void endBlock();
+    void setFragmentCallback(std::function<void(const TDCEvent&)> callback) { fragmentCallback = std::move(callback); }
     const char* getFileName() { return fileName.c_str(); }
     void closeFile();
     void openFile();
     bool fsyncFile(const std::string& fileName);
     Long64_t checkFileSize(const std::string& fileName);
     bool isFullyWritten(const std::string& fileName);
+    bool isResumed() const { return resumed; }
+    DecoderCheckpoint checkpoint();     // flushes the file, the caller adds the FileReader state
 
 private:
-    TFile* rootFile;
-    TTree* tree;
+    void fillEvent();
+    void bindBranches(bool attach);
+    bool openForResume(const DecoderCheckpoint& resume);
+    void restore(const DecoderCheckpoint& state);
+
+    TFile* rootFile = nullptr;
+    TTree* tree = nullptr;
+    OutputBackend backend;
+    IOProfile io;
+    long blocksSinceSave = 0;
+    bool resumed = false;
+    std::function<void(const TDCEvent&)> fragmentCallback;     // called with every filled entry
+    std::unique_ptr<RNT::RNTupleWriter> ntupleWriter;
+    std::unique_ptr<RNT::REntry> ntupleEntry;
+    std::unique_ptr<ScalerTree> scalerTree;
+    std::unique_ptr<DeadTimeTree> deadTimeTree;
+    std::unique_ptr<OnlineFilterTree> onlineFilterTree;
     TDCEvent event;
+    ScalerEvent scaler;
+    DeadTimeEvent deadTime;
+    OnlineFilterEvent onlineFilter;
     int32_t ch, rawch;
     int le_te;
     int tdcID;
@@ -9,20 +9,47 @@
 #include <cmath>    
 #include <cstddef>  
 #include <zmq.hpp>
+#include <ROOT/RDataFrame.hxx>
 #include "dataDecoder.hh"
+#include "eventExport.hh"
+#include "eventNTuple.hh"
+#include "ioProfile.hh"
 #include "logger.hh"
+#include "summaryPlots.hh"
 #include "tdcEvent.hh"
+#include "trackReco.hh"
+
+// Filter result of one event, the columns filled into the monitoring histograms
+struct FilteredEvent {
+    UInt_t eventID;
+    Double_t tdcTimeTag_ns;
+    Bool_t mixGate;
+    ROOT::RVec<Double_t> bgoToT;    // ns, NaN for channels without hit
+    ROOT::RVec<Double_t> barOToT;   // ns, outer bars with a coincidence of both ends
+    ROOT::RVec<Double_t> barIToT;
+};
 
 class DataFilter {
 public:
-    DataFilter(){};
+    DataFilter(OutputBackend backend = OutputBackend::TTree, const IOProfile& io = IOProfile(), ExportFormat exportFormat = ExportFormat::None)
+        : backend(backend), io(io), exportFormat(exportFormat) {};
     ~DataFilter(){};
+    static void enableMultiThreading(unsigned int nThreads);
+    ROOT::RDF::RNode buildFilterGraph(ROOT::RDF::RNode df, int last_evt, const TickSizes& ticks);
+    void setTrackReco(const HodoGeometry& geometry) { hodo = geometry; }
+    void runFilter(const char* inputFile, int last_evt, bool save, zmq::socket_t* socket, bool sendEnd, SummaryPlots* summary = nullptr);
     void filterAndSend(const char* inputFile, int last_evt, zmq::socket_t& socket);
-    void filterAndSaveAndSend(const char* inputFile, int last_evt, zmq::socket_t& socket);
-    void filterAndSave(const char* inputFile, int last_evt);
+    void filterAndSaveAndSend(const char* inputFile, int last_evt, zmq::socket_t& socket, SummaryPlots* summary = nullptr);
+    void filterAndSave(const char* inputFile, int last_evt, SummaryPlots* summary = nullptr);
     void fileSorter(const char* inputFile, int last_evt, const char* outputFileName);
-    void convertTime(TDCEvent& event);
+    static void mergeFragment(TDCEvent& out, const TDCEvent& in, int tdc);
+    bool filterEvent(const TDCEvent& event, const TickSizes& ticks, FilteredEvent& out) const;
 private:
+    OutputBackend backend;
+    IOProfile io;
+    ExportFormat exportFormat;      // columnar copy of the EventTree next to the ROOT file
+    HodoGeometry hodo;              // track reconstruction, off unless set
+    ROOT::RDF::RNode defineTracks(ROOT::RDF::RNode df, const TickSizes& ticks) const;
     const Double_t LE_CUT = 400.;   // ns
     const Double_t ToT_CUT = 200.;  // ns 
 };
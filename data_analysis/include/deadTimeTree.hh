@@ -0,0 +1,46 @@
+#ifndef DEADTIMETREE_H
+#define DEADTIMETREE_H
+
+#include <vector>
+#include <cstdint>
+
+#include <TTree.h>
+#include <TDirectory.h>
+
+#define LIVE_WORDS 10            // files before the queue vetoes, 11 words since
+
+// Dead time of the run up to one block, from the LIVE bank of hodo_daq. All
+// values are counted since the run start.
+struct DeadTimeEvent {
+    Double_t timestamp;             // s since the epoch, DAQ clock when the block was started
+    UInt_t cuspRunNumber;
+    Double_t runTime_s;
+    Double_t vetoTime_s;            // VME veto on
+    Double_t busyTime_s;            // from almost full until all modules were read out
+    UInt_t busyCycles;
+    UInt_t recordedEvents;          // entries of the GATE lists
+    UInt_t triggers;                // trigger_cnt and gated_cnt of the last scaler readout
+    UInt_t gated;
+    Double_t liveFraction;          // 1 - vetoTime_s / runTime_s
+    UInt_t queueVetoes;             // vetoes because the queues of the DAQ were full, part of vetoTime_s
+
+    bool decode(const std::vector<uint32_t>& data, uint64_t timestamp_ns);
+};
+
+// DeadTimeTree next to the RawEventTree, one entry per block
+class DeadTimeTree {
+public:
+    DeadTimeTree(TDirectory* dir);
+
+    void fill(const DeadTimeEvent& deadTime);
+    void write();
+    Long64_t entries() const { return tree ? tree->GetEntries() : 0; }
+
+    static void copy(TDirectory* from, TDirectory* to);
+
+private:
+    TTree* tree = nullptr;
+    DeadTimeEvent entry{};
+};
+
+#endif
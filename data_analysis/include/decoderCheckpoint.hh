@@ -0,0 +1,42 @@
+#ifndef DECODERCHECKPOINT_H
+#define DECODERCHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+
+#include <RtypesCore.h>
+
+// State of a decoding after a block, saved next to the raw ROOT file
+// (<raw file>.ckpt) so an interrupted decoding continues at this block
+// instead of at the start of the binary file. Only valid together with the
+// raw file as it was when the checkpoint was written, the tree entries are
+// kept to check that.
+struct DecoderCheckpoint {
+    // FileReader
+    long offset = 0;                    // position of the next block in the binary file
+    bool readerFlag64 = false;          // 64 bit GATE timestamps
+    uint32_t lastEvent = 0;
+
+    // entries of the trees in the raw file
+    Long64_t rawEntries = 0;
+    Long64_t scalerEntries = 0;
+    Long64_t deadTimeEntries = 0;
+    Long64_t filterEntries = 0;
+
+    // DataDecoder: event ID and time tag unwrapping, CUSP and time context
+    int32_t last_evt[4] = {0};
+    int32_t reset_ctr[4] = {0};
+    uint32_t last_timetag[4] = {0};
+    int32_t reset_ctr_time[4] = {0};
+    int32_t cuspValue = 0;
+    Double_t secTime = 0;
+    Double_t nsecTime = 0;
+    bool gateValue = false;
+
+    bool save(const std::string& fileName) const;
+    bool load(const std::string& fileName);
+
+    static std::string fileName(const std::string& rawFile) { return rawFile + ".ckpt"; }
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef EVENTEXPORT_H
+#define EVENTEXPORT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ROOT/RDataFrame.hxx>
+
+// Columnar copy of the EventTree next to the ROOT file, set by export_format
+enum class ExportFormat {
+    None,
+    Arrow,      // Arrow IPC file, uncompressed so it can be memory-mapped
+    Parquet
+};
+
+ExportFormat parseExportFormat(const std::string& name);
+const char* exportFormatName(ExportFormat format);
+std::string exportFileName(const std::string& rootFile, ExportFormat format);
+bool exportAvailable();
+
+#ifdef HODO_WITH_ARROW
+
+#include <ROOT/RDF/RActionImpl.hxx>
+
+class TTreeReader;
+
+namespace arrow {
+class RecordBatch;
+class RecordBatchBuilder;
+class Schema;
+}
+
+/*
+ * RDataFrame action writing the filtered events to an Arrow IPC or Parquet
+ * file. It is booked next to the EventTree snapshot and runs in the same
+ * event loop: every slot fills its own builders, full record batches are
+ * written as they come, so the file holds the events in the order of the
+ * event loop, not sorted by eventID with implicit MT.
+ *
+ * The result is the number of events written.
+ */
+class ArrowEventWriter : public ROOT::Detail::RDF::RActionImpl<ArrowEventWriter> {
+public:
+    using Result_t = ULong64_t;
+
+    static constexpr int64_t BATCH_ROWS = 65536;
+
+    ArrowEventWriter(const std::string& fileName, ExportFormat format, unsigned int nSlots);
+    ArrowEventWriter(ArrowEventWriter&&);
+    ~ArrowEventWriter();
+
+    static ROOT::RDF::RResultPtr<ULong64_t> book(ROOT::RDF::RNode df, const std::string& fileName, ExportFormat format);
+
+    void Initialize();
+    void InitTask(TTreeReader*, unsigned int) {}
+    template <typename... Cols>
+    void Exec(unsigned int slot, const Cols&... cols);
+    void Finalize();
+    std::shared_ptr<Result_t> GetResultPtr() const { return result; }
+    std::string GetActionName() { return "ArrowEventWriter"; }
+
+private:
+    struct Output;
+
+    void flushSlot(unsigned int slot);
+
+    std::string fileName;
+    ExportFormat format;
+    std::shared_ptr<arrow::Schema> schema;
+    std::vector<std::unique_ptr<arrow::RecordBatchBuilder>> builders;   // one per slot
+    std::unique_ptr<Output> output;                                     // file writer and its mutex
+    std::shared_ptr<Result_t> result;
+};
+
+#endif  // HODO_WITH_ARROW
+
+#endif
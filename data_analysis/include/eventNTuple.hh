@@ -0,0 +1,36 @@
+#ifndef EVENTNTUPLE_H
+#define EVENTNTUPLE_H
+
+#include <memory>
+#include <string>
+
+#include <RVersion.h>
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleReader.hxx>
+#include <ROOT/RNTupleWriter.hxx>
+
+#include "tdcEvent.hh"
+
+// RNTuple left ROOT::Experimental with ROOT 6.36, 6.34 is the oldest supported version
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 36, 0)
+namespace RNT = ROOT;
+#else
+namespace RNT = ROOT::Experimental;
+#endif
+
+// Output backend of the raw and merged event data
+enum class OutputBackend {
+    TTree,
+    RNTuple
+};
+
+OutputBackend parseOutputBackend(const std::string& name);
+const char* outputBackendName(OutputBackend backend);
+
+// Same fields and field names as the RawEventTree branches
+std::unique_ptr<RNT::RNTupleModel> makeEventModel();
+void bindEvent(RNT::REntry& entry, TDCEvent& event);
+
+bool isNTuple(TDirectory* dir, const char* name);
+
+#endif
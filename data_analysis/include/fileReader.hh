@@ -57,18 +57,27 @@ struct Block {
 // File Reader Class
 class FileReader {
 public:
+    FileReader() {};                                  // Only for parsing blocks from memory
     FileReader(const std::string& filename);
+    ~FileReader();
     bool readNextBlock(Block& block, long startPos);  // Read the next block of data
+    bool readBlock(const std::vector<uint32_t>& data, Block& block);   // Parse a serialized block
+    bool watch();                                     // Start watching the file for new data
+    bool waitForData(int timeout_ms);                 // Block until the file was modified or timeout
     bool isOpen() const;
     long getFileSize();
+    bool timestamps64() const { return flag64; }      // for checkpoints
+    void setTimestamps64(bool on) { flag64 = on; }
     long currentPos;
 
 private:
     std::ifstream file;
-    bool readDataBank(DataBank& bank);
-    bool resyncToNextBank(std::ifstream& file, std::string& bankNameOut);
-    const std::string& filename = "";
+    bool readBlock(std::istream& in, Block& block);
+    bool readDataBank(std::istream& in, DataBank& bank);
+    bool resyncToNextBank(std::istream& in, std::string& bankNameOut);
+    std::string filename;
     bool flag64 = false;
+    int inotifyFd = -1;
     
 };
 
@@ -0,0 +1,116 @@
+#ifndef FILTERKERNELS_H
+#define FILTERKERNELS_H
+
+#include <vector>
+#include <cmath>
+#include <functional>
+#include <ROOT/RVec.hxx>
+
+#include "tdcEvent.hh"
+
+// Per-event kernels of the filter, used by the RDataFrame graph and the live filter
+
+template <size_t N>
+ROOT::VecOps::RVec<Double_t> computeToT(const ROOT::RVec<Int_t>& le, 
+                                        const ROOT::RVec<Int_t>& te,
+                                        Double_t tick_ns) {
+    ROOT::VecOps::RVec<Double_t> tot(N);
+    for (size_t i = 0; i < N; ++i) {
+        tot[i] = (le[i] > 0 && te[i] > le[i]) ? (te[i] - le[i]) * tick_ns : NAN;
+    }
+    return tot;
+}
+
+// Binds the tick size, so the ToT can be used in a Define and is returned in ns
+template <size_t N>
+auto computeToTns(Double_t tick_ns) {
+    return [tick_ns](const ROOT::RVec<Int_t>& le, const ROOT::RVec<Int_t>& te) {
+        return computeToT<N>(le, te, tick_ns);
+    };
+}
+
+template <size_t N>
+bool barCoincidence(const ROOT::RVec<Double_t>& ds, 
+                    const ROOT::RVec<Double_t>& us) {
+    bool coincidence = false;
+    for (size_t i = 0; i < N; ++i) {
+        if (ds[i] > 0 && us[i] > 0) {
+            coincidence = true;
+            break;
+        }
+    }
+    return coincidence;
+}
+
+template <size_t N>
+int countNonZeroToT(const ROOT::RVec<Double_t>& tot) {
+    int count = 0;
+    for (size_t i = 0; i < N; ++i) {
+        if (tot[i] > 0) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+
+template <size_t N>
+int computeToTSum(const ROOT::RVec<Double_t>& tot) {
+    Double_t totsum = 0;
+    for (size_t i = 0; i < N; ++i) {
+        if (tot[i] > 0) {
+            totsum = totsum+tot[i];
+        }
+    }
+    return totsum;
+}
+
+template <size_t N>
+std::vector<int> getActiveIndices(const ROOT::RVec<Double_t>& arr) {
+    std::vector<int> indices;
+    for (size_t i = 0; i < N; ++i) {
+        if (!std::isnan(arr[i]) && arr[i] > 0) {
+            indices.push_back(i);
+        }
+    }
+    return indices;
+}
+
+inline ROOT::VecOps::RVec<Int_t> filterTicks(
+    const ROOT::VecOps::RVec<Int_t>& vec,
+    const std::function<bool(Int_t)>& pred) 
+{
+    ROOT::VecOps::RVec<Int_t> out(vec.size());
+    for (size_t i = 0; i < vec.size(); ++i) {
+        out[i] = pred(vec[i]) ? vec[i] : INT32_UNSET;
+    }
+    return out;
+}
+
+inline ROOT::VecOps::RVec<Double_t> filterVector(
+    const ROOT::VecOps::RVec<Double_t>& vec,
+    const std::function<bool(Double_t)>& pred) 
+{
+    ROOT::VecOps::RVec<Double_t> out(vec.size());
+    for (size_t i = 0; i < vec.size(); ++i) {
+        out[i] = pred(vec[i]) ? vec[i] : NAN;
+    }
+    return out;
+}
+
+inline ROOT::VecOps::RVec<Double_t> barCoincidenceToT(
+    const ROOT::RVec<Double_t>& ds, 
+    const ROOT::RVec<Double_t>& us) {
+    ROOT::VecOps::RVec<Double_t> coinc(ds.size());
+    // bool coincidence = false;
+    for (size_t i = 0; i < ds.size(); ++i) {
+        if (ds[i] > 0 && us[i] > 0) {
+            coinc[i] = ds[i];
+        } else {
+            coinc[i] = std::nan("");
+        }
+    }
+    return coinc;
+}
+
+#endif
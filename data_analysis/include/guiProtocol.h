@@ -0,0 +1,86 @@
+#ifndef GUIPROTOCOL_H
+#define GUIPROTOCOL_H
+
+/*
+ * Binary frames sent by hodo_analysis to the GUI over ZMQ (port 5555).
+ * Plain C, so it can be used by any decoder. Mirrored in hodo_protocol.py.
+ *
+ * One ZMQ message is one frame: a header followed by count records of
+ * recordSize bytes each, all little-endian. Readers step through the records
+ * with recordSize, so fields appended later are skipped by old readers. New
+ * readers only require the fields of the first layout of a record and check
+ * recordSize before they read an appended field.
+ *
+ *   HODO_GUI_END:      one hodo_gui_end record, the event counts of the run
+ *   HODO_GUI_SNAPSHOT: one hodo_gui_snapshot record, the monitoring histograms
+ *   HODO_GUI_TIMELINE: hodo_gui_bin records, events per time bin since the run start
+ *
+ * During a run the analysis sends a SNAPSHOT and a TIMELINE frame at a fixed
+ * cadence, both always hold the full histograms of the run so far.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HODO_GUI_MAGIC   0x49554748u    /* "HGUI" */
+#define HODO_GUI_VERSION 2
+
+#define HODO_GUI_END      2
+#define HODO_GUI_SNAPSHOT 3
+#define HODO_GUI_TIMELINE 4
+
+#define HODO_GUI_N_BGO      64
+#define HODO_GUI_N_BAR      32
+#define HODO_GUI_N_TOT_BINS 128
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;
+    uint32_t count;
+    uint32_t recordSize;
+} hodo_gui_header;
+
+typedef struct {
+    uint64_t eventsCut;
+    uint64_t eventsCutGate;
+} hodo_gui_end;
+
+typedef struct {
+    uint64_t eventsCut;
+    uint64_t eventsCutGate;
+    double   timeBin_s;                 /* width of the TIMELINE bins */
+    double   totBin_ns;                 /* width of the ToT bins, the last bin holds the overflow */
+    uint32_t bgo[HODO_GUI_N_BGO];       /* events with a hit in each channel */
+    uint32_t barO[HODO_GUI_N_BAR];      /* bars with a coincidence of both ends */
+    uint32_t barI[HODO_GUI_N_BAR];
+    uint32_t bgoToT[HODO_GUI_N_TOT_BINS];
+    uint32_t barToT[HODO_GUI_N_TOT_BINS];  /* inner and outer bars, downstream end */
+    double   bgoToTSum[HODO_GUI_N_BGO]; /* ns, summed ToT of the hits in each channel, appended */
+} hodo_gui_snapshot;
+
+/* Size of the snapshot record before bgoToTSum was appended */
+#define HODO_GUI_SNAPSHOT_MIN_SIZE offsetof(hodo_gui_snapshot, bgoToTSum)
+#define HODO_GUI_HAS_BGO_TOT_SUM(header) ((header)->recordSize >= sizeof(hodo_gui_snapshot))
+
+typedef struct {
+    uint32_t events;
+    uint32_t eventsGate;
+} hodo_gui_bin;
+
+/*
+ * Checks a received frame, returns the pointer to the first record or NULL if
+ * the frame is not valid. Record i is at (const char*)records + i * header->recordSize.
+ */
+static inline const void* hodo_gui_records(const void* frame, size_t size, const hodo_gui_header** header) {
+    const hodo_gui_header* h = (const hodo_gui_header*)frame;
+    if (size < sizeof(hodo_gui_header) || h->magic != HODO_GUI_MAGIC || h->version > HODO_GUI_VERSION) return NULL;
+    if (h->type == HODO_GUI_END && h->recordSize < sizeof(hodo_gui_end)) return NULL;
+    if (h->type == HODO_GUI_SNAPSHOT && h->recordSize < HODO_GUI_SNAPSHOT_MIN_SIZE) return NULL;
+    if (h->type == HODO_GUI_TIMELINE && h->recordSize < sizeof(hodo_gui_bin)) return NULL;
+    if ((size - sizeof(hodo_gui_header)) / (h->recordSize ? h->recordSize : 1) < h->count) return NULL;
+    if (header) *header = h;
+    return (const char*)frame + sizeof(hodo_gui_header);
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef GUIPUBLISHER_H
+#define GUIPUBLISHER_H
+
+#include <zmq.hpp>
+
+#include "guiProtocol.h"
+
+class MonitorHistograms;
+
+// Sends the monitoring histograms and the event counts to the GUI as binary frames, see guiProtocol.h
+class GuiPublisher {
+public:
+    GuiPublisher(zmq::socket_t& socket) : socket(socket) {}
+
+    void sendSnapshot(const MonitorHistograms& monitor);
+    void sendEnd(double eventsCut, double eventsCutGate);
+    size_t framesSent() const { return frames; }
+
+private:
+    void sendFrame(uint16_t type, const void* records, uint32_t count, uint32_t recordSize);
+
+    zmq::socket_t& socket;
+    size_t frames = 0;
+};
+
+#endif
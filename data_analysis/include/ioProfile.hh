@@ -0,0 +1,35 @@
+#ifndef IOPROFILE_H
+#define IOPROFILE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Compression.h>
+#include <TTree.h>
+
+#include "eventNTuple.hh"
+
+// ROOT I/O settings of the raw and merged output files, read from daq_config.conf
+struct IOProfile {
+    Long64_t clusterSize = -30000000;   // io_cluster_size: entries per cluster, negative = bytes (as TTree::SetAutoFlush)
+    Int_t basketSize = 32000;           // io_basket_size: bytes per basket
+    ROOT::RCompressionSetting::EAlgorithm::EValues compressionAlgorithm = ROOT::RCompressionSetting::EAlgorithm::kZSTD;  // io_compression
+    Int_t compressionLevel = 5;         // io_compression_level
+    Int_t flushEvery = 0;               // io_flush_every: blocks between AutoSaves, 0 = only at the end
+
+    static IOProfile fromConfig(const std::map<std::string, std::string>& config);
+
+    Int_t compressionSettings() const;
+    std::string compressionName() const;
+    std::string describe() const;
+
+    void apply(TFile* file) const;
+    void apply(TTree* tree) const;
+    RNT::RNTupleWriteOptions ntupleOptions() const;
+};
+
+// The profiles compared by the I/O benchmark, the configured one is always included
+std::vector<std::pair<std::string, IOProfile>> benchmarkProfiles(const IOProfile& configured);
+
+#endif
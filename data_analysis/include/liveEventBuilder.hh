@@ -0,0 +1,34 @@
+#ifndef LIVEEVENTBUILDER_H
+#define LIVEEVENTBUILDER_H
+
+#include <array>
+#include <map>
+#include <vector>
+
+#include "tdcEvent.hh"
+
+// Merges the TDC and GATE fragments of the live data stream into events in memory
+class LiveEventBuilder {
+public:
+    LiveEventBuilder(size_t maxPending = 4096);
+
+    void addFragment(const TDCEvent& fragment);
+    void takeReady(std::vector<TDCEvent>& ready);
+    void flush(std::vector<TDCEvent>& ready);
+    size_t pending() const { return events.size(); }
+
+private:
+    static constexpr int N_SOURCES = 5;             // TDC 0-3 and GATE (tdcID 4)
+    static constexpr uint8_t ALL_SOURCES = 0x1F;
+
+    struct PendingEvent {
+        TDCEvent event;
+        uint8_t sources = 0;
+    };
+
+    std::map<UInt_t, PendingEvent> events;
+    std::array<Long64_t, N_SOURCES> lastID;         // last eventID per source, -1 if none yet
+    size_t maxPending;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef MONITORHISTOGRAMS_H
+#define MONITORHISTOGRAMS_H
+
+#include <vector>
+#include <ROOT/RVec.hxx>
+
+#include "guiProtocol.h"
+#include "dataFilter.hh"
+
+// Monitoring histograms of the filtered events, kept by the analysis and sent to the GUI as snapshots
+class MonitorHistograms {
+public:
+    MonitorHistograms(double timeBin_s = 1., double totBin_ns = 4.);
+
+    void fill(const FilteredEvent& event);
+    void fill(Double_t tdcTimeTag_ns, Bool_t mixGate,
+              const ROOT::RVec<Double_t>& bgoToT,
+              const ROOT::RVec<Double_t>& barOToT,
+              const ROOT::RVec<Double_t>& barIToT);
+    void merge(const MonitorHistograms& other);
+    void reset();
+
+    const hodo_gui_snapshot& snapshot() const { return summary; }
+    const std::vector<hodo_gui_bin>& timeline() const { return bins; }
+
+private:
+    static void fillToT(uint32_t* histogram, Double_t tot_ns, double binWidth);
+
+    static constexpr size_t MAX_TIME_BINS = 86400;     // events later than this many bins go into the last one
+
+    hodo_gui_snapshot summary;
+    std::vector<hodo_gui_bin> bins;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef ONLINEFILTERTREE_H
+#define ONLINEFILTERTREE_H
+
+#include <vector>
+#include <cstdint>
+
+#include <TTree.h>
+#include <TDirectory.h>
+
+#define FILT_WORDS 3
+
+// Decisions of the online filter of hodo_daq in one block, from the FILT bank.
+// Only blocks of runs with online_filter=1 have one.
+struct OnlineFilterEvent {
+    Double_t timestamp;             // s since the epoch, DAQ clock when the block was built
+    UInt_t cuspRunNumber;
+    UInt_t accepted;                // events that passed the filter
+    UInt_t rejected;                // events that failed, including the prescaled ones
+    std::vector<UInt_t> prescaledIDs;   // 12 bit TDC event IDs of the rejected events that were kept
+
+    bool decode(const std::vector<uint32_t>& data, uint64_t timestamp_ns);
+};
+
+// OnlineFilterTree next to the RawEventTree, one entry per block
+class OnlineFilterTree {
+public:
+    OnlineFilterTree(TDirectory* dir);
+
+    void fill(const OnlineFilterEvent& filter);
+    void write();
+    Long64_t entries() const { return tree ? tree->GetEntries() : 0; }
+
+    static void copy(TDirectory* from, TDirectory* to);
+
+private:
+    TTree* tree = nullptr;
+    OnlineFilterEvent entry{};
+    std::vector<UInt_t>* prescaledIDs = &entry.prescaledIDs;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SCALERTREE_H
+#define SCALERTREE_H
+
+#include <vector>
+#include <cstdint>
+
+#include <TTree.h>
+#include <TDirectory.h>
+
+// Words of the SCLR bank, in the order of v2495::readScalers
+enum ScalerWord {
+    SCALER_EVENT_CNT,
+    SCALER_FREQ,
+    SCALER_COINC_UPPER,
+    SCALER_COINC_LOWER,
+    SCALER_SIGNALS_BGO,
+    SCALER_TRIGGER_CNT,
+    SCALER_GATED_CNT,
+    SCALER_WORDS
+};
+
+// One readout of the V2495 counters. The counters run over the whole run
+// (reset at the run start), rates are the differences between entries.
+struct ScalerEvent {
+    Double_t timestamp;             // s since the epoch, DAQ clock at the readout
+    UInt_t cuspRunNumber;
+    UInt_t eventCnt;
+    UInt_t freq;
+    UInt_t coincidencesUpper;
+    UInt_t coincidencesLower;
+    UInt_t signalsBgo;
+    UInt_t triggerCnt;
+    UInt_t gatedCnt;
+
+    bool decode(const std::vector<uint32_t>& data, uint64_t timestamp_ns);
+};
+
+// Low-rate ScalerTree next to the RawEventTree, a plain TTree for both output backends
+class ScalerTree {
+public:
+    ScalerTree(TDirectory* dir);
+
+    void fill(const ScalerEvent& scaler);
+    void write();
+    Long64_t entries() const { return tree ? tree->GetEntries() : 0; }
+
+    static void copy(TDirectory* from, TDirectory* to);
+
+private:
+    TTree* tree = nullptr;
+    ScalerEvent entry{};
+};
+
+#endif
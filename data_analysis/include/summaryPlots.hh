@@ -0,0 +1,54 @@
+#ifndef SUMMARYPLOTS_H
+#define SUMMARYPLOTS_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <TH1D.h>
+#include <ROOT/RDataFrame.hxx>
+
+#include "bgoGeometry.hh"
+
+/*
+ * Summary histograms of a run: events and mixing events over time, BGO hit
+ * maps (hits and ToT-weighted) and bar occupancy. They are booked on the filter graph and filled in its event
+ * loop, afterwards they are written to the data file and drawn as PNG and PDF
+ * for the run control.
+ */
+class SummaryPlots {
+public:
+    SummaryPlots(const std::string& bgoGeomFile);
+
+    void book(ROOT::RDF::RNode filtered);
+
+    bool write(const std::string& rootFile);
+    void savePlots(const std::string& prefix, const std::string& guiPrefix = "");
+    bool writeOverview(const std::string& csvFile, int runNumber);
+
+    UInt_t cuspRunNumber();
+    ULong64_t events() { return *nEvents; }
+    ULong64_t mixEvents() { return *nMixEvents; }
+
+private:
+    struct TimeHistograms {
+        ROOT::RDF::RResultPtr<TH1D> events;     // s, axis range from the data
+        ROOT::RDF::RResultPtr<TH1D> mixEvents;
+    };
+
+    TimeHistograms& times();
+
+    bool booked = false;
+    const BgoGeometry& geometry;
+
+    ROOT::RDF::RResultPtr<ULong64_t> nEvents;
+    ROOT::RDF::RResultPtr<ULong64_t> nMixEvents;
+    TimeHistograms fpgaTimes;                       // events with an FPGA time tag
+    TimeHistograms tdcTimes;                        // events with a TDC time tag
+    ROOT::RDF::RResultPtr<BgoHitMap> bgoHits;
+    ROOT::RDF::RResultPtr<TH1D> barOChannels;
+    ROOT::RDF::RResultPtr<TH1D> barIChannels;
+    ROOT::RDF::RResultPtr<std::map<UInt_t, ULong64_t>> cuspRuns;    // events per CUSP run number
+};
+
+#endif
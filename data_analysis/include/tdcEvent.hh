@@ -14,6 +14,12 @@
 constexpr uint32_t UINT32_UNSET = static_cast<uint32_t>(-1);
 constexpr uint64_t UINT64_UNSET = static_cast<uint64_t>(-1);
 constexpr Bool_t BOOL_UNSET = 2;
+constexpr Int_t INT32_UNSET = -1;
+
+// Tick sizes of the stored integer times
+constexpr Double_t TDC_TICK_NS  = 0.1;     // V1190 hit measurement, 100 ps
+constexpr Double_t ETTT_TICK_NS = 25.;     // V1190 extended trigger time tag
+constexpr Double_t FPGA_TICK_NS = 20.;     // V2495 time tag
 
 struct TDCEvent {
     UInt_t eventID;
@@ -21,36 +27,47 @@ struct TDCEvent {
     UInt_t cuspRunNumber;
     Bool_t mixGate;
     Bool_t dumpGate;
-    Double_t tdcTimeTag;
-    Double_t fpgaTimeTag;
+    ULong64_t tdcTimeTag;       // ETTT ticks
+    ULong64_t fpgaTimeTag;      // FPGA ticks
     
-    std::array<Double_t, 4> trgLE;
-    std::array<Double_t, 4> trgTE;
+    // All hit times in TDC ticks
+    std::array<Int_t, 4> trgLE;
+    std::array<Int_t, 4> trgTE;
 
-    std::array<Double_t, 32> hodoIDsLE;
-    std::array<Double_t, 32> hodoIUsLE;
-    std::array<Double_t, 32> hodoODsLE;
-    std::array<Double_t, 32> hodoOUsLE;
+    std::array<Int_t, 32> hodoIDsLE;
+    std::array<Int_t, 32> hodoIUsLE;
+    std::array<Int_t, 32> hodoODsLE;
+    std::array<Int_t, 32> hodoOUsLE;
 
-    std::array<Double_t, 32> hodoIDsTE;
-    std::array<Double_t, 32> hodoIUsTE;
-    std::array<Double_t, 32> hodoODsTE;
-    std::array<Double_t, 32> hodoOUsTE;
+    std::array<Int_t, 32> hodoIDsTE;
+    std::array<Int_t, 32> hodoIUsTE;
+    std::array<Int_t, 32> hodoODsTE;
+    std::array<Int_t, 32> hodoOUsTE;
 
-    std::array<Double_t, 64> bgoLE;
-    std::array<Double_t, 64> bgoTE;
+    std::array<Int_t, 64> bgoLE;
+    std::array<Int_t, 64> bgoTE;
 
-    std::array<Double_t, 120> tileILE;
-    std::array<Double_t, 120> tileITE;
-    std::array<Double_t, 120> tileOLE;
-    std::array<Double_t, 120> tileOTE;
+    std::array<Int_t, 120> tileILE;
+    std::array<Int_t, 120> tileITE;
+    std::array<Int_t, 120> tileOLE;
+    std::array<Int_t, 120> tileOTE;
 
     UInt_t tdcID;
 
     TDCEvent();
     void reset();
     virtual ~TDCEvent() {}
-    ClassDef(TDCEvent, 1);
+    ClassDef(TDCEvent, 2);
+};
+
+// Tick sizes stored as metadata next to the trees
+struct TickSizes {
+    Double_t tdc_ns  = TDC_TICK_NS;
+    Double_t ettt_ns = ETTT_TICK_NS;
+    Double_t fpga_ns = FPGA_TICK_NS;
+
+    void write(TDirectory* dir) const;
+    static TickSizes read(TDirectory* dir);
 };
 
 
@@ -0,0 +1,45 @@
+#ifndef TRACKRECO_H
+#define TRACKRECO_H
+
+#include <map>
+#include <string>
+#include <ROOT/RVec.hxx>
+
+#include "tdcEvent.hh"
+
+// Geometry of the two bar layers and the BGO plane, read from daq_config.conf
+struct HodoGeometry {
+    bool enabled = false;               // track_reco
+    Double_t innerRadius_mm = 100.;     // hodo_inner_radius_mm, bar centres of the inner layer
+    Double_t outerRadius_mm = 175.;     // hodo_outer_radius_mm
+    Double_t barSpeed_mm_ns = 150.;     // hodo_bar_speed_mm_ns, effective signal speed along a bar
+    Double_t phi0_deg = 0.;             // hodo_phi0_deg, azimuth of bar 0, bars count counter-clockwise
+    Double_t bgoZ_mm = 0.;              // bgo_z_mm, BGO plane, z = 0 is the middle of the bars, downstream positive
+    Double_t maxDphi_deg = 30.;         // track_max_dphi_deg, largest azimuth difference of inner and outer cluster
+
+    static constexpr int N_BARS = 32;
+
+    static HodoGeometry fromConfig(const std::map<std::string, std::string>& config);
+    Double_t barPhi(int bar) const;
+};
+
+// Straight tracks of one event from the inner to the outer bar layer, one entry per track
+struct HodoTracks {
+    ROOT::RVec<Double_t> phiI;          // rad, cluster in the inner layer
+    ROOT::RVec<Double_t> zI;            // mm
+    ROOT::RVec<Double_t> phiO;          // rad, cluster in the outer layer
+    ROOT::RVec<Double_t> zO;            // mm
+    ROOT::RVec<Double_t> bgoX;          // mm, track at the BGO plane, NaN if parallel to it
+    ROOT::RVec<Double_t> bgoY;
+    Double_t vertexX = NAN;             // mm, mean of the tracks at the BGO plane
+    Double_t vertexY = NAN;
+};
+
+ROOT::RVec<Double_t> barZ(const ROOT::RVec<Int_t>& dsLE, const ROOT::RVec<Int_t>& usLE,
+                          const ROOT::RVec<Double_t>& dsToT, const ROOT::RVec<Double_t>& usToT,
+                          Double_t tick_ns, const HodoGeometry& geometry);
+HodoTracks reconstructTracks(const ROOT::RVec<Double_t>& zI, const ROOT::RVec<Double_t>& totI,
+                             const ROOT::RVec<Double_t>& zO, const ROOT::RVec<Double_t>& totO,
+                             const HodoGeometry& geometry);
+
+#endif
@@ -0,0 +1,106 @@
+#include "bgoGeometry.hh"
+#include "logger.hh"
+
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+/**
+ * @brief Adds the hits of one event.
+ *
+ * @param bgoToT ToT per BGO channel in ns, NaN for channels without hit.
+ */
+void BgoHitMap::fill(const ROOT::RVec<Double_t>& bgoToT) {
+    const size_t n = std::min<size_t>(bgoToT.size(), N_CHANNELS);
+    for (size_t ch = 0; ch < n; ch++) {
+        if (!(bgoToT[ch] > 0)) continue;
+        hits[ch]++;
+        totSum[ch] += bgoToT[ch];
+    }
+}
+
+void BgoHitMap::merge(const BgoHitMap& other) {
+    for (int ch = 0; ch < N_CHANNELS; ch++) {
+        hits[ch] += other.hits[ch];
+        totSum[ch] += other.totSum[ch];
+    }
+}
+
+/**
+ * @brief The geometry of a file, read at the first call and shared afterwards.
+ *
+ * @param fileName The bgo_geom.csv with the columns Channel,x,y.
+ */
+const BgoGeometry& BgoGeometry::get(const std::string& fileName) {
+    static std::mutex mutex;
+    static std::map<std::string, std::unique_ptr<BgoGeometry>> geometries;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& geometry = geometries[fileName];
+    if (!geometry) geometry.reset(new BgoGeometry(fileName));
+    return *geometry;
+}
+
+BgoGeometry::BgoGeometry(const std::string& fileName) {
+    posX.fill(NAN);
+    posY.fill(NAN);
+    bins.fill(0);
+
+    std::ifstream file(fileName);
+    if (!file.is_open()) {
+        Logger::getLogger()->warn("Could not open {}, no BGO hit maps", fileName);
+        return;
+    }
+
+    std::string line;
+    std::getline(file, line);   // header
+    while (std::getline(file, line)) {
+        std::istringstream ss(line);
+        std::string channel, x, y;
+        if (!std::getline(ss, channel, ',') || !std::getline(ss, x, ',') || !std::getline(ss, y, ',')) continue;
+        try {
+            int ch = std::stoi(channel);
+            if (ch < 0 || ch >= N_CHANNELS) continue;
+            posX[ch] = std::stod(x);
+            posY[ch] = std::stod(y);
+        } catch (const std::exception& e) {
+            Logger::getLogger()->warn("Invalid line in {}: {}", fileName, line);
+        }
+    }
+
+    // Bins are added in channel order, the table keeps the bin of every channel
+    int next = 1;
+    for (int ch = 0; ch < N_CHANNELS; ch++) {
+        if (!std::isnan(posX[ch]) && !std::isnan(posY[ch])) bins[ch] = next++;
+    }
+    loaded = next > 1;
+    Logger::getLogger()->debug("BGO geometry with {} channels read from {}", next - 1, fileName);
+}
+
+/**
+ * @brief An empty hit map, one rectangular bin per channel around its centre.
+ */
+std::unique_ptr<TH2Poly> BgoGeometry::makeMap(const char* name, const char* title) const {
+    const double edge = RADIUS + 5.;
+    auto map = std::make_unique<TH2Poly>(name, title, -edge, edge, -edge, edge);
+    map->SetDirectory(nullptr);
+    for (int ch = 0; ch < N_CHANNELS; ch++) {
+        if (bins[ch] == 0) continue;
+        map->AddBin(posX[ch] - CHANNEL_W / 2, posY[ch] - CHANNEL_H / 2, posX[ch] + CHANNEL_W / 2, posY[ch] + CHANNEL_H / 2);
+    }
+    return map;
+}
+
+/**
+ * @brief The hits, or with totWeighted the summed ToT in ns, of each channel at its position.
+ */
+std::unique_ptr<TH2Poly> BgoGeometry::hitMap(const BgoHitMap& map, bool totWeighted, const char* name, const char* title) const {
+    auto histogram = makeMap(name, title);
+    for (int ch = 0; ch < N_CHANNELS; ch++) {
+        if (bins[ch] == 0) continue;
+        histogram->SetBinContent(bins[ch], totWeighted ? map.totSum[ch] : static_cast<double>(map.hits[ch]));
+    }
+    return histogram;
+}
@@ -2,59 +2,193 @@
 #include <cmath>     // For std::nan
 
 #include "dataDecoder.hh"
+#include "channelMap.hh"
 #include "fileReader.hh"
 #include "logger.hh"
 
 
 
-// Constructor: Initializes ROOT File & TTree
-DataDecoder::DataDecoder(const std::string& outputFile) {
+DataDecoder::DataDecoder() : backend(OutputBackend::TTree) {}
+
+// Constructor: Initializes ROOT File & TTree or RNTuple
+DataDecoder::DataDecoder(const std::string& outputFile, OutputBackend backend, const IOProfile& io, const DecoderCheckpoint* resume)
+    : backend(backend), io(io) {
     fileName = outputFile;
-    rootFile = new TFile(outputFile.c_str(), "RECREATE");
+
+    if (resume && backend == OutputBackend::RNTuple) {
+        Logger::getLogger()->warn("A decoding can only be resumed with the ttree backend, starting over");
+    } else if (resume) {
+        resumed = openForResume(*resume);
+    }
+
+    if (!resumed) {
+        rootFile = new TFile(outputFile.c_str(), "RECREATE");
+        io.apply(rootFile);
+
+        // Times are stored as integer ticks, the tick sizes are kept in the file
+        TickSizes().write(rootFile);
+    }
+
+    // SCLR, LIVE and FILT banks, TTrees for both backends
+    scalerTree = std::make_unique<ScalerTree>(rootFile);
+    deadTimeTree = std::make_unique<DeadTimeTree>(rootFile);
+    onlineFilterTree = std::make_unique<OnlineFilterTree>(rootFile);
+
+    if (backend == OutputBackend::RNTuple) {
+        // Same field names as the TTree branches, the entry points to event
+        ntupleWriter = RNT::RNTupleWriter::Append(makeEventModel(), "RawEventTree", *rootFile, io.ntupleOptions());
+        ntupleEntry = ntupleWriter->CreateEntry();
+        bindEvent(*ntupleEntry, event);
+        return;
+    }
+
+    if (resumed) {
+        tree = rootFile->Get<TTree>("RawEventTree");
+        bindBranches(true);
+        restore(*resume);
+        Logger::getLogger()->info("Resuming {} at entry {}", outputFile, tree->GetEntries());
+        return;
+    }
+
     tree = new TTree("RawEventTree", "TTree holding the raw Hodoscope Data");
+    bindBranches(false);
 
-    // Define Tree Branches
-    tree->Branch("eventID",         &event.eventID);
-    tree->Branch("timestamp",       &event.timestamp);
-    tree->Branch("cuspRunNumber",   &event.cuspRunNumber);
-    tree->Branch("mixGate",         &event.mixGate);
-    tree->Branch("dumpGate",        &event.dumpGate);
-    tree->Branch("tdcTimeTag",      &event.tdcTimeTag);
-    tree->Branch("fpgaTimeTag",     &event.fpgaTimeTag);
-    tree->Branch("trgLE",           &event.trgLE);
-    tree->Branch("trgTE",           &event.trgTE);
-
-    tree->Branch("hodoIDsLE",   &event.hodoIDsLE);     // Inner Downstream Leading Edges
-    tree->Branch("hodoIUsLE",   &event.hodoIUsLE);     // Inner Upstream Leading Edges
-    tree->Branch("hodoODsLE",   &event.hodoODsLE);     // Outer Downstream Leading Edges
-    tree->Branch("hodoOUsLE",   &event.hodoOUsLE);     // Outer Upstream Leading Edges
-    tree->Branch("hodoIDsTE",   &event.hodoIDsTE);     // Inner Downstream Trailing Edges
-    tree->Branch("hodoIUsTE",   &event.hodoIUsTE);     // Inner Upstream Trailing Edges
-    tree->Branch("hodoODsTE",   &event.hodoODsTE);     // Outer Downstream Trailing Edges
-    tree->Branch("hodoOUsTE",   &event.hodoOUsTE);     // Outer Upstream Trailing Edges
-    tree->Branch("bgoLE",       &event.bgoLE);     // BGO Leading Edges
-    tree->Branch("bgoTE",       &event.bgoTE);     // BGO Trailing Edges
-
-    tree->Branch("tileILE",     &event.tileILE);     // Tile Inner Leading Edges
-    tree->Branch("tileITE",     &event.tileITE);     // Tile Inner Trailing Edges
-    tree->Branch("tileOLE",     &event.tileOLE);     // Tile Outer Leading Edges
-    tree->Branch("tileOTE",     &event.tileOTE);     // Tile Outer Trailing Edges
-
-    tree->Branch("tdcID",       &event.tdcID);
-
-    tree->SetAutoFlush(10);
-    // tree->SetBasketSize("*", 1024);  // reduce basket size
+    io.apply(tree);     // cluster and basket size
     tree->SetAutoSave(0);
 
 }
 
+// Creates the branches of the RawEventTree, or sets their addresses for a tree from the file
+void DataDecoder::bindBranches(bool attach) {
+    auto branch = [this, attach](const char* name, auto* address) {
+        if (attach) tree->SetBranchAddress(name, address);
+        else tree->Branch(name, address);
+    };
+
+    // Define Tree Branches
+    branch("eventID",         &event.eventID);
+    branch("timestamp",       &event.timestamp);
+    branch("cuspRunNumber",   &event.cuspRunNumber);
+    branch("mixGate",         &event.mixGate);
+    branch("dumpGate",        &event.dumpGate);
+    branch("tdcTimeTag",      &event.tdcTimeTag);
+    branch("fpgaTimeTag",     &event.fpgaTimeTag);
+    branch("trgLE",           &event.trgLE);
+    branch("trgTE",           &event.trgTE);
+
+    branch("hodoIDsLE",   &event.hodoIDsLE);     // Inner Downstream Leading Edges
+    branch("hodoIUsLE",   &event.hodoIUsLE);     // Inner Upstream Leading Edges
+    branch("hodoODsLE",   &event.hodoODsLE);     // Outer Downstream Leading Edges
+    branch("hodoOUsLE",   &event.hodoOUsLE);     // Outer Upstream Leading Edges
+    branch("hodoIDsTE",   &event.hodoIDsTE);     // Inner Downstream Trailing Edges
+    branch("hodoIUsTE",   &event.hodoIUsTE);     // Inner Upstream Trailing Edges
+    branch("hodoODsTE",   &event.hodoODsTE);     // Outer Downstream Trailing Edges
+    branch("hodoOUsTE",   &event.hodoOUsTE);     // Outer Upstream Trailing Edges
+    branch("bgoLE",       &event.bgoLE);     // BGO Leading Edges
+    branch("bgoTE",       &event.bgoTE);     // BGO Trailing Edges
+
+    branch("tileILE",     &event.tileILE);     // Tile Inner Leading Edges
+    branch("tileITE",     &event.tileITE);     // Tile Inner Trailing Edges
+    branch("tileOLE",     &event.tileOLE);     // Tile Outer Leading Edges
+    branch("tileOTE",     &event.tileOTE);     // Tile Outer Trailing Edges
+
+    branch("tdcID",       &event.tdcID);
+}
+
+/**
+ * @brief Opens the raw file of a checkpoint to continue it.
+ *
+ * The trees in the file must have exactly the entries of the checkpoint,
+ * otherwise entries after the checkpoint were saved and the file is not used.
+ *
+ * @return true if the file is open and matches the checkpoint.
+ */
+bool DataDecoder::openForResume(const DecoderCheckpoint& resume) {
+    auto log = Logger::getLogger();
+
+    rootFile = new TFile(fileName.c_str(), "UPDATE");
+    if (!rootFile->IsOpen() || rootFile->IsZombie()) {
+        delete rootFile;
+        rootFile = nullptr;
+        return false;
+    }
+
+    auto entries = [this](const char* name) {
+        auto* existing = rootFile->Get<TTree>(name);
+        return existing ? existing->GetEntries() : Long64_t(-1);
+    };
+    auto matches = [](Long64_t inFile, Long64_t expected) {
+        return inFile == expected || (inFile < 0 && expected == 0);     // empty side trees are not written
+    };
+
+    Long64_t raw = entries("RawEventTree");
+    if (raw < 0 || raw != resume.rawEntries || !matches(entries("ScalerTree"), resume.scalerEntries)
+        || !matches(entries("DeadTimeTree"), resume.deadTimeEntries) || !matches(entries("OnlineFilterTree"), resume.filterEntries)) {
+        log->warn("{} does not match its checkpoint ({} entries, {} expected), starting over", fileName, raw, resume.rawEntries);
+        rootFile->Close();
+        delete rootFile;
+        rootFile = nullptr;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Saves the file and returns the decoder state for a checkpoint.
+ *
+ * Call it between two blocks. The entries of the trees are those just saved.
+ */
+DecoderCheckpoint DataDecoder::checkpoint() {
+    flush();
+
+    DecoderCheckpoint state;
+    state.rawEntries = tree ? tree->GetEntries() : 0;
+    state.scalerEntries = scalerTree ? scalerTree->entries() : 0;
+    state.deadTimeEntries = deadTimeTree ? deadTimeTree->entries() : 0;
+    state.filterEntries = onlineFilterTree ? onlineFilterTree->entries() : 0;
+    std::copy(std::begin(last_evt), std::end(last_evt), state.last_evt);
+    std::copy(std::begin(reset_ctr), std::end(reset_ctr), state.reset_ctr);
+    std::copy(std::begin(last_timetag), std::end(last_timetag), state.last_timetag);
+    std::copy(std::begin(reset_ctr_time), std::end(reset_ctr_time), state.reset_ctr_time);
+    state.cuspValue = cuspValue;
+    state.secTime = secTime;
+    state.nsecTime = nsecTime;
+    state.gateValue = gateValue;
+    return state;
+}
+
+// Continues with the unwrapping and time context of a checkpoint
+void DataDecoder::restore(const DecoderCheckpoint& state) {
+    std::copy(std::begin(state.last_evt), std::end(state.last_evt), last_evt);
+    std::copy(std::begin(state.reset_ctr), std::end(state.reset_ctr), reset_ctr);
+    std::copy(std::begin(state.last_timetag), std::end(state.last_timetag), last_timetag);
+    std::copy(std::begin(state.reset_ctr_time), std::end(state.reset_ctr_time), reset_ctr_time);
+    cuspValue = state.cuspValue;
+    secTime = state.secTime;
+    nsecTime = state.nsecTime;
+    gateValue = state.gateValue;
+}
+
 // Destructor: Writes and Closes ROOT File
 DataDecoder::~DataDecoder() {
+    if (fileName.empty()) return;
     writeTree();
+    ntupleWriter.reset();   // commits the RNTuple, needs the file to be still open
     rootFile->Close();
     delete rootFile;
 }
 
+void DataDecoder::fillEvent() {
+    if (fragmentCallback) {
+        fragmentCallback(event);
+    }
+    if (ntupleWriter) {
+        ntupleWriter->Fill(*ntupleEntry);
+    } else if (tree) {
+        tree->Fill();
+    }
+}
+
 
 // Lookup table for detector types
 enum DetectorType {
@@ -103,7 +237,7 @@ DetectorType getDetectorType(int channel) {
 
 // Process time assignment dynamically
 void assignTime(TDCEvent &event, int channel, int edge, int32_t time, DetectorType type) {
-    Double_t* storage = nullptr;
+    Int_t* storage = nullptr;
 
     // Select correct map based on detector type
     switch (type) {
@@ -122,8 +256,8 @@ void assignTime(TDCEvent &event, int channel, int edge, int32_t time, DetectorTy
 
     if (!storage) return;
 
-    // Assign time only if it's the first entry (`NaN`) or a smaller value
-    if (std::isnan(storage[channel]) || time < storage[channel]) {
+    // Assign time only if it's the first entry (unset) or a smaller value
+    if (*storage == INT32_UNSET || time < *storage) {
         *storage = time;
     }
 }
@@ -228,8 +362,8 @@ uint32_t DataDecoder::processEvent(const char bankName[4], Event& dataevent) {
                     // log->debug("reset_ctr_time: {:d}", reset_ctr_time[tdcID]);
                 }
 
-                event.tdcTimeTag = static_cast<Double_t>(timetag*32+geo) + static_cast<Double_t>(reset_ctr_time[tdcID] * 4294967296.0);
-                log->trace("[Global Trailer] | GEO: {} | TimeTag: {:f}", geo, event.tdcTimeTag);
+                event.tdcTimeTag = static_cast<ULong64_t>(timetag*32+geo) + static_cast<ULong64_t>(reset_ctr_time[tdcID]) * 0x100000000ULL;
+                log->trace("[Global Trailer] | GEO: {} | TimeTag: {:d}", geo, event.tdcTimeTag);
                 last_timetag[tdcID] = timetag; //(timetag*32+geo);  //event.tdcTimeTag;
                 event.cuspRunNumber = cuspValue;
                 if (dataevent.timestamp64 > 0) {
@@ -241,7 +375,7 @@ uint32_t DataDecoder::processEvent(const char bankName[4], Event& dataevent) {
                 // log->debug("timestamp in TDC: {} = {}", event.timestamp, nsecTime);
                 
                 event.mixGate = gateValue; 
-                tree->Fill();
+                fillEvent();
                 lastEventID = event.eventID;
                 event.reset();
 
@@ -256,7 +390,7 @@ uint32_t DataDecoder::processEvent(const char bankName[4], Event& dataevent) {
             event.mixGate = (Bool_t)GATE_BOOL(data[i]);
             event.dumpGate = (Bool_t)DUMP_BOOL(data[i]);
             if (dataevent.timestamp64 != 0){
-                event.fpgaTimeTag = static_cast<Double_t>(dataevent.timestamp64);
+                event.fpgaTimeTag = static_cast<ULong64_t>(dataevent.timestamp64);
                 event.timestamp = nsecTime;
             } else {
                 event.timestamp = secTime;
@@ -265,8 +399,7 @@ uint32_t DataDecoder::processEvent(const char bankName[4], Event& dataevent) {
             log->trace("[GATE Decode] eventID: 0x{0:x}, mixGate: 0x{1:x}, dumpGate: 0x{2:x}, fpgaTimeTag: {3}",
                 event.eventID, event.mixGate, event.dumpGate, event.fpgaTimeTag);
             event.tdcID = 4;
-            tree->Fill();
-            tree->FlushBaskets();
+            fillEvent();
             event.reset();
         }
     } else if (bankN == "CUSP") {
@@ -299,6 +432,33 @@ uint32_t DataDecoder::processEvent(const char bankName[4], Event& dataevent) {
             // tree->Fill();
             // event.reset();
         }
+    } else if (bankN == "SCLR") {
+        if (scaler.decode(data, dataevent.timestamp64)) {
+            scaler.cuspRunNumber = cuspValue;
+            log->trace("[SCLR Decode] events: {0}, triggers: {1}, gated: {2}",
+                scaler.eventCnt, scaler.triggerCnt, scaler.gatedCnt);
+            if (scalerTree) scalerTree->fill(scaler);
+        } else {
+            log->warn("SCLR event with {0:d} words", data.size());
+        }
+    } else if (bankN == "LIVE") {
+        if (deadTime.decode(data, dataevent.timestamp64)) {
+            deadTime.cuspRunNumber = cuspValue;
+            log->trace("[LIVE Decode] run: {0:.3f} s, veto: {1:.3f} s, busy: {2:.3f} s",
+                deadTime.runTime_s, deadTime.vetoTime_s, deadTime.busyTime_s);
+            if (deadTimeTree) deadTimeTree->fill(deadTime);
+        } else {
+            log->warn("LIVE event with {0:d} words", data.size());
+        }
+    } else if (bankN == "FILT") {
+        if (onlineFilter.decode(data, dataevent.timestamp64)) {
+            onlineFilter.cuspRunNumber = cuspValue;
+            log->trace("[FILT Decode] accepted: {0}, rejected: {1}, prescaled: {2}",
+                onlineFilter.accepted, onlineFilter.rejected, onlineFilter.prescaledIDs.size());
+            if (onlineFilterTree) onlineFilterTree->fill(onlineFilter);
+        } else {
+            log->warn("FILT event with {0:d} words", data.size());
+        }
     } else {
         log->warn("Unknown Bank: {0}", bankN);
     }
@@ -309,6 +469,10 @@ uint32_t DataDecoder::processEvent(const char bankName[4], Event& dataevent) {
 
 // Write TTree to ROOT File
 void DataDecoder::writeTree() {
+    if (fileName.empty()) return;
+    if (ntupleWriter) {
+        ntupleWriter->CommitCluster();
+    }
     if(rootFile  && rootFile->IsOpen()) {
         rootFile->cd();
         rootFile->Write();
@@ -322,6 +486,11 @@ void DataDecoder::writeTree() {
 }
 
 void DataDecoder::closeFile() {
+    if (ntupleWriter) {
+        // The RNTuple writer keeps the file open until it is destroyed
+        Logger::getLogger()->warn("closeFile() is not supported with the rntuple backend");
+        return;
+    }
     if(rootFile && rootFile->IsOpen()){
         rootFile->Close();
     }
@@ -367,61 +536,38 @@ bool DataDecoder::isFullyWritten(const std::string& filename) {
 }
 
 constexpr int DataDecoder::getChannel(int tdcch) {
-    // Ensure tdcch is within a valid range
-    if (tdcch < 0 || tdcch >= 28 * 16) {
-        return -999; // Error value (invalid channel)
-    }
-
-    constexpr std::array<std::array<int, 16>, 28> board = {{
-        {{   4 ,   5 ,   6 ,   7 ,   8 ,   9 ,  10 ,  11 ,  -4 ,  -5 ,  -6 ,  -7 ,  -8 ,  -9 , -10 , -11 }}, // A0 Bars 4-11
-        {{  12 ,  13 ,  14 ,  15 ,  16 ,  17 ,  18 ,  19 , -12 , -13 , -14 , -15 , -16 , -17 , -18 , -19 }}, // A1 Bars 12-19
-        {{ -61 , -60 , -59 , -58 , -57 , -56 , -55 , -54 ,  61 ,  60 ,  59 ,  58 ,  57 ,  56 ,  55 ,  54 }}, // D1 Bars 4-11
-        {{ -69 , -68 , -67 , -66 , -65 , -64 , -63 , -62 ,  69 ,  68 ,  67 ,  66 ,  65 ,  64 ,  63 ,  62 }}, // D0 Bars 12-19
-        {{ 100 , 101 , 102 , 103 , 104 , 105 , 106 , 107 , 115 , 116 , 117 , 118 , 119 , 120 , 121 , 122 }}, // Outer Tiles AmpBoard 10
-        {{ 130 , 131 , 132 , 133 , 134 , 135 , 136 , 137 , 145 , 146 , 147 , 148 , 149 , 150 , 151 , 152 }}, // Outer Tiles AmpBoard 11
-        {{ 108 , 109 , 110 , 111 , 112 ,-999 , 114 ,-999 , 123 , 124 , 125 , 126 , 127 , 128 , 129 , 113 }}, // Outer Tiles AmpBoard 14
-        {{ 138 , 139 , 140 , 141 , 142 , 143 , 144 ,-999 , 153 , 154 , 155 , 156 , 157 , 158 , 159 , 500 }}, // Outer Tiles AmpBoard 15
-        {{  20 ,  21 ,  22 ,  23 ,  24 ,  25 ,  26 ,  27 , -20 , -21 , -22 , -23 , -24 , -25 , -26 , -27 }}, // B0 Bars 20-27
-        {{  28 ,  29 ,  30 ,  31 ,  32 ,   1 ,   2 ,   3 , -28 , -29 , -30 , -31 , -32 ,  -1 ,  -2 ,  -3 }}, // B1 Bars 28-3
-        {{ -77 , -76 , -75 , -74 , -73 , -72 , -71 , -70 ,  77 ,  76 ,  75 ,  74 ,  73 ,  72 ,  71 ,  70 }}, // E0 Bars 20-27
-        {{ -53 , -52 , -51 , -82 , -81 , -80 , -79 , -78 ,  53 ,  52 ,  51 ,  82 ,  81 ,  80 ,  79 ,  78 }}, // E1 Bars 28-3
-        {{ 160 , 161 , 162 , 163 , 164 , 165 , 166 ,-999 , 175 , 176 , 177 , 178 , 179 , 180 , 181 ,-999 }}, // Outer Tiles AmpBoard 12
-        {{ 190 , 191 , 192 , 193 , 194 , 195 , 196 , 197 , 205 , 206 , 207 , 208 , 209 , 210 , 211 , 212 }}, // Outer Tiles AmpBoard 13
-        {{ 167 , 168 , 169 , 170 , 171 , 172 , 173 , 174 , 182 , 183 , 184 , 185 , 186 , 187 , 188 , 189 }}, // Outer Tiles AmpBoard 16
-        {{ 198 , 199 , 200 , 201 , 202 , 203 , 204 ,-999 , 213 , 214 , 215 , 216 , 217 , 218 , 219 , 501 }}, // Outer Tiles AmpBoard 17
-        {{-100 ,-101 ,-102 ,-103 ,-104 ,-105 ,-106 ,-107 ,-115 ,-116 ,-117 ,-118 ,-119 ,-120 ,-121 ,-122 }}, // Inner Tiles AmpBoard 18
-        {{-130 ,-131 ,-132 ,-133 ,-134 ,-135 ,-136 ,-137 ,-145 ,-146 ,-147 ,-148 ,-149 ,-150 ,-151 ,-152 }}, // Inner Tiles AmpBoard 19
-        {{-160 ,-161 ,-162 ,-163 ,-164 ,-165 ,-166 ,-167 ,-175 ,-176 ,-177 ,-178 ,-179 ,-180 ,-181 ,-182 }}, // Inner Tiles AmpBoard 20
-        {{-190 ,-191 ,-192 ,-193 ,-194 ,-195 ,-196 ,-197 ,-205 ,-206 ,-207 ,-208 ,-209 ,-210 ,-211 ,-212 }}, // Inner Tiles AmpBoard 21
-        {{-108 ,-109 ,-110 ,-111 ,-112 ,-113 ,-114 ,-999 ,-123 ,-124 ,-125 ,-126 ,-127 ,-128 ,-129 ,-999 }}, // Inner Tiles AmpBoard 22
-        {{-138 ,-139 ,-140 ,-141 ,-142 ,-143 ,-144 ,-999 ,-153 ,-154 ,-155 ,-156 ,-157 ,-158 ,-159 ,-999 }}, // Inner Tiles AmpBoard 23
-        {{-168 ,-169 ,-170 ,-171 ,-172 ,-173 ,-174 ,-999 ,-183 ,-184 ,-185 ,-186 ,-187 ,-188 ,-189 ,-999 }}, // Inner Tiles AmpBoard 24
-        {{-198 ,-199 ,-200 ,-201 ,-202 ,-203 ,-204 ,-999 ,-213 ,-214 ,-215 ,-216 ,-217 ,-218 ,-219 , 502 }}, // Inner Tiles AmpBoard 25
-        {{ 300 , 301 , 302 , 303 , 304 , 305 , 306 , 307 , 308 , 309 , 310 , 311 , 312 , 313 , 314 , 503 }}, // BGO 1
-        // {{ 300 , 301 , 302 , 303 , 304 , 305 , 306 , 307 , 308 , 309 , 310 , 311 , 312 , 313 , 314 , 315 }}, // BGO 1
-        {{ 316 , 317 , 318 , 319 , 320 , 321 , 322 , 323 , 324 , 325 , 326 , 327 , 328 , 329 , 330 , 331 }}, // BGO 2
-        // {{ 332 , 333 , 334 , 335 , 336 , 337 , 338 , 339 , 340 , 341 , 342 , 343 , 344 , 345 , 346 , 600 }}, // BGO 3
-        {{ 332 , 333 , 334 , 335 , 336 , 337 , 338 , 339 , 340 , 341 , 342 , 343 , 344 , 345 , 346 , 347 }}, // BGO 3
-        {{ 348 , 349 , 350 , 351 , 352 , 353 , 354 , 355 , 356 , 357 , 358 , 359 , 360 , 361 , 362 , 363 }}  // BGO 4
-    }};
-
-    int port = tdcch / 16;
-    int index = tdcch % 16;
-
-    return board[port][index];
-
+    return mapChannel(tdcch);
 }
 
 void DataDecoder::flush() {
     if (tree && rootFile) {
         tree->Write("", TObject::kOverwrite);        // ensures tree structure is written
+        if (scalerTree) scalerTree->write();
+        if (deadTimeTree) deadTimeTree->write();
+        if (onlineFilterTree) onlineFilterTree->write();
         rootFile->Flush();                           // ensures buffers are flushed to disk
+    } else if (ntupleWriter && rootFile) {
+        ntupleWriter->CommitCluster();               // pages are written, the footer only on commit
+        if (scalerTree) scalerTree->write();
+        if (deadTimeTree) deadTimeTree->write();
+        if (onlineFilterTree) onlineFilterTree->write();
+        rootFile->Flush();
     }
 }
 
+// Only for the TTree backend, the RNTuple writer commits clusters by size
 void DataDecoder::autoSave() {
     if (tree && rootFile) {
         tree->AutoSave("SaveSelf"); // flush baskets to disk
     }
 }
 
+// Called after each block, saves the tree every io_flush_every blocks
+void DataDecoder::endBlock() {
+    if (io.flushEvery <= 0) return;
+    if (++blocksSinceSave >= io.flushEvery) {
+        autoSave();
+        blocksSinceSave = 0;
+    }
+}
+
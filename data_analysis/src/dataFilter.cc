@@ -1,4 +1,10 @@
 #include "dataFilter.hh"
+#include "scalerTree.hh"
+#include "deadTimeTree.hh"
+#include "onlineFilterTree.hh"
+#include "filterKernels.hh"
+#include "guiPublisher.hh"
+#include "monitorHistograms.hh"
 #include <map>
 #include "TFile.h"
 #include "TTree.h"
@@ -7,98 +13,15 @@
 #include <ROOT/RDataFrame.hxx>
 #include <zmq.hpp>
 #include <unistd.h>
+#include <algorithm>
+#include <numeric>
+#include <sstream>
 
 
 template <size_t N>
-ROOT::VecOps::RVec<Double_t> computeToT(const ROOT::RVec<Double_t>& le, 
-                                        const ROOT::RVec<Double_t>& te) {
-    ROOT::VecOps::RVec<Double_t> tot(N);
+void mergeIfUnset(std::array<Int_t, N>& out, const std::array<Int_t, N>& in) {
     for (size_t i = 0; i < N; ++i) {
-        tot[i] = (le[i] > 0 && te[i] > le[i]) ? (te[i] - le[i]) : NAN;
-    }
-    return tot;
-}
-
-template <size_t N>
-bool barCoincidence(const ROOT::RVec<Double_t>& ds, 
-                    const ROOT::RVec<Double_t>& us) {
-    bool coincidence = false;
-    for (size_t i = 0; i < N; ++i) {
-        if (ds[i] > 0 && us[i] > 0) {
-            coincidence = true;
-            break;
-        }
-    }
-    return coincidence;
-}
-
-template <size_t N>
-int countNonZeroToT(const ROOT::RVec<Double_t>& tot) {
-    int count = 0;
-    for (size_t i = 0; i < N; ++i) {
-        if (tot[i] > 0) {
-            ++count;
-        }
-    }
-    return count;
-}
-
-
-template <size_t N>
-int computeToTSum(const ROOT::RVec<Double_t>& tot) {
-    Double_t totsum = 0;
-    for (size_t i = 0; i < N; ++i) {
-        if (tot[i] > 0) {
-            totsum = totsum+tot[i];
-        }
-    }
-    return totsum;
-}
-
-template <size_t N>
-std::vector<int> getActiveIndices(const ROOT::RVec<Double_t>& arr) {
-    std::vector<int> indices;
-    for (size_t i = 0; i < N; ++i) {
-        if (!std::isnan(arr[i]) && arr[i] > 0) {
-            indices.push_back(i);
-        }
-    }
-    return indices;
-}
-
-
-ROOT::VecOps::RVec<Double_t> filterVector(
-    const ROOT::VecOps::RVec<Double_t>& vec,
-    const std::function<bool(Double_t)>& pred) 
-{
-    ROOT::VecOps::RVec<Double_t> out(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i) {
-        out[i] = pred(vec[i]) ? vec[i] : NAN;
-    }
-    return out;
-}
-
-ROOT::VecOps::RVec<Double_t> barCoincidenceToT(
-    const ROOT::RVec<Double_t>& ds, 
-    const ROOT::RVec<Double_t>& us) {
-    ROOT::VecOps::RVec<Double_t> coinc(ds.size());
-    // bool coincidence = false;
-    for (size_t i = 0; i < ds.size(); ++i) {
-        if (ds[i] > 0 && us[i] > 0) {
-            coinc[i] = ds[i];
-        } else {
-            coinc[i] = std::nan("");
-        }
-    }
-    return coinc;
-}
-
-
-
-template <size_t N>
-void mergeIfUnset(std::array<Double_t, N>& out, const std::array<Double_t, N>& in) {
-    for (size_t i = 0; i < N; ++i) {
-        if (std::isnan(out[i]) && !std::isnan(in[i])) {
+        if (out[i] == INT32_UNSET && in[i] != INT32_UNSET) {
             out[i] = in[i];
         }
     }
@@ -132,6 +55,8 @@ void mergeIfUnset(Double_t& out, const Double_t& in) {
 void mergeIfUnset(ULong64_t& out, const ULong64_t& in) {
     if (out == UINT64_UNSET && in != UINT64_UNSET) {
         out = in;
+    } else if (out == 0 && in != 0 && in != UINT64_UNSET) {
+        out = in;
     }
 }
 
@@ -142,6 +67,59 @@ void mergeIfUnset(Bool_t& out, const Bool_t& in) {
     }
 }
 
+/**
+ * @brief Merges one TDC (or GATE) fragment into the event.
+ *
+ * Values already set in out are kept, only unset ones are taken from in.
+ * The detector arrays are only taken from the TDC that reads them out.
+ *
+ * @param out The merged event.
+ * @param in The fragment of one TDC.
+ * @param tdc The TDC ID of the fragment, 4 for the GATE.
+ */
+void DataFilter::mergeFragment(TDCEvent& out, const TDCEvent& in, int tdc) {
+    mergeIfUnset(out.trgLE,         in.trgLE);
+    mergeIfUnset(out.trgTE,         in.trgTE);
+
+    mergeIfUnset(out.eventID,       in.eventID);
+    mergeIfUnset(out.timestamp,     in.timestamp);
+    mergeIfUnset(out.cuspRunNumber, in.cuspRunNumber);
+    mergeIfUnset(out.tdcTimeTag,    in.tdcTimeTag);
+    mergeIfUnset(out.fpgaTimeTag,   in.fpgaTimeTag);
+    mergeIfUnset(out.tdcID,         in.tdcID);
+
+    switch (tdc) {
+        case 0:
+        case 1:
+            mergeIfUnset(out.hodoODsLE, in.hodoODsLE);
+            mergeIfUnset(out.hodoODsTE, in.hodoODsTE);
+            mergeIfUnset(out.hodoOUsLE, in.hodoOUsLE);
+            mergeIfUnset(out.hodoOUsTE, in.hodoOUsTE);
+            mergeIfUnset(out.hodoIDsLE, in.hodoIDsLE);
+            mergeIfUnset(out.hodoIDsTE, in.hodoIDsTE);
+            mergeIfUnset(out.hodoIUsLE, in.hodoIUsLE);
+            mergeIfUnset(out.hodoIUsTE, in.hodoIUsTE);
+            mergeIfUnset(out.tileOLE,   in.tileOLE);
+            mergeIfUnset(out.tileOTE,   in.tileOTE);
+            break;
+
+        case 2:
+            mergeIfUnset(out.tileILE,   in.tileILE);
+            mergeIfUnset(out.tileITE,   in.tileITE);
+            break;
+
+        case 3:
+            mergeIfUnset(out.bgoLE,     in.bgoLE);
+            mergeIfUnset(out.bgoTE,     in.bgoTE);
+            break;
+
+        case 4:
+            mergeIfUnset(out.mixGate,   in.mixGate);
+            mergeIfUnset(out.dumpGate,  in.dumpGate);
+            break;
+    }
+}
+
 void DataFilter::fileSorter(const char* inputFile, int last_evt, const char* outputFile) {
     auto log = Logger::getLogger();
 
@@ -152,11 +130,14 @@ void DataFilter::fileSorter(const char* inputFile, int last_evt, const char* out
     
     if (!file) {
         log->error("Failed to open or read ROOT file: {}", inputFile);
+        return;
     }
 
     log->debug("TFile opened");
-    TTree* tree = (TTree*)file->Get("RawEventTree");
-    log->debug("TFile->Get RawEventTree");
+    // The raw data can be a TTree or an RNTuple, independent of the output backend
+    const bool ntupleInput = isNTuple(file, "RawEventTree");
+    TTree* tree = ntupleInput ? nullptr : (TTree*)file->Get("RawEventTree");
+    log->debug("TFile->Get RawEventTree ({})", ntupleInput ? "RNTuple" : "TTree");
     
     // New output file
     // TFile* output;
@@ -181,6 +162,11 @@ void DataFilter::fileSorter(const char* inputFile, int last_evt, const char* out
         }
     }
 
+    // An RNTuple can not be extended, it is always written from the start
+    if (backend == OutputBackend::RNTuple) {
+        createNew = true;
+    }
+
 
     // if (TFile::Open(outputFile, "UPDATE")->IsZombie()){
     //     log->error("File {} is Zombie", outputFile);
@@ -203,48 +189,87 @@ void DataFilter::fileSorter(const char* inputFile, int last_evt, const char* out
     TDCEvent eventOut;
     TDCEvent eventIn;
 
+    std::unique_ptr<RNT::RNTupleReader> ntupleReader;
+    std::unique_ptr<RNT::REntry> readEntry;
+    std::map<std::pair<UInt_t, UInt_t>, std::uint64_t> fragmentIndex;   // (eventID, tdcID) -> entry
+    Int_t nr_evts = 0;
+
+    if (ntupleInput) {
+        ntupleReader = RNT::RNTupleReader::Open("RawEventTree", inputFile);
+        readEntry = ntupleReader->GetModel().CreateEntry();
+        bindEvent(*readEntry, eventIn);
+
+        // Only the two index fields are read to build the index
+        auto viewEventID = ntupleReader->GetView<UInt_t>("eventID");
+        auto viewTdcID = ntupleReader->GetView<UInt_t>("tdcID");
+        for (auto i : ntupleReader->GetEntryRange()) {
+            UInt_t evt = viewEventID(i);
+            fragmentIndex.emplace(std::make_pair(evt, viewTdcID(i)), i);
+            nr_evts = std::max(nr_evts, (Int_t)evt);
+        }
+    } else {
+        tree->SetBranchAddress("eventID",        &eventIn.eventID);
+        tree->SetBranchAddress("timestamp",      &eventIn.timestamp);
+        tree->SetBranchAddress("cuspRunNumber",  &eventIn.cuspRunNumber);
+        tree->SetBranchAddress("mixGate",        &eventIn.mixGate);
+        tree->SetBranchAddress("dumpGate",       &eventIn.dumpGate);
+        tree->SetBranchAddress("tdcTimeTag",     &eventIn.tdcTimeTag);
+        tree->SetBranchAddress("fpgaTimeTag",    &eventIn.fpgaTimeTag);
+        tree->SetBranchAddress("trgLE",          &eventIn.trgLE);
+        tree->SetBranchAddress("trgTE",          &eventIn.trgTE);
+
+        tree->SetBranchAddress("hodoIDsLE",      &eventIn.hodoIDsLE);
+        tree->SetBranchAddress("hodoIUsLE",      &eventIn.hodoIUsLE);
+        tree->SetBranchAddress("hodoODsLE",      &eventIn.hodoODsLE);
+        tree->SetBranchAddress("hodoOUsLE",      &eventIn.hodoOUsLE);
+        tree->SetBranchAddress("hodoIDsTE",      &eventIn.hodoIDsTE);
+        tree->SetBranchAddress("hodoIUsTE",      &eventIn.hodoIUsTE);
+        tree->SetBranchAddress("hodoODsTE",      &eventIn.hodoODsTE);
+        tree->SetBranchAddress("hodoOUsTE",      &eventIn.hodoOUsTE);
+
+        tree->SetBranchAddress("bgoLE",          &eventIn.bgoLE);
+        tree->SetBranchAddress("bgoTE",          &eventIn.bgoTE);
+
+        tree->SetBranchAddress("tileILE",        &eventIn.tileILE);
+        tree->SetBranchAddress("tileITE",        &eventIn.tileITE);
+        tree->SetBranchAddress("tileOLE",        &eventIn.tileOLE);
+        tree->SetBranchAddress("tileOTE",        &eventIn.tileOTE);
+
+        tree->SetBranchAddress("tdcID",          &eventIn.tdcID);
+
+        TTreeIndex* new_ind = new TTreeIndex(tree, "eventID", "tdcID");
+        tree->SetTreeIndex(new_ind);
+        nr_evts = (Int_t)tree->GetMaximum("eventID");
+    }
 
-    tree->SetBranchAddress("eventID",        &eventIn.eventID);
-    tree->SetBranchAddress("timestamp",      &eventIn.timestamp);
-    tree->SetBranchAddress("cuspRunNumber",  &eventIn.cuspRunNumber);
-    tree->SetBranchAddress("mixGate",        &eventIn.mixGate);
-    tree->SetBranchAddress("dumpGate",       &eventIn.dumpGate);
-    tree->SetBranchAddress("tdcTimeTag",     &eventIn.tdcTimeTag);
-    tree->SetBranchAddress("fpgaTimeTag",    &eventIn.fpgaTimeTag);
-    tree->SetBranchAddress("trgLE",          &eventIn.trgLE);
-    tree->SetBranchAddress("trgTE",          &eventIn.trgTE);
-
-    tree->SetBranchAddress("hodoIDsLE",      &eventIn.hodoIDsLE);
-    tree->SetBranchAddress("hodoIUsLE",      &eventIn.hodoIUsLE);
-    tree->SetBranchAddress("hodoODsLE",      &eventIn.hodoODsLE);
-    tree->SetBranchAddress("hodoOUsLE",      &eventIn.hodoOUsLE);
-    tree->SetBranchAddress("hodoIDsTE",      &eventIn.hodoIDsTE);
-    tree->SetBranchAddress("hodoIUsTE",      &eventIn.hodoIUsTE);
-    tree->SetBranchAddress("hodoODsTE",      &eventIn.hodoODsTE);
-    tree->SetBranchAddress("hodoOUsTE",      &eventIn.hodoOUsTE);
-    // tree->SetBranchAddress("hodoIDsToT",     &eventIn.hodoIDsToT);
-    // tree->SetBranchAddress("hodoIUsToT",     &eventIn.hodoIUsToT);
-    // tree->SetBranchAddress("hodoODsToT",     &eventIn.hodoODsToT);
-    // tree->SetBranchAddress("hodoOUsToT",     &eventIn.hodoOUsToT);
-
-    tree->SetBranchAddress("bgoLE",          &eventIn.bgoLE);
-    tree->SetBranchAddress("bgoTE",          &eventIn.bgoTE);
-    // tree->SetBranchAddress("bgoToT",         &eventIn.bgoToT);
-
-    tree->SetBranchAddress("tileILE",        &eventIn.tileILE);
-    tree->SetBranchAddress("tileITE",        &eventIn.tileITE);
-    // tree->SetBranchAddress("tileIToT",       &eventIn.tileIToT);
-    tree->SetBranchAddress("tileOLE",        &eventIn.tileOLE);
-    tree->SetBranchAddress("tileOTE",        &eventIn.tileOTE);
-    // tree->SetBranchAddress("tileOToT",       &eventIn.tileOToT);
-
-    tree->SetBranchAddress("tdcID",          &eventIn.tdcID);
-    // tree->SetBranchAddress("tdcChannel",     &eventIn.tdcChannel);
-    // tree->SetBranchAddress("tdcTime",        &eventIn.tdcTime);
-
-
-    if (createNew){
+    // Loads the fragment of one TDC into eventIn, false if there is none
+    auto readFragment = [&](Int_t evt, Int_t tdc) {
+        if (ntupleInput) {
+            auto it = fragmentIndex.find(std::make_pair((UInt_t)evt, (UInt_t)tdc));
+            if (it == fragmentIndex.end()) return false;
+            ntupleReader->LoadEntry(it->second, *readEntry);
+            return true;
+        }
+        Int_t j = (Int_t) tree->GetEntryNumberWithIndex(evt, tdc);
+        if (j < 0) return false;
+        tree->GetEntry(j);
+        return true;
+    };
+
+    std::unique_ptr<RNT::RNTupleWriter> ntupleWriter;
+    std::unique_ptr<RNT::REntry> writeEntry;
+
+    if (createNew && backend == OutputBackend::RNTuple) {
         output = new TFile(outputFile, "RECREATE");
+        io.apply(output);
+        log->debug("TFile recreated, writing RNTuple");
+        ntupleWriter = RNT::RNTupleWriter::Append(makeEventModel(), "RawEventTree", *output, io.ntupleOptions());
+        writeEntry = ntupleWriter->CreateEntry();
+        bindEvent(*writeEntry, eventOut);
+
+    } else if (createNew){
+        output = new TFile(outputFile, "RECREATE");
+        io.apply(output);
         log->debug("TFile recreated");
         newTree = new TTree("RawEventTree", "TDCs Merged");
 
@@ -253,39 +278,41 @@ void DataFilter::fileSorter(const char* inputFile, int last_evt, const char* out
         newTree->Branch("cuspRunNumber",  &eventOut.cuspRunNumber,      "cuspRunNumber/i"  );
         newTree->Branch("mixGate",        &eventOut.mixGate,            "mixGate/O");
         newTree->Branch("dumpGate",       &eventOut.dumpGate,           "dumpGate/O");
-        newTree->Branch("tdcTimeTag",     &eventOut.tdcTimeTag,         "tdcTimeTag/D");
-        newTree->Branch("fpgaTimeTag",    &eventOut.fpgaTimeTag,        "fpgaTimeTag/D");
-        newTree->Branch("trgLE",          eventOut.trgLE.data(),        "trgLE[4]/D");
-        newTree->Branch("trgTE",          eventOut.trgTE.data(),        "trgTE[4]/D");
-
-        newTree->Branch("hodoIDsLE",      eventOut.hodoIDsLE.data(),    "hodoIDsLE[32]/D");
-        newTree->Branch("hodoIUsLE",      eventOut.hodoIUsLE.data(),    "hodoIUsLE[32]/D");
-        newTree->Branch("hodoODsLE",      eventOut.hodoODsLE.data(),    "hodoODsLE[32]/D");
-        newTree->Branch("hodoOUsLE",      eventOut.hodoOUsLE.data(),    "hodoOUsLE[32]/D");
-        newTree->Branch("hodoIDsTE",      eventOut.hodoIDsTE.data(),    "hodoIDsTE[32]/D");
-        newTree->Branch("hodoIUsTE",      eventOut.hodoIUsTE.data(),    "hodoIUsTE[32]/D");
-        newTree->Branch("hodoODsTE",      eventOut.hodoODsTE.data(),    "hodoODsTE[32]/D");
-        newTree->Branch("hodoOUsTE",      eventOut.hodoOUsTE.data(),    "hodoOUsTE[32]/D");
+        newTree->Branch("tdcTimeTag",     &eventOut.tdcTimeTag,         "tdcTimeTag/l");
+        newTree->Branch("fpgaTimeTag",    &eventOut.fpgaTimeTag,        "fpgaTimeTag/l");
+        newTree->Branch("trgLE",          eventOut.trgLE.data(),        "trgLE[4]/I");
+        newTree->Branch("trgTE",          eventOut.trgTE.data(),        "trgTE[4]/I");
+
+        newTree->Branch("hodoIDsLE",      eventOut.hodoIDsLE.data(),    "hodoIDsLE[32]/I");
+        newTree->Branch("hodoIUsLE",      eventOut.hodoIUsLE.data(),    "hodoIUsLE[32]/I");
+        newTree->Branch("hodoODsLE",      eventOut.hodoODsLE.data(),    "hodoODsLE[32]/I");
+        newTree->Branch("hodoOUsLE",      eventOut.hodoOUsLE.data(),    "hodoOUsLE[32]/I");
+        newTree->Branch("hodoIDsTE",      eventOut.hodoIDsTE.data(),    "hodoIDsTE[32]/I");
+        newTree->Branch("hodoIUsTE",      eventOut.hodoIUsTE.data(),    "hodoIUsTE[32]/I");
+        newTree->Branch("hodoODsTE",      eventOut.hodoODsTE.data(),    "hodoODsTE[32]/I");
+        newTree->Branch("hodoOUsTE",      eventOut.hodoOUsTE.data(),    "hodoOUsTE[32]/I");
         // newTree->Branch("hodoIDsToT",     &eventOut.hodoIDsToT);
         // newTree->Branch("hodoIUsToT",     &eventOut.hodoIUsToT);
         // newTree->Branch("hodoODsToT",     &eventOut.hodoODsToT);
         // newTree->Branch("hodoOUsToT",     &eventOut.hodoOUsToT);
 
-        newTree->Branch("bgoLE",          eventOut.bgoLE.data(),        "bgoLE[64]/D");
-        newTree->Branch("bgoTE",          eventOut.bgoTE.data(),        "bgoTE[64]/D");
+        newTree->Branch("bgoLE",          eventOut.bgoLE.data(),        "bgoLE[64]/I");
+        newTree->Branch("bgoTE",          eventOut.bgoTE.data(),        "bgoTE[64]/I");
         // newTree->Branch("bgoToT",         &eventOut.bgoToT);
 
-        newTree->Branch("tileILE",        eventOut.tileILE.data(),      "tileILE[120]/D");
-        newTree->Branch("tileITE",        eventOut.tileITE.data(),      "tileITE[120]/D");
+        newTree->Branch("tileILE",        eventOut.tileILE.data(),      "tileILE[120]/I");
+        newTree->Branch("tileITE",        eventOut.tileITE.data(),      "tileITE[120]/I");
         // newTree->Branch("tileIToT",       &eventOut.tileIToT);
-        newTree->Branch("tileOLE",        eventOut.tileOLE.data(),      "tileOLE[120]/D");
-        newTree->Branch("tileOTE",        eventOut.tileOTE.data(),      "tileOTE[120]/D");
+        newTree->Branch("tileOLE",        eventOut.tileOLE.data(),      "tileOLE[120]/I");
+        newTree->Branch("tileOTE",        eventOut.tileOTE.data(),      "tileOTE[120]/I");
         // newTree->Branch("tileOToT",       &eventOut.tileOToT);
 
         newTree->Branch("tdcID",          &eventOut.tdcID,              "tdcID[4]/i");
         // newTree->Branch("tdcChannel",     &eventOut.tdcChannel);
         // newTree->Branch("tdcTime",        &eventOut.tdcTime);
 
+        io.apply(newTree);
+
 
     } else {
         output = new TFile(outputFile, "UPDATE");
@@ -298,149 +325,106 @@ void DataFilter::fileSorter(const char* inputFile, int last_evt, const char* out
         }
     }
 
-    // Map to store merged events by eventID
-    std::map<uint32_t, TDCEvent> mergedEvents;
-
-    TTreeIndex* new_ind = new TTreeIndex(tree, "eventID", "tdcID");
-    tree->SetTreeIndex(new_ind);
-    Int_t nr_evts = (Int_t)tree->GetMaximum("eventID");
+    // The first event of a run must have TDC and GATE data with the same ID,
+    // otherwise the event counters were not reset at the run start or switch
+    bool checkFirst = (last_evt < 0);
 
     for (Int_t evt = last_evt +1 ; evt < nr_evts; evt++){
         eventOut.reset();
 
+        bool hasTdc = false;
+        bool hasGate = false;
         for (Int_t tdc = 0; tdc < 5; tdc++){
+            if (!readFragment(evt, tdc)) continue;
+            mergeFragment(eventOut, eventIn, tdc);
+            (tdc == 4 ? hasGate : hasTdc) = true;
+        }
 
-            Int_t j = (Int_t) tree->GetEntryNumberWithIndex(evt, tdc);
-            if (j < 0) continue;
-
-            tree->GetEntry(j);
-
-            mergeIfUnset(eventOut.trgLE,         eventIn.trgLE);
-            mergeIfUnset(eventOut.trgTE,         eventIn.trgTE);
-
-            mergeIfUnset(eventOut.eventID,       eventIn.eventID);
-            mergeIfUnset(eventOut.timestamp,     eventIn.timestamp);
-            mergeIfUnset(eventOut.cuspRunNumber, eventIn.cuspRunNumber);
-            //mergeIfUnset(eventOut.mixGate,       eventIn.mixGate);
-            //mergeIfUnset(eventOut.dumpGate,      eventIn.dumpGate);
-            mergeIfUnset(eventOut.tdcTimeTag,    eventIn.tdcTimeTag);
-            mergeIfUnset(eventOut.fpgaTimeTag,   eventIn.fpgaTimeTag);
-            mergeIfUnset(eventOut.tdcID,         eventIn.tdcID);
-
-            switch (tdc) {
-                case 0:
-                    mergeIfUnset(eventOut.hodoODsLE, eventIn.hodoODsLE);
-                    mergeIfUnset(eventOut.hodoODsTE, eventIn.hodoODsTE);
-                    mergeIfUnset(eventOut.hodoOUsLE, eventIn.hodoOUsLE);
-                    mergeIfUnset(eventOut.hodoOUsTE, eventIn.hodoOUsTE);
-                    mergeIfUnset(eventOut.hodoIDsLE, eventIn.hodoIDsLE);
-                    mergeIfUnset(eventOut.hodoIDsTE, eventIn.hodoIDsTE);
-                    mergeIfUnset(eventOut.hodoIUsLE, eventIn.hodoIUsLE);
-                    mergeIfUnset(eventOut.hodoIUsTE, eventIn.hodoIUsTE);
-                    mergeIfUnset(eventOut.tileOLE,   eventIn.tileOLE);
-                    mergeIfUnset(eventOut.tileOTE,   eventIn.tileOTE);
-                    break;
-
-                case 1:
-                    mergeIfUnset(eventOut.hodoODsLE, eventIn.hodoODsLE);
-                    mergeIfUnset(eventOut.hodoODsTE, eventIn.hodoODsTE);
-                    mergeIfUnset(eventOut.hodoOUsLE, eventIn.hodoOUsLE);
-                    mergeIfUnset(eventOut.hodoOUsTE, eventIn.hodoOUsTE);
-                    mergeIfUnset(eventOut.hodoIDsLE, eventIn.hodoIDsLE);
-                    mergeIfUnset(eventOut.hodoIDsTE, eventIn.hodoIDsTE);
-                    mergeIfUnset(eventOut.hodoIUsLE, eventIn.hodoIUsLE);
-                    mergeIfUnset(eventOut.hodoIUsTE, eventIn.hodoIUsTE);
-                    mergeIfUnset(eventOut.tileOLE,   eventIn.tileOLE);
-                    mergeIfUnset(eventOut.tileOTE,   eventIn.tileOTE);
-                    break;
-
-                case 2:
-                    mergeIfUnset(eventOut.tileILE,   eventIn.tileILE);
-                    mergeIfUnset(eventOut.tileITE,   eventIn.tileITE);
-                    break;
-
-                case 3:
-                    mergeIfUnset(eventOut.bgoLE,     eventIn.bgoLE);
-                    mergeIfUnset(eventOut.bgoTE,     eventIn.bgoTE);
-                    break;
-                
-                case 4:
-                    mergeIfUnset(eventOut.mixGate,   eventIn.mixGate);
-                    mergeIfUnset(eventOut.dumpGate,  eventIn.dumpGate);
-                    break;
+        if (checkFirst && hasTdc) {
+            if (!hasGate) {
+                log->error("The first event {} of {} has no GATE data, the TDC and GATE event IDs do not match", evt, inputFile);
             }
-
+            checkFirst = false;
         }
 
-        convertTime(eventOut);
-        newTree->Fill();
+        if (ntupleWriter) {
+            ntupleWriter->Fill(*writeEntry);
+        } else {
+            newTree->Fill();
+        }
 
     }
 
     output->cd();
-    newTree->Write("", TObject::kOverwrite);
+    if (newTree) {
+        newTree->Write("", TObject::kOverwrite);
+    }
+    ntupleWriter.reset();   // commits the RNTuple before the file is closed
+    TickSizes::read(file).write(output);
+    ScalerTree::copy(file, output);
+    DeadTimeTree::copy(file, output);
+    OnlineFilterTree::copy(file, output);
     output->Close();
 
 }
 
-void DataFilter::convertTime(TDCEvent& event) {
-    Double_t ns = 0.1;
-    Double_t clock_ns = 25;
-    Double_t fpgaclock_ns = 20;
-    for (int i = 0; i < 32; i++) {
-        event.hodoIDsLE[i] *= ns;
-        event.hodoIDsTE[i] *= ns;
-        event.hodoIUsLE[i] *= ns;
-        event.hodoIUsTE[i] *= ns;
-        event.hodoODsLE[i] *= ns;
-        event.hodoODsTE[i] *= ns;
-        event.hodoOUsLE[i] *= ns;
-        event.hodoOUsTE[i] *= ns;
-    }
-    for (int i = 0; i < 120; i++) {
-        event.tileILE[i] *= ns;
-        event.tileITE[i] *= ns;
-        event.tileOLE[i] *= ns;
-        event.tileOTE[i] *= ns;
-    }
-    for (int i = 0; i < 64; i++) {
-        event.bgoLE[i] *= ns;
-        event.bgoTE[i] *= ns;
-    }
-    for (int i = 0; i < 4; i++) {
-        event.trgLE[i] *= ns;
-        event.trgTE[i] *= ns;
-    }
-    event.tdcTimeTag *= clock_ns;
-    event.fpgaTimeTag *= fpgaclock_ns;
-    
-}
-
-
-void DataFilter::filterAndSave(const char* inputFile, int last_evt) {
-
+/**
+ * @brief Enables ROOT's implicit multi-threading for the RDataFrame event loops.
+ *
+ * @param nThreads Number of worker threads, 0 uses all available cores and
+ *                 1 keeps the event loop single-threaded.
+ */
+void DataFilter::enableMultiThreading(unsigned int nThreads) {
     auto log = Logger::getLogger();
 
-    // Load ROOT file
-    ROOT::RDataFrame df("RawEventTree", inputFile);
+    if (nThreads == 1) {
+        log->info("Running RDataFrame single-threaded");
+        return;
+    }
 
-    auto nEntriesBeforeCuts = df.Count();
-    double eventsUncut = static_cast<double>(*nEntriesBeforeCuts);
-    log->info("{} events before cuts", eventsUncut);
+    ROOT::EnableImplicitMT(nThreads);
+    log->info("Implicit multi-threading enabled with {} threads", ROOT::GetThreadPoolSize());
+}
 
-    auto filtered_df = df.Filter("eventID > " + std::to_string(last_evt), "New Events")
+/**
+ * @brief Builds the filter graph shared by all analysis modes.
+ *
+ * All nodes are booked lazily, nothing is read from the file before an
+ * action on the returned node is triggered. Columns that are not needed by
+ * any action are never computed.
+ *
+ * The hit times are read as integer TDC ticks, they are only converted to ns
+ * where a Define needs them (ToT and time tags).
+ *
+ * @param df The data frame holding the merged RawEventTree.
+ * @param last_evt Only events with an eventID larger than this are kept.
+ * @param ticks The tick sizes stored in the input file.
+ * @return The filtered node, including ToT, counts and active channel lists,
+ *         and the tracks if the reconstruction is enabled.
+ */
+ROOT::RDF::RNode DataFilter::buildFilterGraph(ROOT::RDF::RNode df, int last_evt, const TickSizes& ticks) {
+
+    const Int_t leCutTicks = static_cast<Int_t>(LE_CUT / ticks.tdc_ns);
+    const Double_t ettt_ns = ticks.ettt_ns;
+    const Double_t fpga_ns = ticks.fpga_ns;
+
+    auto filtered = df.Filter("eventID > " + std::to_string(last_evt), "New Events")
             //.Filter("bgoLE < " + std::to_string(LE_CUT), "Time Cut")
+            .Define("tdcTimeTag_ns",
+                [ettt_ns](ULong64_t t) { return (t == UINT64_UNSET) ? NAN : t * ettt_ns; }, {"tdcTimeTag"})
+            .Define("fpgaTimeTag_ns",
+                [fpga_ns](ULong64_t t) { return (t == UINT64_UNSET) ? NAN : t * fpga_ns; }, {"fpgaTimeTag"})
             .Define("bgoLE_tCut", 
-                [this](const ROOT::RVec<Double_t>& le) {
-                    return filterVector(le, [this](Double_t x) { return x < LE_CUT && x > 0; });
+                [leCutTicks](const ROOT::RVec<Int_t>& le) {
+                    return filterTicks(le, [leCutTicks](Int_t x) { return x < leCutTicks && x > 0; });
                 }, {"bgoLE"})
-            .Define("hodoODsToT", computeToT<32>, {"hodoODsLE", "hodoODsTE"})
-            .Define("hodoOUsToT", computeToT<32>, {"hodoOUsLE", "hodoOUsTE"})
-            .Define("hodoIDsToT", computeToT<32>, {"hodoIDsLE", "hodoIDsTE"})
-            .Define("hodoIUsToT", computeToT<32>, {"hodoIUsLE", "hodoIUsTE"})
-            .Define("bgoToT", computeToT<64>, {"bgoLE_tCut", "bgoTE"})
-            .Define("tileIToT", computeToT<120>, {"tileILE", "tileITE"})
-            .Define("tileOToT", computeToT<120>, {"tileOLE", "tileOTE"})
+            .Define("hodoODsToT", computeToTns<32>(ticks.tdc_ns), {"hodoODsLE", "hodoODsTE"})
+            .Define("hodoOUsToT", computeToTns<32>(ticks.tdc_ns), {"hodoOUsLE", "hodoOUsTE"})
+            .Define("hodoIDsToT", computeToTns<32>(ticks.tdc_ns), {"hodoIDsLE", "hodoIDsTE"})
+            .Define("hodoIUsToT", computeToTns<32>(ticks.tdc_ns), {"hodoIUsLE", "hodoIUsTE"})
+            .Define("bgoToT", computeToTns<64>(ticks.tdc_ns), {"bgoLE_tCut", "bgoTE"})
+            .Define("tileIToT", computeToTns<120>(ticks.tdc_ns), {"tileILE", "tileITE"})
+            .Define("tileOToT", computeToTns<120>(ticks.tdc_ns), {"tileOLE", "tileOTE"})
             .Define("bgoCts", countNonZeroToT<64>, {"bgoToT"})
             .Define("bgoToTSum", computeToTSum<64>, {"bgoToT"})
             .Define("barODsToT", barCoincidenceToT, {"hodoODsToT", "hodoOUsToT"})
@@ -463,160 +447,198 @@ void DataFilter::filterAndSave(const char* inputFile, int last_evt) {
             .Define("tileI_Channels", getActiveIndices<120>, {"tileIToT"})
             ;
 
-    auto nEntriesAfterCuts = filtered_df.Count();
-    double eventsCut = static_cast<double>(*nEntriesAfterCuts);
-    log->info("{} events after cuts", eventsCut);
-
-    ROOT::RDF::RSnapshotOptions opts;
-    opts.fMode = "update"; // was "update"
-    opts.fOverwriteIfExists = true;
-    filtered_df.Snapshot("EventTree", inputFile, "", opts);
-
+    return hodo.enabled ? defineTracks(filtered, ticks) : filtered;
+}
 
+/**
+ * @brief Adds the track reconstruction to the filtered events.
+ *
+ * barIZ and barOZ hold the z position of each bar, the tracks are computed
+ * once per event into hodoTracks (not saved) and split into the columns
+ * nTracks, trackPhiI, trackZI, trackPhiO, trackZO, trackBgoX, trackBgoY,
+ * vertexX and vertexY.
+ */
+ROOT::RDF::RNode DataFilter::defineTracks(ROOT::RDF::RNode df, const TickSizes& ticks) const {
+    const HodoGeometry geometry = hodo;
+    const Double_t tick_ns = ticks.tdc_ns;
+    using ToT = ROOT::RVec<Double_t>;
+
+    auto z = [geometry, tick_ns](const ROOT::RVec<Int_t>& dsLE, const ROOT::RVec<Int_t>& usLE, const ToT& dsToT, const ToT& usToT) {
+        return barZ(dsLE, usLE, dsToT, usToT, tick_ns, geometry);
+    };
+
+    return df.Define("barIZ", z, {"hodoIDsLE", "hodoIUsLE", "hodoIDsToT", "hodoIUsToT"})
+             .Define("barOZ", z, {"hodoODsLE", "hodoOUsLE", "hodoODsToT", "hodoOUsToT"})
+             .Define("hodoTracks",
+                [geometry](const ToT& zI, const ToT& totI, const ToT& zO, const ToT& totO) {
+                    return reconstructTracks(zI, totI, zO, totO, geometry);
+                }, {"barIZ", "barIDsToT", "barOZ", "barODsToT"})
+             .Define("nTracks", [](const HodoTracks& t) { return static_cast<Int_t>(t.phiI.size()); }, {"hodoTracks"})
+             .Define("trackPhiI", [](const HodoTracks& t) { return t.phiI; }, {"hodoTracks"})
+             .Define("trackZI", [](const HodoTracks& t) { return t.zI; }, {"hodoTracks"})
+             .Define("trackPhiO", [](const HodoTracks& t) { return t.phiO; }, {"hodoTracks"})
+             .Define("trackZO", [](const HodoTracks& t) { return t.zO; }, {"hodoTracks"})
+             .Define("trackBgoX", [](const HodoTracks& t) { return t.bgoX; }, {"hodoTracks"})
+             .Define("trackBgoY", [](const HodoTracks& t) { return t.bgoY; }, {"hodoTracks"})
+             .Define("vertexX", [](const HodoTracks& t) { return t.vertexX; }, {"hodoTracks"})
+             .Define("vertexY", [](const HodoTracks& t) { return t.vertexY; }, {"hodoTracks"});
 }
 
-void DataFilter::filterAndSend(const char* inputFile, int last_evt, zmq::socket_t& socket) {
+/**
+ * @brief Runs the filter graph over a merged ROOT file in a single event loop.
+ *
+ * The counters, the EventTree snapshot, its Arrow or Parquet export, the
+ * summary histograms and the monitoring histograms for the GUI are all filled
+ * in the same event loop, so the input file is read only once. With implicit multi-threading every slot fills its own histograms,
+ * they are merged before sending.
+ *
+ * @param inputFile The merged ROOT file, the EventTree is written into it.
+ * @param last_evt Only events with an eventID larger than this are processed.
+ * @param save If true, the filtered events are saved as EventTree.
+ * @param socket If not null, the monitoring histograms are sent to the GUI.
+ * @param sendEnd If true, an END message with the event counts is sent last.
+ * @param summary If not null, the summary histograms are booked and filled.
+ */
+void DataFilter::runFilter(const char* inputFile, int last_evt, bool save, zmq::socket_t* socket, bool sendEnd, SummaryPlots* summary) {
 
     auto log = Logger::getLogger();
 
-    // Load ROOT file
-    ROOT::RDataFrame df("RawEventTree", inputFile);
+    TickSizes ticks;
+    {
+        std::unique_ptr<TFile> file(TFile::Open(inputFile, "READ"));
+        if (file && !file->IsZombie()) {
+            ticks = TickSizes::read(file.get());
+        }
+    }
 
-    auto nEntriesBeforeCuts = df.Count();
-    double eventsUncut = static_cast<double>(*nEntriesBeforeCuts);
-    log->info("{} events before cuts", eventsUncut);
+    // Load ROOT file, RDataFrame reads a TTree or an RNTuple with the same columns
+    ROOT::RDataFrame df("RawEventTree", inputFile);
     log->debug("Reading from event {}", last_evt);
 
-    auto filtered_df = df.Filter("eventID > " + std::to_string(last_evt), "New Events")
-                        //.Filter("bgoLE < " + std::to_string(LE_CUT), "Time Cut")
-                        .Define("bgoLE_tCut", 
-                            [this](const ROOT::RVec<Double_t>& le) {
-                                return filterVector(le, [this](Double_t x) { return x < LE_CUT && x > 0; });
-                            }, {"bgoLE"})
-                        .Define("hodoODsToT", computeToT<32>, {"hodoODsLE", "hodoODsTE"})
-                        .Define("hodoOUsToT", computeToT<32>, {"hodoOUsLE", "hodoOUsTE"})
-                        .Define("hodoIDsToT", computeToT<32>, {"hodoIDsLE", "hodoIDsTE"})
-                        .Define("hodoIUsToT", computeToT<32>, {"hodoIUsLE", "hodoIUsTE"})
-                        .Define("bgoToT", computeToT<64>, {"bgoLE_tCut", "bgoTE"})
-                        .Define("tileIToT", computeToT<120>, {"tileILE", "tileITE"})
-                        .Define("tileOToT", computeToT<120>, {"tileOLE", "tileOTE"})
-                        .Define("bgoCts", countNonZeroToT<64>, {"bgoToT"})
-
-                        .Define("barODsToT", barCoincidenceToT, {"hodoODsToT", "hodoOUsToT"})
-                        .Define("barOUsToT", barCoincidenceToT, {"hodoOUsToT", "hodoODsToT"})
-                        .Define("barIDsToT", barCoincidenceToT, {"hodoIDsToT", "hodoIUsToT"})
-                        .Define("barIUsToT", barCoincidenceToT, {"hodoIUsToT", "hodoIDsToT"})
-                        .Filter(barCoincidence<32>, {"barODsToT", "barOUsToT"})
-                        .Filter(barCoincidence<32>, {"barIDsToT", "barIUsToT"})
-                        .Define("barODsCts", countNonZeroToT<32>, {"barODsToT"})
-                        .Define("barOUsCts", countNonZeroToT<32>, {"barOUsToT"})
-                        .Define("barIDsCts", countNonZeroToT<32>, {"barIDsToT"})
-                        .Define("barIUsCts", countNonZeroToT<32>, {"barIUsToT"})
-                        .Filter("bgoCts > 1", "BGO Cut")      // uncomment if BGO is used
-                        .Define("bgo_Channels", getActiveIndices<64>, {"bgoToT"})
-
-                        ;
+    auto filtered_df = buildFilterGraph(df, last_evt, ticks);
 
+    // Book all actions before triggering the event loop
+    auto nEntriesBeforeCuts = df.Count();
     auto nEntriesAfterCuts = filtered_df.Count();
-    double eventsCut = static_cast<double>(*nEntriesAfterCuts);
-    log->info("{} events after cuts", eventsCut);
-
-
-    // Process filtered results
-    filtered_df.Foreach([&socket](uint32_t eventID, double tdcTimeTag, bool mixGate, const std::vector<int>& bgo_Channels) {
-        std::stringstream ss;
-        ss << eventID << " " << tdcTimeTag << " " << mixGate;
-
-        for (int ch : bgo_Channels) {
-            ss << " " << ch;
+    auto nEntriesAfterCutsGate = filtered_df.Filter([](Bool_t mixGate) { return mixGate == true; }, {"mixGate"}).Count();
+
+    // Kept until the event loop has run, a lazy snapshot whose result is dropped is never written
+    ROOT::RDF::RResultPtr<ROOT::RDF::RInterface<ROOT::Detail::RDF::RLoopManager>> snapshot;
+    if (save) {
+        ROOT::RDF::RSnapshotOptions opts;
+        opts.fMode = "update";
+        opts.fOverwriteIfExists = true;
+        opts.fLazy = true;
+        opts.fCompressionAlgorithm = io.compressionAlgorithm;
+        opts.fCompressionLevel = io.compressionLevel;
+        opts.fAutoFlush = static_cast<int>(io.clusterSize);
+        if (backend == OutputBackend::RNTuple) {
+            opts.fOutputFormat = ROOT::RDF::ESnapshotOutputFormat::kRNTuple;
         }
+        // hodoTracks has no dictionary, its members are saved as separate columns
+        snapshot = filtered_df.Snapshot("EventTree", inputFile, hodo.enabled ? "^(?!hodoTracks$).*" : "", opts);
+    }
 
-        zmq::message_t message(ss.str().c_str(), ss.str().size());
-        socket.send(message, zmq::send_flags::none);
-
-    }, {"eventID", "tdcTimeTag", "mixGate", "bgo_Channels"});
-
-    log->debug("Filtered data sent to GUI.");
-}
-
-
-
-void DataFilter::filterAndSaveAndSend(const char* inputFile, int last_evt, zmq::socket_t& socket) {
-
-    auto log = Logger::getLogger();
+#ifdef HODO_WITH_ARROW
+    ROOT::RDF::RResultPtr<ULong64_t> nExported;     // kept until the event loop has run
+#endif
+    if (save && exportFormat != ExportFormat::None) {
+#ifdef HODO_WITH_ARROW
+        nExported = ArrowEventWriter::book(filtered_df, exportFileName(inputFile, exportFormat), exportFormat);
+#else
+        log->warn("export_format={} ignored, hodo_analysis was built without HODO_WITH_ARROW", exportFormatName(exportFormat));
+#endif
+    }
 
-    // Load ROOT file
-    ROOT::RDataFrame df("RawEventTree", inputFile);
+    if (summary) summary->book(filtered_df);
+
+    // One set of monitoring histograms per slot, merged after the event loop
+    std::vector<MonitorHistograms> monitors(socket ? filtered_df.GetNSlots() : 0);
+    if (socket) {
+        // Instant action, runs the event loop for all actions booked above
+        filtered_df.ForeachSlot(
+            [&monitors](unsigned int slot, Double_t tdcTimeTag_ns, Bool_t mixGate,
+                        const ROOT::RVec<Double_t>& bgoToT,
+                        const ROOT::RVec<Double_t>& barOToT,
+                        const ROOT::RVec<Double_t>& barIToT) {
+                monitors[slot].fill(tdcTimeTag_ns, mixGate, bgoToT, barOToT, barIToT);
+            },
+            {"tdcTimeTag_ns", "mixGate", "bgoToT", "barODsToT", "barIDsToT"});
+    }
 
-    auto nEntriesBeforeCuts = df.Count();
+    // Without a socket the first access runs the event loop for all booked actions
     double eventsUncut = static_cast<double>(*nEntriesBeforeCuts);
-    log->info("{} events before cuts", eventsUncut);
-
-    auto filtered_df = df.Filter("eventID > " + std::to_string(last_evt), "New Events")
-            //.Filter("bgoLE < " + std::to_string(LE_CUT), "Time Cut")
-            .Define("bgoLE_tCut", 
-                [this](const ROOT::RVec<Double_t>& le) {
-                    return filterVector(le, [this](Double_t x) { return x < LE_CUT && x > 0; });
-                }, {"bgoLE"})
-            .Define("hodoODsToT", computeToT<32>, {"hodoODsLE", "hodoODsTE"})
-            .Define("hodoOUsToT", computeToT<32>, {"hodoOUsLE", "hodoOUsTE"})
-            .Define("hodoIDsToT", computeToT<32>, {"hodoIDsLE", "hodoIDsTE"})
-            .Define("hodoIUsToT", computeToT<32>, {"hodoIUsLE", "hodoIUsTE"})
-            .Define("bgoToT", computeToT<64>, {"bgoLE_tCut", "bgoTE"})
-            .Define("tileIToT", computeToT<120>, {"tileILE", "tileITE"})
-            .Define("tileOToT", computeToT<120>, {"tileOLE", "tileOTE"})
-            .Define("bgoCts", countNonZeroToT<64>, {"bgoToT"})
-            .Define("barODsToT", barCoincidenceToT, {"hodoODsToT", "hodoOUsToT"})
-            .Define("barOUsToT", barCoincidenceToT, {"hodoOUsToT", "hodoODsToT"})
-            .Define("barIDsToT", barCoincidenceToT, {"hodoIDsToT", "hodoIUsToT"})
-            .Define("barIUsToT", barCoincidenceToT, {"hodoIUsToT", "hodoIDsToT"})
-            .Filter(barCoincidence<32>, {"barODsToT", "barOUsToT"})
-            .Filter(barCoincidence<32>, {"barIDsToT", "barIUsToT"})
-            .Define("barODsCts", countNonZeroToT<32>, {"barODsToT"})
-            .Define("barOUsCts", countNonZeroToT<32>, {"barOUsToT"})
-            .Define("barIDsCts", countNonZeroToT<32>, {"barIDsToT"})
-            .Define("barIUsCts", countNonZeroToT<32>, {"barIUsToT"})
-            .Filter("bgoCts > 1", "BGO Cut")      // uncomment if BGO is used
-            .Define("bgo_Channels", getActiveIndices<64>, {"bgoToT"})
-            .Define("barO_Channels", getActiveIndices<32>, {"barODsToT"})
-            //.Define("hodoOUs_Channels", getActiveIndices<32>, {"barOUsToT"})
-            .Define("barI_Channels", getActiveIndices<32>, {"barIDsToT"})
-            //.Define("hodoIUs_Channels", getActiveIndices<32>, {"barIUsToT"})
-            .Define("tileO_Channels", getActiveIndices<120>, {"tileOToT"})
-            .Define("tileI_Channels", getActiveIndices<120>, {"tileIToT"})
-            ;
-
-    auto nEntriesAfterCuts = filtered_df.Count();
     double eventsCut = static_cast<double>(*nEntriesAfterCuts);
-    double eventsCutGate = static_cast<double>(*filtered_df.Filter("mixGate == true").Count());
+    double eventsCutGate = static_cast<double>(*nEntriesAfterCutsGate);
+    log->info("{} events before cuts", eventsUncut);
     log->info("{} events after cuts", eventsCut);
 
-    ROOT::RDF::RSnapshotOptions opts;
-    opts.fMode = "update"; // was "update"
-    opts.fOverwriteIfExists = true;
-    filtered_df.Snapshot("EventTree", inputFile, "", opts);
-    
-    // Process filtered results
-    filtered_df.Foreach([&socket](uint32_t eventID, double tdcTimeTag, bool mixGate, const std::vector<int>& bgo_Channels) {
-        std::stringstream ss;
-        ss << eventID << " " << tdcTimeTag << " " << (int)mixGate;
+    if (!socket) return;
 
-        for (int ch : bgo_Channels) {
-            ss << " " << ch;
-        }
+    MonitorHistograms monitor;
+    for (const auto& slotMonitor : monitors) {
+        monitor.merge(slotMonitor);
+    }
 
-        zmq::message_t message(ss.str().c_str(), ss.str().size());
-        socket.send(message, zmq::send_flags::none);
+    GuiPublisher publisher(*socket);
+    publisher.sendSnapshot(monitor);
+    if (sendEnd) {
+        publisher.sendEnd(eventsCut, eventsCutGate);
+    }
 
-    }, {"eventID", "tdcTimeTag", "mixGate", "bgo_Channels"});
+    log->debug("Filtered data sent to GUI.");
+}
 
-    std::stringstream endss; 
-    endss << "END " << eventsCut << " " << eventsCutGate;
-    zmq::message_t message(endss.str().c_str(), endss.str().size() );
-    socket.send(message, zmq::send_flags::none);
+/**
+ * @brief Applies the cuts of buildFilterGraph to a single merged event.
+ *
+ * Used by the live analysis, which builds the events in memory and does not
+ * go through a ROOT file. Uses the same kernels as the RDataFrame graph.
+ *
+ * @param event The merged event.
+ * @param ticks The tick sizes of the stored times.
+ * @param out Filled with the columns of the monitoring histograms if the event passes.
+ * @return True if the event passes all cuts.
+ */
+bool DataFilter::filterEvent(const TDCEvent& event, const TickSizes& ticks, FilteredEvent& out) const {
+    const Int_t leCutTicks = static_cast<Int_t>(LE_CUT / ticks.tdc_ns);
+
+    // Non-owning views on the event arrays
+    auto view = [](const auto& arr) { return ROOT::RVec<Int_t>(const_cast<Int_t*>(arr.data()), arr.size()); };
+
+    auto hodoODsToT = computeToT<32>(view(event.hodoODsLE), view(event.hodoODsTE), ticks.tdc_ns);
+    auto hodoOUsToT = computeToT<32>(view(event.hodoOUsLE), view(event.hodoOUsTE), ticks.tdc_ns);
+    auto barODsToT = barCoincidenceToT(hodoODsToT, hodoOUsToT);
+    auto barOUsToT = barCoincidenceToT(hodoOUsToT, hodoODsToT);
+    if (!barCoincidence<32>(barODsToT, barOUsToT)) return false;
+
+    auto hodoIDsToT = computeToT<32>(view(event.hodoIDsLE), view(event.hodoIDsTE), ticks.tdc_ns);
+    auto hodoIUsToT = computeToT<32>(view(event.hodoIUsLE), view(event.hodoIUsTE), ticks.tdc_ns);
+    auto barIDsToT = barCoincidenceToT(hodoIDsToT, hodoIUsToT);
+    auto barIUsToT = barCoincidenceToT(hodoIUsToT, hodoIDsToT);
+    if (!barCoincidence<32>(barIDsToT, barIUsToT)) return false;
+
+    auto bgoLE_tCut = filterTicks(view(event.bgoLE), [leCutTicks](Int_t x) { return x < leCutTicks && x > 0; });
+    auto bgoToT = computeToT<64>(bgoLE_tCut, view(event.bgoTE), ticks.tdc_ns);
+    if (countNonZeroToT<64>(bgoToT) <= 1) return false;   // BGO Cut
+
+    out.eventID = event.eventID;
+    out.tdcTimeTag_ns = (event.tdcTimeTag == UINT64_UNSET) ? NAN : event.tdcTimeTag * ticks.ettt_ns;
+    out.mixGate = event.mixGate;
+    out.bgoToT = std::move(bgoToT);
+    out.barOToT = std::move(barODsToT);
+    out.barIToT = std::move(barIDsToT);
+    return true;
+}
 
-    log->debug(endss.str());
+void DataFilter::filterAndSave(const char* inputFile, int last_evt, SummaryPlots* summary) {
+    runFilter(inputFile, last_evt, true, nullptr, false, summary);
+}
 
-    log->debug("Filtered data sent to GUI.");
+void DataFilter::filterAndSend(const char* inputFile, int last_evt, zmq::socket_t& socket) {
+    runFilter(inputFile, last_evt, false, &socket, false);
+}
 
-}
\ No newline at end of file
+void DataFilter::filterAndSaveAndSend(const char* inputFile, int last_evt, zmq::socket_t& socket, SummaryPlots* summary) {
+    runFilter(inputFile, last_evt, true, &socket, true, summary);
+}
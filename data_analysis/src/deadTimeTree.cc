@@ -0,0 +1,89 @@
+#include "deadTimeTree.hh"
+#include "logger.hh"
+
+/**
+ * @brief Fills the dead time from the data of one LIVE bank event.
+ *
+ * @param data Run, veto and busy time in us (64 bit, high word first), busy
+ *             cycles, recorded events, triggers and gated triggers, and
+ *             the vetoes because of full queues (not in older files).
+ * @param timestamp_ns System time of the DAQ in ns.
+ * @return false if the event has too few words.
+ */
+bool DeadTimeEvent::decode(const std::vector<uint32_t>& data, uint64_t timestamp_ns) {
+    if (data.size() < LIVE_WORDS) return false;
+
+    auto us = [&data](size_t i) {
+        return static_cast<Double_t>((static_cast<uint64_t>(data[i]) << 32) | data[i + 1]) * 1e-6;
+    };
+
+    timestamp      = static_cast<Double_t>(timestamp_ns) * 1e-9;
+    runTime_s      = us(0);
+    vetoTime_s     = us(2);
+    busyTime_s     = us(4);
+    busyCycles     = data[6];
+    recordedEvents = data[7];
+    triggers       = data[8];
+    gated          = data[9];
+    liveFraction   = runTime_s > 0 ? 1. - vetoTime_s / runTime_s : 0.;
+    queueVetoes    = data.size() > LIVE_WORDS ? data[LIVE_WORDS] : 0;
+    return true;
+}
+
+/**
+ * @brief Creates the DeadTimeTree in the given directory.
+ *
+ * @param dir The output file of the DataDecoder.
+ */
+DeadTimeTree::DeadTimeTree(TDirectory* dir) {
+    if (!dir) return;
+    dir->cd();
+
+    // a tree that is already in the file is continued, when a decoding is resumed
+    tree = dir->Get<TTree>("DeadTimeTree");
+    bool attach = tree != nullptr;
+    if (!attach) tree = new TTree("DeadTimeTree", "Dead time of the DAQ");
+    auto branch = [this, attach](const char* branchName, auto* address) {
+        if (attach) tree->SetBranchAddress(branchName, address);
+        else tree->Branch(branchName, address);
+    };
+
+    branch("timestamp",       &entry.timestamp);
+    branch("cuspRunNumber",   &entry.cuspRunNumber);
+    branch("runTime_s",       &entry.runTime_s);
+    branch("vetoTime_s",      &entry.vetoTime_s);
+    branch("busyTime_s",      &entry.busyTime_s);
+    branch("busyCycles",      &entry.busyCycles);
+    branch("recordedEvents",  &entry.recordedEvents);
+    branch("triggers",        &entry.triggers);
+    branch("gated",           &entry.gated);
+    branch("liveFraction",    &entry.liveFraction);
+    branch("queueVetoes",     &entry.queueVetoes);
+    tree->SetAutoSave(0);
+}
+
+void DeadTimeTree::fill(const DeadTimeEvent& deadTime) {
+    if (!tree) return;
+    entry = deadTime;
+    tree->Fill();
+}
+
+void DeadTimeTree::write() {
+    if (!tree) return;
+    tree->GetDirectory()->cd();
+    tree->Write("", TObject::kOverwrite);
+}
+
+/**
+ * @brief Copies the DeadTimeTree from one file into another, if it exists.
+ */
+void DeadTimeTree::copy(TDirectory* from, TDirectory* to) {
+    if (!from || !to) return;
+    auto* source = from->Get<TTree>("DeadTimeTree");
+    if (!source) return;
+
+    to->cd();
+    TTree* copied = source->CloneTree(-1, "fast");
+    copied->Write("", TObject::kOverwrite);
+    Logger::getLogger()->debug("Copied DeadTimeTree with {} entries", copied->GetEntries());
+}
@@ -0,0 +1,109 @@
+#include "decoderCheckpoint.hh"
+#include "logger.hh"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+
+template <typename T, size_t N>
+std::string joinValues(const T (&values)[N]) {
+    std::ostringstream ss;
+    for (size_t i = 0; i < N; i++) ss << (i ? "," : "") << values[i];
+    return ss.str();
+}
+
+template <typename T, size_t N>
+bool splitValues(const std::string& text, T (&values)[N]) {
+    std::istringstream ss(text);
+    std::string item;
+    size_t i = 0;
+    while (std::getline(ss, item, ',') && i < N) {
+        values[i++] = static_cast<T>(std::stoll(item));
+    }
+    return i == N;
+}
+
+}
+
+/**
+ * @brief Writes the checkpoint as key=value lines.
+ *
+ * Written to a temporary file which is synced and renamed, so a crash leaves
+ * either the old or the new checkpoint.
+ *
+ * @return false if the file could not be written.
+ */
+bool DecoderCheckpoint::save(const std::string& fileName) const {
+    std::string tmpName = fileName + ".tmp";
+    std::ofstream out(tmpName, std::ios::trunc);
+    if (!out) {
+        Logger::getLogger()->error("Could not write {}", tmpName);
+        return false;
+    }
+
+    out << std::setprecision(17)
+        << "offset=" << offset << "\n"
+        << "reader_flag64=" << readerFlag64 << "\n"
+        << "last_event=" << lastEvent << "\n"
+        << "raw_entries=" << rawEntries << "\n"
+        << "scaler_entries=" << scalerEntries << "\n"
+        << "dead_time_entries=" << deadTimeEntries << "\n"
+        << "filter_entries=" << filterEntries << "\n"
+        << "last_evt=" << joinValues(last_evt) << "\n"
+        << "reset_ctr=" << joinValues(reset_ctr) << "\n"
+        << "last_timetag=" << joinValues(last_timetag) << "\n"
+        << "reset_ctr_time=" << joinValues(reset_ctr_time) << "\n"
+        << "cusp_value=" << cuspValue << "\n"
+        << "sec_time=" << secTime << "\n"
+        << "nsec_time=" << nsecTime << "\n"
+        << "gate_value=" << gateValue << "\n";
+    out.close();
+    if (!out) return false;
+
+    if (FILE* file = fopen(tmpName.c_str(), "r")) {
+        fsync(fileno(file));
+        fclose(file);
+    }
+    return std::rename(tmpName.c_str(), fileName.c_str()) == 0;
+}
+
+/**
+ * @brief Reads a checkpoint written by save().
+ *
+ * @return false if there is no checkpoint or it is incomplete.
+ */
+bool DecoderCheckpoint::load(const std::string& fileName) {
+    std::ifstream in(fileName);
+    if (!in) return false;
+
+    std::map<std::string, std::string> values;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t eq = line.find('=');
+        if (eq != std::string::npos) values[line.substr(0, eq)] = line.substr(eq + 1);
+    }
+
+    try {
+        offset          = std::stol(values.at("offset"));
+        readerFlag64    = values.at("reader_flag64") == "1";
+        lastEvent       = std::stoul(values.at("last_event"));
+        rawEntries      = std::stoll(values.at("raw_entries"));
+        scalerEntries   = std::stoll(values.at("scaler_entries"));
+        deadTimeEntries = std::stoll(values.at("dead_time_entries"));
+        filterEntries   = std::stoll(values.at("filter_entries"));
+        cuspValue       = std::stoi(values.at("cusp_value"));
+        secTime         = std::stod(values.at("sec_time"));
+        nsecTime        = std::stod(values.at("nsec_time"));
+        gateValue       = values.at("gate_value") == "1";
+        return splitValues(values.at("last_evt"), last_evt) && splitValues(values.at("reset_ctr"), reset_ctr)
+            && splitValues(values.at("last_timetag"), last_timetag) && splitValues(values.at("reset_ctr_time"), reset_ctr_time);
+    } catch (const std::exception& e) {
+        Logger::getLogger()->warn("Invalid checkpoint {}: {}", fileName, e.what());
+        return false;
+    }
+}
@@ -0,0 +1,257 @@
+#include "eventExport.hh"
+#include "logger.hh"
+
+#include <filesystem>
+
+ExportFormat parseExportFormat(const std::string& name) {
+    if (name == "arrow") return ExportFormat::Arrow;
+    if (name == "parquet") return ExportFormat::Parquet;
+    if (name != "none" && !name.empty()) {
+        Logger::getLogger()->warn("Unknown export format '{}', no export", name);
+    }
+    return ExportFormat::None;
+}
+
+const char* exportFormatName(ExportFormat format) {
+    switch (format) {
+        case ExportFormat::Arrow:   return "arrow";
+        case ExportFormat::Parquet: return "parquet";
+        default:                    return "none";
+    }
+}
+
+/**
+ * @brief The export file next to a ROOT file, output_000533.root becomes
+ *        output_000533.arrow or output_000533.parquet.
+ */
+std::string exportFileName(const std::string& rootFile, ExportFormat format) {
+    return std::filesystem::path(rootFile).replace_extension(exportFormatName(format)).string();
+}
+
+/**
+ * @brief True if hodo_analysis was built with HODO_WITH_ARROW.
+ */
+bool exportAvailable() {
+#ifdef HODO_WITH_ARROW
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef HODO_WITH_ARROW
+
+#include <atomic>
+#include <mutex>
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/writer.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/properties.h>
+
+namespace {
+
+/**
+ * @brief The exported columns of the filter graph. book() lists their types
+ *        in the same order.
+ */
+std::shared_ptr<arrow::Schema> makeSchema() {
+    auto toT = arrow::list(arrow::float64());       // ns, NaN for channels without hit
+    auto channels = arrow::list(arrow::int32());
+    return arrow::schema({
+        arrow::field("eventID", arrow::uint32()),
+        arrow::field("mixGate", arrow::boolean()),
+        arrow::field("tdcTimeTag_ns", arrow::float64()),
+        arrow::field("fpgaTimeTag_ns", arrow::float64()),
+        arrow::field("bgoCts", arrow::int32()),
+        arrow::field("bgoToTSum", arrow::int32()),
+        arrow::field("barODsCts", arrow::int32()),
+        arrow::field("barOUsCts", arrow::int32()),
+        arrow::field("barIDsCts", arrow::int32()),
+        arrow::field("barIUsCts", arrow::int32()),
+        arrow::field("bgoToT", toT),
+        arrow::field("barODsToT", toT),
+        arrow::field("barOUsToT", toT),
+        arrow::field("barIDsToT", toT),
+        arrow::field("barIUsToT", toT),
+        arrow::field("tileOToT", toT),
+        arrow::field("tileIToT", toT),
+        arrow::field("bgo_Channels", channels),
+        arrow::field("barO_Channels", channels),
+        arrow::field("barI_Channels", channels),
+        arrow::field("tileO_Channels", channels),
+        arrow::field("tileI_Channels", channels)
+    });
+}
+
+// One append per column type, the builder matches the field of makeSchema
+arrow::Status appendColumn(arrow::ArrayBuilder* builder, UInt_t value) {
+    return static_cast<arrow::UInt32Builder*>(builder)->Append(value);
+}
+
+arrow::Status appendColumn(arrow::ArrayBuilder* builder, Bool_t value) {
+    return static_cast<arrow::BooleanBuilder*>(builder)->Append(value);
+}
+
+arrow::Status appendColumn(arrow::ArrayBuilder* builder, Double_t value) {
+    return static_cast<arrow::DoubleBuilder*>(builder)->Append(value);
+}
+
+arrow::Status appendColumn(arrow::ArrayBuilder* builder, int value) {
+    return static_cast<arrow::Int32Builder*>(builder)->Append(value);
+}
+
+arrow::Status appendColumn(arrow::ArrayBuilder* builder, const ROOT::RVec<Double_t>& values) {
+    auto list = static_cast<arrow::ListBuilder*>(builder);
+    ARROW_RETURN_NOT_OK(list->Append());
+    return static_cast<arrow::DoubleBuilder*>(list->value_builder())->AppendValues(values.data(), values.size());
+}
+
+arrow::Status appendColumn(arrow::ArrayBuilder* builder, const std::vector<int>& values) {
+    auto list = static_cast<arrow::ListBuilder*>(builder);
+    ARROW_RETURN_NOT_OK(list->Append());
+    return static_cast<arrow::Int32Builder*>(list->value_builder())->AppendValues(values.data(), values.size());
+}
+
+}
+
+// The open export file, shared by all slots
+struct ArrowEventWriter::Output {
+    std::mutex mutex;
+    std::shared_ptr<arrow::io::FileOutputStream> sink;
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> ipc;
+    std::unique_ptr<parquet::arrow::FileWriter> parquet;
+    std::atomic<bool> failed{false};
+
+    arrow::Status open(const std::string& fileName, ExportFormat format, const std::shared_ptr<arrow::Schema>& schema) {
+        ARROW_ASSIGN_OR_RAISE(sink, arrow::io::FileOutputStream::Open(fileName));
+        if (format == ExportFormat::Parquet) {
+            auto props = parquet::WriterProperties::Builder().compression(parquet::Compression::ZSTD)->build();
+            ARROW_ASSIGN_OR_RAISE(parquet, parquet::arrow::FileWriter::Open(*schema, arrow::default_memory_pool(), sink, props));
+        } else {
+            ARROW_ASSIGN_OR_RAISE(ipc, arrow::ipc::MakeFileWriter(sink, schema));
+        }
+        return arrow::Status::OK();
+    }
+
+    arrow::Status write(const arrow::RecordBatch& batch) {
+        return parquet ? parquet->WriteRecordBatch(batch) : ipc->WriteRecordBatch(batch);
+    }
+
+    arrow::Status close() {
+        if (parquet) ARROW_RETURN_NOT_OK(parquet->Close());
+        if (ipc) ARROW_RETURN_NOT_OK(ipc->Close());
+        return sink ? sink->Close() : arrow::Status::OK();
+    }
+};
+
+ArrowEventWriter::ArrowEventWriter(const std::string& fileName, ExportFormat format, unsigned int nSlots)
+    : fileName(fileName), format(format), schema(makeSchema()),
+      output(std::make_unique<Output>()), result(std::make_shared<Result_t>(0)) {
+
+    for (unsigned int slot = 0; slot < nSlots; slot++) {
+        auto builder = arrow::RecordBatchBuilder::Make(schema, arrow::default_memory_pool(), BATCH_ROWS);
+        if (!builder.ok()) {
+            Logger::getLogger()->error("Could not create Arrow builders: {}", builder.status().ToString());
+            output->failed = true;
+            return;
+        }
+        builders.push_back(std::move(builder).ValueOrDie());
+    }
+}
+
+ArrowEventWriter::ArrowEventWriter(ArrowEventWriter&&) = default;
+ArrowEventWriter::~ArrowEventWriter() = default;
+
+template <typename... Cols>
+void ArrowEventWriter::Exec(unsigned int slot, const Cols&... cols) {
+    if (output->failed) return;
+
+    auto& builder = *builders[slot];
+    int field = 0;
+    arrow::Status status;
+    auto append = [&](const auto& value) {
+        if (status.ok()) status = appendColumn(builder.GetField(field++), value);
+    };
+    (append(cols), ...);
+    if (!status.ok()) {
+        Logger::getLogger()->error("Could not export event: {}", status.ToString());
+        output->failed = true;
+        return;
+    }
+
+    if (builder.num_rows() >= BATCH_ROWS) flushSlot(slot);
+}
+
+/**
+ * @brief Books the export on the filtered node, it is written by the next
+ *        event loop of the graph.
+ *
+ * @param df The filtered node of DataFilter::buildFilterGraph.
+ * @param fileName The Arrow IPC or Parquet file, overwritten.
+ * @param format ExportFormat::Arrow or ExportFormat::Parquet.
+ * @return the number of exported events.
+ */
+ROOT::RDF::RResultPtr<ULong64_t> ArrowEventWriter::book(ROOT::RDF::RNode df, const std::string& fileName, ExportFormat format) {
+    using ToT = ROOT::RVec<Double_t>;
+    using Channels = std::vector<int>;
+
+    ArrowEventWriter writer(fileName, format, df.GetNSlots());
+    auto columns = writer.schema->field_names();
+    return df.Book<UInt_t, Bool_t, Double_t, Double_t,
+                   int, int, int, int, int, int,
+                   ToT, ToT, ToT, ToT, ToT, ToT, ToT,
+                   Channels, Channels, Channels, Channels, Channels>(std::move(writer), columns);
+}
+
+void ArrowEventWriter::Initialize() {
+    if (output->failed) return;
+
+    arrow::Status status = output->open(fileName, format, schema);
+    if (!status.ok()) {
+        Logger::getLogger()->error("Could not open {}: {}", fileName, status.ToString());
+        output->failed = true;
+    }
+}
+
+/**
+ * @brief Writes the events collected by a slot as one record batch.
+ */
+void ArrowEventWriter::flushSlot(unsigned int slot) {
+    auto batch = builders[slot]->Flush();
+    if (!batch.ok()) {
+        Logger::getLogger()->error("Could not export events: {}", batch.status().ToString());
+        output->failed = true;
+        return;
+    }
+    if ((*batch)->num_rows() == 0) return;
+
+    std::lock_guard<std::mutex> lock(output->mutex);
+    if (output->failed) return;
+    arrow::Status status = output->write(**batch);
+    if (!status.ok()) {
+        Logger::getLogger()->error("Could not write {}: {}", fileName, status.ToString());
+        output->failed = true;
+        return;
+    }
+    *result += (*batch)->num_rows();
+}
+
+void ArrowEventWriter::Finalize() {
+    auto log = Logger::getLogger();
+
+    if (!output->failed) {
+        for (unsigned int slot = 0; slot < builders.size(); slot++) flushSlot(slot);
+    }
+
+    arrow::Status status = output->close();
+    if (output->failed || !status.ok()) {
+        log->error("Export to {} failed {}", fileName, status.ok() ? "" : status.ToString());
+        std::error_code ec;
+        std::filesystem::remove(fileName, ec);  // no half written file for the Python tools
+        return;
+    }
+    log->info("Exported {} events to {}", *result, fileName);
+}
+
+#endif  // HODO_WITH_ARROW
@@ -0,0 +1,90 @@
+#include "eventNTuple.hh"
+#include "logger.hh"
+
+#include <TKey.h>
+
+OutputBackend parseOutputBackend(const std::string& name) {
+    if (name == "rntuple") return OutputBackend::RNTuple;
+    if (name != "ttree" && !name.empty()) {
+        Logger::getLogger()->warn("Unknown output backend '{}', using ttree", name);
+    }
+    return OutputBackend::TTree;
+}
+
+const char* outputBackendName(OutputBackend backend) {
+    return (backend == OutputBackend::RNTuple) ? "rntuple" : "ttree";
+}
+
+std::unique_ptr<RNT::RNTupleModel> makeEventModel() {
+    auto model = RNT::RNTupleModel::Create();
+
+    model->MakeField<UInt_t>("eventID");
+    model->MakeField<Double_t>("timestamp");
+    model->MakeField<UInt_t>("cuspRunNumber");
+    model->MakeField<Bool_t>("mixGate");
+    model->MakeField<Bool_t>("dumpGate");
+    model->MakeField<ULong64_t>("tdcTimeTag");
+    model->MakeField<ULong64_t>("fpgaTimeTag");
+    model->MakeField<std::array<Int_t, 4>>("trgLE");
+    model->MakeField<std::array<Int_t, 4>>("trgTE");
+
+    model->MakeField<std::array<Int_t, 32>>("hodoIDsLE");
+    model->MakeField<std::array<Int_t, 32>>("hodoIUsLE");
+    model->MakeField<std::array<Int_t, 32>>("hodoODsLE");
+    model->MakeField<std::array<Int_t, 32>>("hodoOUsLE");
+    model->MakeField<std::array<Int_t, 32>>("hodoIDsTE");
+    model->MakeField<std::array<Int_t, 32>>("hodoIUsTE");
+    model->MakeField<std::array<Int_t, 32>>("hodoODsTE");
+    model->MakeField<std::array<Int_t, 32>>("hodoOUsTE");
+
+    model->MakeField<std::array<Int_t, 64>>("bgoLE");
+    model->MakeField<std::array<Int_t, 64>>("bgoTE");
+
+    model->MakeField<std::array<Int_t, 120>>("tileILE");
+    model->MakeField<std::array<Int_t, 120>>("tileITE");
+    model->MakeField<std::array<Int_t, 120>>("tileOLE");
+    model->MakeField<std::array<Int_t, 120>>("tileOTE");
+
+    model->MakeField<UInt_t>("tdcID");
+
+    return model;
+}
+
+// Points all fields of an entry to the members of event, Fill and LoadEntry then work on event directly
+void bindEvent(RNT::REntry& entry, TDCEvent& event) {
+    entry.BindRawPtr("eventID",        &event.eventID);
+    entry.BindRawPtr("timestamp",      &event.timestamp);
+    entry.BindRawPtr("cuspRunNumber",  &event.cuspRunNumber);
+    entry.BindRawPtr("mixGate",        &event.mixGate);
+    entry.BindRawPtr("dumpGate",       &event.dumpGate);
+    entry.BindRawPtr("tdcTimeTag",     &event.tdcTimeTag);
+    entry.BindRawPtr("fpgaTimeTag",    &event.fpgaTimeTag);
+    entry.BindRawPtr("trgLE",          &event.trgLE);
+    entry.BindRawPtr("trgTE",          &event.trgTE);
+
+    entry.BindRawPtr("hodoIDsLE",      &event.hodoIDsLE);
+    entry.BindRawPtr("hodoIUsLE",      &event.hodoIUsLE);
+    entry.BindRawPtr("hodoODsLE",      &event.hodoODsLE);
+    entry.BindRawPtr("hodoOUsLE",      &event.hodoOUsLE);
+    entry.BindRawPtr("hodoIDsTE",      &event.hodoIDsTE);
+    entry.BindRawPtr("hodoIUsTE",      &event.hodoIUsTE);
+    entry.BindRawPtr("hodoODsTE",      &event.hodoODsTE);
+    entry.BindRawPtr("hodoOUsTE",      &event.hodoOUsTE);
+
+    entry.BindRawPtr("bgoLE",          &event.bgoLE);
+    entry.BindRawPtr("bgoTE",          &event.bgoTE);
+
+    entry.BindRawPtr("tileILE",        &event.tileILE);
+    entry.BindRawPtr("tileITE",        &event.tileITE);
+    entry.BindRawPtr("tileOLE",        &event.tileOLE);
+    entry.BindRawPtr("tileOTE",        &event.tileOTE);
+
+    entry.BindRawPtr("tdcID",          &event.tdcID);
+}
+
+// True if the object called name in dir is an RNTuple and not a TTree
+bool isNTuple(TDirectory* dir, const char* name) {
+    if (!dir) return false;
+    TKey* key = dir->GetKey(name);
+    return key && std::string(key->GetClassName()).find("RNTuple") != std::string::npos;
+}
@@ -2,10 +2,14 @@
 #include "logger.hh"
 #include <cstring>
 #include <sys/stat.h>  // For file size checking
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <thread>
 
 
 // Constructor: Opens binary file
-FileReader::FileReader(const std::string& filename) {
+FileReader::FileReader(const std::string& filename) : filename(filename) {
     auto log = Logger::getLogger();
     file.open(filename, std::ios::binary);
     if (!file) {
@@ -13,6 +17,53 @@ FileReader::FileReader(const std::string& filename) {
     }
 }
 
+FileReader::~FileReader() {
+    if (inotifyFd >= 0) close(inotifyFd);
+}
+
+/**
+ * @brief Watches the file with inotify, so waitForData returns as soon as
+ *        the DAQ writes to it.
+ *
+ * @return false if inotify is not available, waitForData then only sleeps.
+ */
+bool FileReader::watch() {
+    auto log = Logger::getLogger();
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        log->warn("inotify not available, polling {}", filename);
+        return false;
+    }
+    if (inotify_add_watch(inotifyFd, filename.c_str(), IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+        log->warn("Could not watch {}, polling instead", filename);
+        close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Waits until the watched file was modified.
+ *
+ * @param timeout_ms Maximum waiting time.
+ * @return true if the file was modified, false on timeout (always false without inotify).
+ */
+bool FileReader::waitForData(int timeout_ms) {
+    if (inotifyFd < 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+        return false;
+    }
+
+    pollfd pfd = { inotifyFd, POLLIN, 0 };
+    if (poll(&pfd, 1, timeout_ms) <= 0) return false;
+
+    // Drain all queued events, one wake-up per batch of writes is enough
+    char buffer[4096];
+    while (read(inotifyFd, buffer, sizeof(buffer)) > 0) {}
+    return true;
+}
+
 // Check if file is open
 bool FileReader::isOpen() const {
     return file.is_open();
@@ -28,12 +79,12 @@ long FileReader::getFileSize() {
 }
 
 // Read a single DataBank
-bool FileReader::readDataBank(DataBank& bank) {
+bool FileReader::readDataBank(std::istream& in, DataBank& bank) {
     auto log = Logger::getLogger();
     uint32_t packedBankName;
     // Read Bank Name (4 bytes)
-    // if (!file.read(bank.bankName, 4)) return false;
-    if (!file.read(reinterpret_cast<char*>(&packedBankName), sizeof(packedBankName))) return false;
+    // if (!in.read(bank.bankName, 4)) return false;
+    if (!in.read(reinterpret_cast<char*>(&packedBankName), sizeof(packedBankName))) return false;
 
     // Unpack the bank name from the 32-bit value
     bank.bankName[0] =  packedBankName & 0xFF;           // First byte (least significant byte)
@@ -45,7 +96,7 @@ bool FileReader::readDataBank(DataBank& bank) {
 
     // Read Number of Events (4 bytes)
     uint32_t eventCount;
-    if (!file.read(reinterpret_cast<char*>(&eventCount), sizeof(eventCount))) return false;
+    if (!in.read(reinterpret_cast<char*>(&eventCount), sizeof(eventCount))) return false;
 
     // Read Events
     bank.events.clear();
@@ -55,12 +106,12 @@ bool FileReader::readDataBank(DataBank& bank) {
         if (bankNameStr == "CUSP") {
             
             uint32_t tsHigh;
-            if (!file.read(reinterpret_cast<char*>(&tsHigh), sizeof(tsHigh))) return false;
+            if (!in.read(reinterpret_cast<char*>(&tsHigh), sizeof(tsHigh))) return false;
 
             if (tsHigh & 0x80000000) {  
                 // --- New format, 64-bit ---
                 uint32_t tsLow;
-                if (!file.read(reinterpret_cast<char*>(&tsLow), sizeof(tsLow))) return false;
+                if (!in.read(reinterpret_cast<char*>(&tsLow), sizeof(tsLow))) return false;
                 
                 uint64_t ts64 = (uint64_t(tsHigh & 0x7FFFFFFF) << 32) | tsLow;
                 event.timestamp64 = ts64;
@@ -73,11 +124,20 @@ bool FileReader::readDataBank(DataBank& bank) {
                 // flag64 = false;
             }
         }
+        else if (bankNameStr == "SCLR" || bankNameStr == "LIVE" || bankNameStr == "FILT") {
+            // --- Scalers, dead time and online filter, always 64-bit ns timestamp ---
+            uint32_t tsHigh, tsLow;
+            if (!in.read(reinterpret_cast<char*>(&tsHigh), sizeof(tsHigh))) return false;
+            if (!in.read(reinterpret_cast<char*>(&tsLow), sizeof(tsLow))) return false;
+
+            event.timestamp64 = (uint64_t(tsHigh) << 32) | tsLow;
+            event.timestamp = 0;
+        }
         else if (bankNameStr == "GATE" && flag64) {
             // --- GATE in 64-bit mode ---
             uint32_t tsHigh, tsLow;
-            if (!file.read(reinterpret_cast<char*>(&tsHigh), sizeof(tsHigh))) return false;
-            if (!file.read(reinterpret_cast<char*>(&tsLow), sizeof(tsLow))) return false;
+            if (!in.read(reinterpret_cast<char*>(&tsHigh), sizeof(tsHigh))) return false;
+            if (!in.read(reinterpret_cast<char*>(&tsLow), sizeof(tsLow))) return false;
 
             uint64_t ts64 = (uint64_t(tsHigh) << 32) | tsLow;
             // log->debug("fpgaTimeTag: {}", ts64);
@@ -86,24 +146,24 @@ bool FileReader::readDataBank(DataBank& bank) {
         }  
         else {
             // --- All other banks: 32-bit timestamp ---
-            if (!file.read(reinterpret_cast<char*>(&event.timestamp), sizeof(event.timestamp))) return false;
+            if (!in.read(reinterpret_cast<char*>(&event.timestamp), sizeof(event.timestamp))) return false;
             event.timestamp64 = 0;  
         }
 
         // // Read Timestamp (4 bytes)
-        // if (!file.read(reinterpret_cast<char*>(&event.timestamp), sizeof(event.timestamp))) return false;
+        // if (!in.read(reinterpret_cast<char*>(&event.timestamp), sizeof(event.timestamp))) return false;
 
         // Read Number of Data Points (4 bytes)
         uint32_t dataSize;
-        if (!file.read(reinterpret_cast<char*>(&dataSize), sizeof(dataSize))) return false;
+        if (!in.read(reinterpret_cast<char*>(&dataSize), sizeof(dataSize))) return false;
 
         if (dataSize > 10000) { 
-            log->error("Unrealistic dataSize {} in bank {} at offset 0x{:x}", dataSize, bankNameStr, static_cast<long long>(file.tellg()));
+            log->error("Unrealistic dataSize {} in bank {} at offset 0x{:x}", dataSize, bankNameStr, static_cast<long long>(in.tellg()));
 
             std::string resyncedBank;
-            if (resyncToNextBank(file, resyncedBank)) {
+            if (resyncToNextBank(in, resyncedBank)) {
                 log->warn("Resynced to bank {} at offset 0x{:x}", 
-                        resyncedBank, static_cast<long long>(file.tellg()));
+                        resyncedBank, static_cast<long long>(in.tellg()));
                 // You’d now return control so the next `readDataBank()` starts at the new bank
                 return true;
             } else {
@@ -114,17 +174,17 @@ bool FileReader::readDataBank(DataBank& bank) {
 
         // Read Data Points (4 * dataSize bytes)
         event.data.resize(dataSize);
-        if (!file.read(reinterpret_cast<char*>(event.data.data()), dataSize * sizeof(uint32_t))) return false;
+        if (!in.read(reinterpret_cast<char*>(event.data.data()), dataSize * sizeof(uint32_t))) return false;
 
         bank.events.push_back(std::move(event));
     }
     return true;
 }
 
-bool FileReader::resyncToNextBank(std::ifstream& file, std::string& bankNameOut) {
+bool FileReader::resyncToNextBank(std::istream& in, std::string& bankNameOut) {
     auto log = Logger::getLogger();
     uint32_t candidate;
-    while (file.read(reinterpret_cast<char*>(&candidate), sizeof(candidate))) {
+    while (in.read(reinterpret_cast<char*>(&candidate), sizeof(candidate))) {
         char name[5];
         name[0] =  candidate        & 0xFF;
         name[1] = (candidate >> 8)  & 0xFF;
@@ -134,11 +194,11 @@ bool FileReader::resyncToNextBank(std::ifstream& file, std::string& bankNameOut)
 
         std::string bankName(name);
 
-        if (bankName == "CUSP" || bankName == "GATE" || bankName.rfind("TDC", 0) == 0) {
+        if (bankName == "CUSP" || bankName == "GATE" || bankName == "SCLR" || bankName == "LIVE" || bankName == "FILT" || bankName.rfind("TDC", 0) == 0) {
             bankNameOut = bankName;
-            log->debug("Found next bank: {} at offset =x{:x}", bankName, static_cast<long long>(file.tellg()));
+            log->debug("Found next bank: {} at offset =x{:x}", bankName, static_cast<long long>(in.tellg()));
             // move back 4 bytes so the caller reads the bank name itself
-            file.seekg(-4, std::ios::cur);
+            in.seekg(-4, std::ios::cur);
             return true;  // found valid bank
         }
     }
@@ -158,22 +218,56 @@ bool FileReader::readNextBlock(Block& block, long startPos) {
     file.clear(); // reset state in case of previous EOF
     file.seekg(startPos, std::ios::beg);
     
+    if (!readBlock(file, block)) return false;
+
+    currentPos = static_cast<long>(file.tellg());
+
+    return true;
+}
+
+// Read a block from any stream, the stream is positioned at the block ID
+bool FileReader::readBlock(std::istream& in, Block& block) {
     // Read Block ID (4 bytes)
-    if (!file.read(reinterpret_cast<char*>(&block.blockID), sizeof(block.blockID))) return false;
+    if (!in.read(reinterpret_cast<char*>(&block.blockID), sizeof(block.blockID))) return false;
 
     // Read Number of Banks (4 bytes)
     uint32_t bankCount;
-    if (!file.read(reinterpret_cast<char*>(&bankCount), sizeof(bankCount))) return false;
+    if (!in.read(reinterpret_cast<char*>(&bankCount), sizeof(bankCount))) return false;
 
     // Read Banks
     block.banks.clear();
     for (uint32_t i = 0; i < bankCount; i++) {
         DataBank bank;
-        if (!readDataBank(bank)) return false;
+        if (!readDataBank(in, bank)) return false;
         block.banks.push_back(bank);
     }
 
-    currentPos = static_cast<long>(file.tellg());
-
     return true;
-}
\ No newline at end of file
+}
+
+// Read-only stream buffer over memory, seekable so the bank resync works
+struct MemoryBuffer : std::streambuf {
+    MemoryBuffer(const char* data, size_t size) {
+        char* p = const_cast<char*>(data);
+        setg(p, p, p + size);
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+        char* base = (dir == std::ios_base::beg) ? eback() : (dir == std::ios_base::cur) ? gptr() : egptr();
+        char* target = base + off;
+        if (target < eback() || target > egptr()) return pos_type(off_type(-1));
+        setg(eback(), target, egptr());
+        return pos_type(target - eback());
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+// Parse a block that was serialized by hodo_daq, e.g. taken from the shared-memory ring
+bool FileReader::readBlock(const std::vector<uint32_t>& data, Block& block) {
+    MemoryBuffer buffer(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(uint32_t));
+    std::istream in(&buffer);
+    return readBlock(in, block);
+}
@@ -0,0 +1,45 @@
+#include "guiPublisher.hh"
+#include "monitorHistograms.hh"
+#include "logger.hh"
+
+#include <cstring>
+
+/**
+ * @brief Sends the monitoring histograms as a SNAPSHOT and a TIMELINE frame.
+ *
+ * Both hold the full histograms, so a GUI that connects later or misses a
+ * frame is up to date with the next one.
+ */
+void GuiPublisher::sendSnapshot(const MonitorHistograms& monitor) {
+    sendFrame(HODO_GUI_SNAPSHOT, &monitor.snapshot(), 1, sizeof(hodo_gui_snapshot));
+    const auto& timeline = monitor.timeline();
+    sendFrame(HODO_GUI_TIMELINE, timeline.data(), timeline.size(), sizeof(hodo_gui_bin));
+}
+
+/**
+ * @brief Sends the END frame with the event counts, the GUI then updates the run summary.
+ */
+void GuiPublisher::sendEnd(double eventsCut, double eventsCutGate) {
+    hodo_gui_end end;
+    end.eventsCut = static_cast<uint64_t>(eventsCut);
+    end.eventsCutGate = static_cast<uint64_t>(eventsCutGate);
+    sendFrame(HODO_GUI_END, &end, 1, sizeof(hodo_gui_end));
+
+    Logger::getLogger()->debug("END {} {}, {} frames sent", eventsCut, eventsCutGate, frames);
+}
+
+void GuiPublisher::sendFrame(uint16_t type, const void* data, uint32_t count, uint32_t recordSize) {
+    hodo_gui_header header;
+    header.magic = HODO_GUI_MAGIC;
+    header.version = HODO_GUI_VERSION;
+    header.type = type;
+    header.count = count;
+    header.recordSize = recordSize;
+
+    zmq::message_t message(sizeof(header) + (size_t)count * recordSize);
+    char* out = static_cast<char*>(message.data());
+    std::memcpy(out, &header, sizeof(header));
+    std::memcpy(out + sizeof(header), data, (size_t)count * recordSize);
+    socket.send(message, zmq::send_flags::none);
+    frames++;
+}
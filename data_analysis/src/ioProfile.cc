@@ -0,0 +1,130 @@
+#include "ioProfile.hh"
+#include "logger.hh"
+
+#include <sstream>
+#include <TFile.h>
+
+namespace {
+
+using EAlgorithm = ROOT::RCompressionSetting::EAlgorithm;
+
+const std::map<std::string, EAlgorithm::EValues> compressionAlgorithms = {
+    { "zlib", EAlgorithm::kZLIB },
+    { "lzma", EAlgorithm::kLZMA },
+    { "lz4",  EAlgorithm::kLZ4  },
+    { "zstd", EAlgorithm::kZSTD }
+};
+
+}
+
+/**
+ * @brief Reads the io_* keys from the config, missing keys keep their defaults.
+ */
+IOProfile IOProfile::fromConfig(const std::map<std::string, std::string>& config) {
+    auto log = Logger::getLogger();
+    IOProfile io;
+
+    try {
+        if (config.count("io_cluster_size"))      io.clusterSize = std::stoll(config.at("io_cluster_size"));
+        if (config.count("io_basket_size"))       io.basketSize = std::stoi(config.at("io_basket_size"));
+        if (config.count("io_compression_level")) io.compressionLevel = std::stoi(config.at("io_compression_level"));
+        if (config.count("io_flush_every"))       io.flushEvery = std::stoi(config.at("io_flush_every"));
+    } catch (const std::exception& e) {
+        log->error("Invalid io_* setting in config: {}", e.what());
+    }
+
+    if (config.count("io_compression")) {
+        auto it = compressionAlgorithms.find(config.at("io_compression"));
+        if (it != compressionAlgorithms.end()) {
+            io.compressionAlgorithm = it->second;
+        } else {
+            log->warn("Unknown io_compression '{}', using {}", config.at("io_compression"), io.compressionName());
+        }
+    }
+
+    return io;
+}
+
+Int_t IOProfile::compressionSettings() const {
+    return ROOT::CompressionSettings(compressionAlgorithm, compressionLevel);
+}
+
+std::string IOProfile::compressionName() const {
+    for (const auto& [name, algorithm] : compressionAlgorithms) {
+        if (algorithm == compressionAlgorithm) return name;
+    }
+    return "unknown";
+}
+
+std::string IOProfile::describe() const {
+    std::ostringstream ss;
+    ss << "cluster=" << clusterSize
+       << " basket=" << basketSize
+       << " compression=" << compressionName() << "-" << compressionLevel
+       << " flush_every=" << flushEvery;
+    return ss.str();
+}
+
+void IOProfile::apply(TFile* file) const {
+    if (file) file->SetCompressionSettings(compressionSettings());
+}
+
+// Call after all branches are created, SetBasketSize only changes existing branches
+void IOProfile::apply(TTree* tree) const {
+    if (!tree) return;
+    tree->SetAutoFlush(clusterSize);
+    tree->SetBasketSize("*", basketSize);
+}
+
+// RNTuple has no entry based clusters, only a negative (byte) cluster size is used
+RNT::RNTupleWriteOptions IOProfile::ntupleOptions() const {
+    RNT::RNTupleWriteOptions options;
+    options.SetCompression(compressionSettings());
+    if (clusterSize < 0) {
+        options.SetApproxZippedClusterSize(static_cast<std::size_t>(-clusterSize));
+    }
+    return options;
+}
+
+std::vector<std::pair<std::string, IOProfile>> benchmarkProfiles(const IOProfile& configured) {
+    IOProfile legacy;                   // settings before the profile was configurable
+    legacy.clusterSize = 10;
+    legacy.compressionAlgorithm = EAlgorithm::kZLIB;
+    legacy.compressionLevel = 1;
+    legacy.flushEvery = 1;
+
+    IOProfile zlib;
+    zlib.compressionAlgorithm = EAlgorithm::kZLIB;
+    zlib.compressionLevel = 1;
+
+    IOProfile lz4;
+    lz4.compressionAlgorithm = EAlgorithm::kLZ4;
+    lz4.compressionLevel = 4;
+
+    IOProfile zstd;
+
+    IOProfile lzma;
+    lzma.compressionAlgorithm = EAlgorithm::kLZMA;
+    lzma.compressionLevel = 7;
+
+    IOProfile smallBasket;
+    smallBasket.basketSize = 8000;
+
+    IOProfile largeBasket;
+    largeBasket.basketSize = 256000;
+
+    IOProfile smallCluster;
+    smallCluster.clusterSize = 1000;
+
+    return {
+        { "config",        configured   },
+        { "legacy",        legacy       },
+        { "zlib-1",        zlib         },
+        { "lz4-4",         lz4          },
+        { "zstd-5",        zstd         },
+        { "lzma-7",        lzma         },
+        { "basket-8k",     smallBasket  },
+        { "basket-256k",   largeBasket  },
+        { "cluster-1000",  smallCluster }
+    };
+}
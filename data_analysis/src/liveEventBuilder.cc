@@ -0,0 +1,60 @@
+#include "liveEventBuilder.hh"
+#include "dataFilter.hh"
+#include "logger.hh"
+
+LiveEventBuilder::LiveEventBuilder(size_t maxPending) : maxPending(maxPending) {
+    lastID.fill(-1);
+}
+
+/**
+ * @brief Merges a fragment into the pending event with the same eventID.
+ *
+ * @param fragment One entry of the raw data, tdcID 0-3 for the TDCs, 4 for the GATE.
+ */
+void LiveEventBuilder::addFragment(const TDCEvent& fragment) {
+    if (fragment.eventID == UINT32_UNSET || fragment.tdcID >= N_SOURCES) return;
+
+    PendingEvent& pending = events[fragment.eventID];
+    DataFilter::mergeFragment(pending.event, fragment, fragment.tdcID);
+    pending.sources |= (1 << fragment.tdcID);
+
+    lastID[fragment.tdcID] = std::max(lastID[fragment.tdcID], (Long64_t)fragment.eventID);
+}
+
+/**
+ * @brief Moves all events that will not get any more fragments to ready.
+ *
+ * An event is final if all sources delivered their fragment, or if every
+ * source that sent data so far is already past its eventID. If a source stops
+ * sending, the oldest events are released once more than maxPending are open,
+ * so the memory and the latency stay bounded.
+ *
+ * @param ready The final events are appended in eventID order.
+ */
+void LiveEventBuilder::takeReady(std::vector<TDCEvent>& ready) {
+    Long64_t minSeen = -1;
+    for (Long64_t id : lastID) {
+        if (id < 0) continue;
+        minSeen = (minSeen < 0) ? id : std::min(minSeen, id);
+    }
+
+    for (auto it = events.begin(); it != events.end();) {
+        bool final = it->second.sources == ALL_SOURCES
+                  || (Long64_t)it->first < minSeen
+                  || events.size() > maxPending;
+        if (final) {
+            ready.push_back(it->second.event);
+            it = events.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Releases all pending events, at the end of the run
+void LiveEventBuilder::flush(std::vector<TDCEvent>& ready) {
+    for (auto& [id, pending] : events) {
+        ready.push_back(pending.event);
+    }
+    events.clear();
+}
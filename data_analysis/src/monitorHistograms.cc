@@ -0,0 +1,90 @@
+#include "monitorHistograms.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+MonitorHistograms::MonitorHistograms(double timeBin_s, double totBin_ns) {
+    std::memset(&summary, 0, sizeof(summary));
+    summary.timeBin_s = timeBin_s;
+    summary.totBin_ns = totBin_ns;
+}
+
+void MonitorHistograms::fill(const FilteredEvent& event) {
+    fill(event.tdcTimeTag_ns, event.mixGate, event.bgoToT, event.barOToT, event.barIToT);
+}
+
+/**
+ * @brief Adds one filtered event to all histograms.
+ *
+ * @param tdcTimeTag_ns Time since the run start, events without time tag are only counted.
+ * @param mixGate True if the event is inside the mixing gate.
+ * @param bgoToT ToT per BGO channel in ns, NaN for channels without hit.
+ * @param barOToT ToT of the outer bars with a coincidence of both ends, NaN otherwise.
+ * @param barIToT The same for the inner bars.
+ */
+void MonitorHistograms::fill(Double_t tdcTimeTag_ns, Bool_t mixGate,
+                             const ROOT::RVec<Double_t>& bgoToT,
+                             const ROOT::RVec<Double_t>& barOToT,
+                             const ROOT::RVec<Double_t>& barIToT) {
+    summary.eventsCut++;
+    if (mixGate) summary.eventsCutGate++;
+
+    if (!std::isnan(tdcTimeTag_ns) && tdcTimeTag_ns >= 0) {
+        size_t bin = std::min<size_t>(static_cast<size_t>(tdcTimeTag_ns * 1e-9 / summary.timeBin_s), MAX_TIME_BINS - 1);
+        if (bin >= bins.size()) bins.resize(bin + 1, hodo_gui_bin{0, 0});
+        bins[bin].events++;
+        if (mixGate) bins[bin].eventsGate++;
+    }
+
+    for (size_t ch = 0; ch < HODO_GUI_N_BGO && ch < bgoToT.size(); ch++) {
+        if (!(bgoToT[ch] > 0)) continue;
+        summary.bgo[ch]++;
+        summary.bgoToTSum[ch] += bgoToT[ch];
+        fillToT(summary.bgoToT, bgoToT[ch], summary.totBin_ns);
+    }
+    for (size_t bar = 0; bar < HODO_GUI_N_BAR && bar < barOToT.size(); bar++) {
+        if (!(barOToT[bar] > 0)) continue;
+        summary.barO[bar]++;
+        fillToT(summary.barToT, barOToT[bar], summary.totBin_ns);
+    }
+    for (size_t bar = 0; bar < HODO_GUI_N_BAR && bar < barIToT.size(); bar++) {
+        if (!(barIToT[bar] > 0)) continue;
+        summary.barI[bar]++;
+        fillToT(summary.barToT, barIToT[bar], summary.totBin_ns);
+    }
+}
+
+// Adds the histograms of another instance with the same binning, used to combine the RDataFrame slots
+void MonitorHistograms::merge(const MonitorHistograms& other) {
+    const hodo_gui_snapshot& o = other.summary;
+    summary.eventsCut += o.eventsCut;
+    summary.eventsCutGate += o.eventsCutGate;
+    for (size_t i = 0; i < HODO_GUI_N_BGO; i++) {
+        summary.bgo[i] += o.bgo[i];
+        summary.bgoToTSum[i] += o.bgoToTSum[i];
+    }
+    for (size_t i = 0; i < HODO_GUI_N_BAR; i++) {
+        summary.barO[i] += o.barO[i];
+        summary.barI[i] += o.barI[i];
+    }
+    for (size_t i = 0; i < HODO_GUI_N_TOT_BINS; i++) {
+        summary.bgoToT[i] += o.bgoToT[i];
+        summary.barToT[i] += o.barToT[i];
+    }
+
+    if (other.bins.size() > bins.size()) bins.resize(other.bins.size(), hodo_gui_bin{0, 0});
+    for (size_t i = 0; i < other.bins.size(); i++) {
+        bins[i].events += other.bins[i].events;
+        bins[i].eventsGate += other.bins[i].eventsGate;
+    }
+}
+
+void MonitorHistograms::reset() {
+    *this = MonitorHistograms(summary.timeBin_s, summary.totBin_ns);
+}
+
+void MonitorHistograms::fillToT(uint32_t* histogram, Double_t tot_ns, double binWidth) {
+    size_t bin = std::min<size_t>(static_cast<size_t>(tot_ns / binWidth), HODO_GUI_N_TOT_BINS - 1);
+    histogram[bin]++;
+}
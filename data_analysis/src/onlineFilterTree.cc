@@ -0,0 +1,76 @@
+#include "onlineFilterTree.hh"
+#include "logger.hh"
+
+/**
+ * @brief Fills the filter counts from the data of one FILT bank event.
+ *
+ * @param data Accepted, rejected and prescaled events, then the IDs of the
+ *             prescaled events.
+ * @param timestamp_ns System time of the DAQ in ns.
+ * @return false if the event has too few words.
+ */
+bool OnlineFilterEvent::decode(const std::vector<uint32_t>& data, uint64_t timestamp_ns) {
+    if (data.size() < FILT_WORDS || data.size() < FILT_WORDS + static_cast<size_t>(data[2])) return false;
+
+    timestamp = static_cast<Double_t>(timestamp_ns) * 1e-9;
+    accepted  = data[0];
+    rejected  = data[1];
+    prescaledIDs.assign(data.begin() + FILT_WORDS, data.begin() + FILT_WORDS + data[2]);
+    return true;
+}
+
+/**
+ * @brief Creates the OnlineFilterTree in the given directory.
+ *
+ * @param dir The output file of the DataDecoder.
+ */
+OnlineFilterTree::OnlineFilterTree(TDirectory* dir) {
+    if (!dir) return;
+    dir->cd();
+
+    // a tree that is already in the file is continued, when a decoding is resumed
+    tree = dir->Get<TTree>("OnlineFilterTree");
+    bool attach = tree != nullptr;
+    if (!attach) tree = new TTree("OnlineFilterTree", "Online filter of the DAQ");
+    auto branch = [this, attach](const char* branchName, auto* address) {
+        if (attach) tree->SetBranchAddress(branchName, address);
+        else tree->Branch(branchName, address);
+    };
+
+    branch("timestamp",       &entry.timestamp);
+    branch("cuspRunNumber",   &entry.cuspRunNumber);
+    branch("accepted",        &entry.accepted);
+    branch("rejected",        &entry.rejected);
+    if (attach) tree->SetBranchAddress("prescaledIDs", &prescaledIDs);     // objects by pointer to pointer
+    else tree->Branch("prescaledIDs", &entry.prescaledIDs);
+    tree->SetAutoSave(0);
+}
+
+void OnlineFilterTree::fill(const OnlineFilterEvent& filter) {
+    if (!tree) return;
+    entry = filter;
+    tree->Fill();
+}
+
+/**
+ * @brief Writes the tree, unless no block had a FILT bank.
+ */
+void OnlineFilterTree::write() {
+    if (!tree || tree->GetEntries() == 0) return;
+    tree->GetDirectory()->cd();
+    tree->Write("", TObject::kOverwrite);
+}
+
+/**
+ * @brief Copies the OnlineFilterTree from one file into another, if it exists.
+ */
+void OnlineFilterTree::copy(TDirectory* from, TDirectory* to) {
+    if (!from || !to) return;
+    auto* source = from->Get<TTree>("OnlineFilterTree");
+    if (!source) return;
+
+    to->cd();
+    TTree* copied = source->CloneTree(-1, "fast");
+    copied->Write("", TObject::kOverwrite);
+    Logger::getLogger()->debug("Copied OnlineFilterTree with {} entries", copied->GetEntries());
+}
@@ -0,0 +1,81 @@
+#include "scalerTree.hh"
+#include "logger.hh"
+
+/**
+ * @brief Fills the counters from the data of one SCLR bank event.
+ *
+ * @param data The SCALER_WORDS counters.
+ * @param timestamp_ns System time of the readout in ns.
+ * @return false if the event has too few words.
+ */
+bool ScalerEvent::decode(const std::vector<uint32_t>& data, uint64_t timestamp_ns) {
+    if (data.size() < SCALER_WORDS) return false;
+
+    timestamp         = static_cast<Double_t>(timestamp_ns) * 1e-9;
+    eventCnt          = data[SCALER_EVENT_CNT];
+    freq              = data[SCALER_FREQ];
+    coincidencesUpper = data[SCALER_COINC_UPPER];
+    coincidencesLower = data[SCALER_COINC_LOWER];
+    signalsBgo        = data[SCALER_SIGNALS_BGO];
+    triggerCnt        = data[SCALER_TRIGGER_CNT];
+    gatedCnt          = data[SCALER_GATED_CNT];
+    return true;
+}
+
+/**
+ * @brief Creates the ScalerTree in the given directory.
+ *
+ * @param dir The output file of the DataDecoder.
+ */
+ScalerTree::ScalerTree(TDirectory* dir) {
+    if (!dir) return;
+    dir->cd();
+
+    // a tree that is already in the file is continued, when a decoding is resumed
+    tree = dir->Get<TTree>("ScalerTree");
+    bool attach = tree != nullptr;
+    if (!attach) tree = new TTree("ScalerTree", "V2495 counters");
+    auto branch = [this, attach](const char* branchName, auto* address) {
+        if (attach) tree->SetBranchAddress(branchName, address);
+        else tree->Branch(branchName, address);
+    };
+
+    branch("timestamp",          &entry.timestamp);
+    branch("cuspRunNumber",      &entry.cuspRunNumber);
+    branch("eventCnt",           &entry.eventCnt);
+    branch("freq",               &entry.freq);
+    branch("coincidencesUpper",  &entry.coincidencesUpper);
+    branch("coincidencesLower",  &entry.coincidencesLower);
+    branch("signalsBgo",         &entry.signalsBgo);
+    branch("triggerCnt",         &entry.triggerCnt);
+    branch("gatedCnt",           &entry.gatedCnt);
+    tree->SetAutoSave(0);
+}
+
+void ScalerTree::fill(const ScalerEvent& scaler) {
+    if (!tree) return;
+    entry = scaler;
+    tree->Fill();
+}
+
+void ScalerTree::write() {
+    if (!tree) return;
+    tree->GetDirectory()->cd();
+    tree->Write("", TObject::kOverwrite);
+}
+
+/**
+ * @brief Copies the ScalerTree from one file into another, if it exists.
+ *
+ * Used by the file sorter so the merged file keeps the scalers of the raw file.
+ */
+void ScalerTree::copy(TDirectory* from, TDirectory* to) {
+    if (!from || !to) return;
+    auto* source = from->Get<TTree>("ScalerTree");
+    if (!source) return;
+
+    to->cd();
+    TTree* copied = source->CloneTree(-1, "fast");
+    copied->Write("", TObject::kOverwrite);
+    Logger::getLogger()->debug("Copied ScalerTree with {} entries", copied->GetEntries());
+}
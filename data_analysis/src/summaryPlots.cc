@@ -0,0 +1,237 @@
+#include "summaryPlots.hh"
+#include "logger.hh"
+
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#include <TCanvas.h>
+#include <TColor.h>
+#include <TEllipse.h>
+#include <TFile.h>
+#include <TLegend.h>
+#include <TParameter.h>
+#include <TROOT.h>
+#include <TStyle.h>
+
+namespace {
+
+constexpr int N_BAR = 32;
+
+std::mutex drawMutex;               // ROOT graphics are not thread safe, the batch mode draws from several threads
+
+}
+
+/**
+ * @brief Without the BGO geometry the hit maps are left out, all other plots are made.
+ */
+SummaryPlots::SummaryPlots(const std::string& bgoGeomFile) : geometry(BgoGeometry::get(bgoGeomFile)) {
+}
+
+/**
+ * @brief Books the summary histograms on the filtered node, they are filled
+ *        by the next event loop of the graph.
+ *
+ * @param filtered The filtered node of DataFilter::buildFilterGraph.
+ */
+void SummaryPlots::book(ROOT::RDF::RNode filtered) {
+    auto gated = filtered.Filter([](Bool_t mixGate) { return mixGate == true; }, {"mixGate"});
+    nEvents = filtered.Count();
+    nMixEvents = gated.Count();
+
+    // Time since the run start on both clocks, they start and tick differently,
+    // so after the event loop one of them is used for the whole run.
+    // No axis limits, the range is taken from the data
+    auto hasTime = [](Double_t t_ns) { return !std::isnan(t_ns); };
+    auto toSeconds = [](Double_t t_ns) { return t_ns * 1e-9; };
+    for (bool fpga : {true, false}) {
+        const char* column = fpga ? "fpgaTimeTag_ns" : "tdcTimeTag_ns";
+        const std::string clock = fpga ? "Fpga" : "Tdc";
+        auto all = filtered.Filter(hasTime, {column}).Define("summaryTime_s", toSeconds, {column});
+        auto mix = all.Filter([](Bool_t mixGate) { return mixGate == true; }, {"mixGate"});
+        TimeHistograms& times = fpga ? fpgaTimes : tdcTimes;
+        times.events = all.Histo1D<Double_t>({("eventTimes" + clock).c_str(), ("Events, " + clock + " time;Time (s);Events").c_str(), 1000, 0., 0.}, "summaryTime_s");
+        times.mixEvents = mix.Histo1D<Double_t>({("mixEventTimes" + clock).c_str(), ("Mixing events, " + clock + " time;Time (s);Events").c_str(), 1000, 0., 0.}, "summaryTime_s");
+    }
+    bgoHits = filtered.Aggregate(
+        [](BgoHitMap& map, const ROOT::RVec<Double_t>& bgoToT) { map.fill(bgoToT); },
+        [](std::vector<BgoHitMap>& maps) {
+            for (size_t i = 1; i < maps.size(); i++) maps[0].merge(maps[i]);
+        },
+        "bgoToT", BgoHitMap());
+    barOChannels = filtered.Histo1D<std::vector<int>>({"barOChannels", "Outer bar occupancy;Bar;Events", N_BAR, -0.5, N_BAR - 0.5}, "barO_Channels");
+    barIChannels = filtered.Histo1D<std::vector<int>>({"barIChannels", "Inner bar occupancy;Bar;Events", N_BAR, -0.5, N_BAR - 0.5}, "barI_Channels");
+    cuspRuns = filtered.Aggregate(
+        [](std::map<UInt_t, ULong64_t>& counts, UInt_t run) { counts[run]++; },
+        [](std::vector<std::map<UInt_t, ULong64_t>>& counts) {
+            for (size_t i = 1; i < counts.size(); i++) {
+                for (const auto& [run, n] : counts[i]) counts[0][run] += n;
+            }
+        },
+        "cuspRunNumber", std::map<UInt_t, ULong64_t>());
+    booked = true;
+}
+
+/**
+ * @brief The time histograms of the run: the FPGA time tag if any event has
+ *        one, the TDC time tag otherwise.
+ */
+SummaryPlots::TimeHistograms& SummaryPlots::times() {
+    return fpgaTimes.events->GetEntries() > 0 ? fpgaTimes : tdcTimes;
+}
+
+/**
+ * @brief The CUSP run number of most of the events, 0 without events.
+ */
+UInt_t SummaryPlots::cuspRunNumber() {
+    UInt_t run = 0;
+    ULong64_t most = 0;
+    for (const auto& [cusp, n] : *cuspRuns) {
+        if (n > most) {
+            run = cusp;
+            most = n;
+        }
+    }
+    return run;
+}
+
+/**
+ * @brief Writes the histograms into the directory Summary of a ROOT file.
+ *
+ * @param rootFile The data file of the run, opened for update.
+ * @return false if the file could not be opened.
+ */
+bool SummaryPlots::write(const std::string& rootFile) {
+    if (!booked) return false;
+
+    std::unique_ptr<TFile> file(TFile::Open(rootFile.c_str(), "UPDATE"));
+    if (!file || file->IsZombie()) {
+        Logger::getLogger()->error("Could not open {} for the summary", rootFile);
+        return false;
+    }
+
+    TDirectory* dir = file->mkdir("Summary", "", true);
+    dir->cd();
+    times().events->Write("eventTimes", TObject::kOverwrite);
+    times().mixEvents->Write("mixEventTimes", TObject::kOverwrite);
+    for (TH1* h : {barOChannels.GetPtr(), barIChannels.GetPtr()}) {
+        h->Write("", TObject::kOverwrite);
+    }
+
+    TH1D bgoChannels("bgoChannels", "BGO occupancy;Channel;Events", BgoHitMap::N_CHANNELS, -0.5, BgoHitMap::N_CHANNELS - 0.5);
+    bgoChannels.SetDirectory(nullptr);
+    for (int ch = 0; ch < BgoHitMap::N_CHANNELS; ch++) bgoChannels.SetBinContent(ch + 1, bgoHits->hits[ch]);
+    bgoChannels.Write("", TObject::kOverwrite);
+    if (geometry.isLoaded()) {
+        geometry.hitMap(*bgoHits, false, "bgoHitMap", "BGO hits;x (mm);y (mm)")->Write("", TObject::kOverwrite);
+        geometry.hitMap(*bgoHits, true, "bgoToTMap", "BGO ToT sum (ns);x (mm);y (mm)")->Write("", TObject::kOverwrite);
+    }
+    TParameter<Int_t>("cuspRunNumber", cuspRunNumber()).Write("", TObject::kOverwrite);
+    file->Close();
+    return true;
+}
+
+/**
+ * @brief Draws the event curves, the BGO hit maps and the bar occupancy.
+ *
+ * @param prefix Saved as <prefix>_events, _bgo, _bgo_tot and _bars, each .png and .pdf.
+ * @param guiPrefix If set, the event curves and the hit map are also saved as
+ *                  <guiPrefix>_events.png and _bgo.png for the run control.
+ */
+void SummaryPlots::savePlots(const std::string& prefix, const std::string& guiPrefix) {
+    auto log = Logger::getLogger();
+    if (!booked) return;
+    if (events() == 0) {
+        log->warn("No events after cuts, no summary plots");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(drawMutex);
+    gROOT->SetBatch(true);
+    gStyle->SetOptStat(0);
+    gStyle->SetPalette(kViridis);
+
+    auto save = [&](TCanvas& canvas, const std::string& name, bool gui) {
+        canvas.SaveAs((prefix + "_" + name + ".png").c_str());
+        canvas.SaveAs((prefix + "_" + name + ".pdf").c_str());
+        if (gui && !guiPrefix.empty()) canvas.SaveAs((guiPrefix + "_" + name + ".png").c_str());
+    };
+    const int blue = TColor::GetColor("#316D97");
+    const int purple = TColor::GetColor("#65236E");
+
+    // Events and mixing events since the run start
+    {
+        TCanvas canvas("summaryEvents", "", 900, 600);
+        std::unique_ptr<TH1> total(times().events->GetCumulative());
+        std::unique_ptr<TH1> mixing(times().mixEvents->GetCumulative());
+        total->SetDirectory(nullptr);
+        mixing->SetDirectory(nullptr);
+        total->SetTitle(";Time (s);Events");
+        total->SetLineColor(blue);
+        total->SetLineWidth(2);
+        mixing->SetLineColor(purple);
+        mixing->SetLineWidth(2);
+        total->Draw("HIST L");
+        if (mixEvents() > 0) mixing->Draw("HIST L SAME");
+
+        TLegend legend(0.12, 0.75, 0.45, 0.88);
+        legend.AddEntry(total.get(), ("Events: " + std::to_string(events())).c_str(), "l");
+        legend.AddEntry(mixing.get(), ("Mixing Events: " + std::to_string(mixEvents())).c_str(), "l");
+        legend.Draw();
+        save(canvas, "events", true);
+    }
+
+    // BGO hits and summed ToT per channel at the channel positions
+    if (geometry.isLoaded()) {
+        for (bool totWeighted : {false, true}) {
+            TCanvas canvas("summaryBgo", "", 700, 600);
+            canvas.SetRightMargin(0.15);
+            auto map = geometry.hitMap(*bgoHits, totWeighted, "bgoMap", totWeighted ? ";x (mm);y (mm);ToT sum (ns)" : ";x (mm);y (mm);Counts");
+            map->Draw("COLZ");
+            TEllipse disc(0., 0., BgoGeometry::RADIUS);
+            disc.SetFillStyle(0);
+            disc.SetLineStyle(2);
+            disc.Draw();
+            save(canvas, totWeighted ? "bgo_tot" : "bgo", !totWeighted);
+        }
+    }
+
+    // Bars with a coincidence of both ends
+    {
+        TCanvas canvas("summaryBars", "", 900, 600);
+        barOChannels->SetLineColor(blue);
+        barIChannels->SetLineColor(purple);
+        barOChannels->SetTitle(";Bar;Events");
+        barOChannels->SetMaximum(1.1 * std::max(barOChannels->GetMaximum(), barIChannels->GetMaximum()));
+        barOChannels->Draw("HIST");
+        barIChannels->Draw("HIST SAME");
+
+        TLegend legend(0.75, 0.78, 0.88, 0.88);
+        legend.AddEntry(barOChannels.GetPtr(), "Outer", "l");
+        legend.AddEntry(barIChannels.GetPtr(), "Inner", "l");
+        legend.Draw();
+        save(canvas, "bars", false);
+    }
+}
+
+/**
+ * @brief Writes the overview of the run shown by the run control.
+ *
+ * @param csvFile Overwritten with RunNr,CUSPNumber,Events,MixEvents.
+ * @param runNumber The analysed run.
+ * @return false if the file could not be written.
+ */
+bool SummaryPlots::writeOverview(const std::string& csvFile, int runNumber) {
+    if (!booked) return false;
+
+    std::ofstream csv(csvFile);
+    if (!csv.is_open()) {
+        Logger::getLogger()->error("Could not write {}", csvFile);
+        return false;
+    }
+    csv << "RunNr,CUSPNumber,Events,MixEvents\n"
+        << runNumber << "," << cuspRunNumber() << "," << events() << "," << mixEvents() << "\n";
+    return true;
+}
@@ -1,4 +1,5 @@
 #include "tdcEvent.hh"
+#include <TParameter.h>
 
 // Constructor definition
 TDCEvent::TDCEvent() {
@@ -7,31 +8,31 @@ TDCEvent::TDCEvent() {
 
 void TDCEvent::reset() {
     // Reset arrays using std::fill
-    std::fill(std::begin(trgLE), std::end(trgLE), std::nan(""));
-    std::fill(std::begin(trgTE), std::end(trgTE), std::nan(""));
-
-    std::fill(std::begin(hodoIDsLE), std::end(hodoIDsLE), std::nan(""));
-    std::fill(std::begin(hodoIUsLE), std::end(hodoIUsLE), std::nan(""));
-    std::fill(std::begin(hodoODsLE), std::end(hodoODsLE), std::nan(""));
-    std::fill(std::begin(hodoOUsLE), std::end(hodoOUsLE), std::nan(""));
-    std::fill(std::begin(hodoIDsTE), std::end(hodoIDsTE), std::nan(""));
-    std::fill(std::begin(hodoIUsTE), std::end(hodoIUsTE), std::nan(""));
-    std::fill(std::begin(hodoODsTE), std::end(hodoODsTE), std::nan(""));
-    std::fill(std::begin(hodoOUsTE), std::end(hodoOUsTE), std::nan(""));
+    std::fill(std::begin(trgLE), std::end(trgLE), INT32_UNSET);
+    std::fill(std::begin(trgTE), std::end(trgTE), INT32_UNSET);
+
+    std::fill(std::begin(hodoIDsLE), std::end(hodoIDsLE), INT32_UNSET);
+    std::fill(std::begin(hodoIUsLE), std::end(hodoIUsLE), INT32_UNSET);
+    std::fill(std::begin(hodoODsLE), std::end(hodoODsLE), INT32_UNSET);
+    std::fill(std::begin(hodoOUsLE), std::end(hodoOUsLE), INT32_UNSET);
+    std::fill(std::begin(hodoIDsTE), std::end(hodoIDsTE), INT32_UNSET);
+    std::fill(std::begin(hodoIUsTE), std::end(hodoIUsTE), INT32_UNSET);
+    std::fill(std::begin(hodoODsTE), std::end(hodoODsTE), INT32_UNSET);
+    std::fill(std::begin(hodoOUsTE), std::end(hodoOUsTE), INT32_UNSET);
     // std::fill(std::begin(hodoIDsToT), std::end(hodoIDsToT), std::nan(""));
     // std::fill(std::begin(hodoIUsToT), std::end(hodoIUsToT), std::nan(""));
     // std::fill(std::begin(hodoODsToT), std::end(hodoODsToT), std::nan(""));
     // std::fill(std::begin(hodoOUsToT), std::end(hodoOUsToT), std::nan(""));
 
-    std::fill(std::begin(bgoLE), std::end(bgoLE), std::nan(""));
-    std::fill(std::begin(bgoTE), std::end(bgoTE), std::nan(""));
+    std::fill(std::begin(bgoLE), std::end(bgoLE), INT32_UNSET);
+    std::fill(std::begin(bgoTE), std::end(bgoTE), INT32_UNSET);
     // std::fill(std::begin(bgoToT), std::end(bgoToT), std::nan(""));
 
-    std::fill(std::begin(tileILE), std::end(tileILE), std::nan(""));
-    std::fill(std::begin(tileITE), std::end(tileITE), std::nan(""));
+    std::fill(std::begin(tileILE), std::end(tileILE), INT32_UNSET);
+    std::fill(std::begin(tileITE), std::end(tileITE), INT32_UNSET);
     // std::fill(std::begin(tileIToT), std::end(tileIToT), std::nan(""));
-    std::fill(std::begin(tileOLE), std::end(tileOLE), std::nan(""));
-    std::fill(std::begin(tileOTE), std::end(tileOTE), std::nan(""));
+    std::fill(std::begin(tileOLE), std::end(tileOLE), INT32_UNSET);
+    std::fill(std::begin(tileOTE), std::end(tileOTE), INT32_UNSET);
     // std::fill(std::begin(tileOToT), std::end(tileOToT), std::nan(""));
 
     // Reset individual scalar variables
@@ -40,9 +41,39 @@ void TDCEvent::reset() {
     cuspRunNumber = UINT32_UNSET;
     mixGate = BOOL_UNSET;
     dumpGate = BOOL_UNSET;
-    tdcTimeTag = std::nan("");
-    fpgaTimeTag = std::nan("");
+    tdcTimeTag = UINT64_UNSET;
+    fpgaTimeTag = UINT64_UNSET;
     tdcID = UINT32_UNSET;
 }
 
-ClassImp(TDCEvent);  // This implements the ROOT type system for TDCEvent
\ No newline at end of file
+ClassImp(TDCEvent);  // This implements the ROOT type system for TDCEvent
+
+/**
+ * @brief Writes the tick sizes as TParameters into the given directory.
+ *
+ * @param dir The directory (usually the ROOT file) holding the trees.
+ */
+void TickSizes::write(TDirectory* dir) const {
+    if (!dir) return;
+    dir->cd();
+    TParameter<Double_t>("tdcTick_ns", tdc_ns).Write("", TObject::kOverwrite);
+    TParameter<Double_t>("etttTick_ns", ettt_ns).Write("", TObject::kOverwrite);
+    TParameter<Double_t>("fpgaTick_ns", fpga_ns).Write("", TObject::kOverwrite);
+}
+
+/**
+ * @brief Reads the tick sizes from the given directory.
+ *
+ * Tick sizes that are not stored in the directory keep their default values.
+ *
+ * @param dir The directory (usually the ROOT file) holding the trees.
+ * @return The tick sizes in ns.
+ */
+TickSizes TickSizes::read(TDirectory* dir) {
+    TickSizes ticks;
+    if (!dir) return ticks;
+    if (auto* p = dir->Get<TParameter<Double_t>>("tdcTick_ns"))  ticks.tdc_ns  = p->GetVal();
+    if (auto* p = dir->Get<TParameter<Double_t>>("etttTick_ns")) ticks.ettt_ns = p->GetVal();
+    if (auto* p = dir->Get<TParameter<Double_t>>("fpgaTick_ns")) ticks.fpga_ns = p->GetVal();
+    return ticks;
+}
@@ -0,0 +1,177 @@
+#include "trackReco.hh"
+#include "logger.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+struct Cluster {
+    Double_t phi;       // rad
+    Double_t z;         // mm
+};
+
+// Azimuth difference in [0, pi]
+Double_t deltaPhi(Double_t a, Double_t b) {
+    Double_t d = std::fmod(std::fabs(a - b), 2 * M_PI);
+    return (d > M_PI) ? 2 * M_PI - d : d;
+}
+
+/**
+ * @brief Groups neighbouring bars with a z position into clusters, bar 31
+ *        and bar 0 are neighbours. Azimuth and z are averaged with the ToT.
+ */
+std::vector<Cluster> clusterBars(const ROOT::RVec<Double_t>& z, const ROOT::RVec<Double_t>& tot, const HodoGeometry& geometry) {
+    constexpr int N = HodoGeometry::N_BARS;
+    std::vector<Cluster> clusters;
+
+    auto hit = [&](int bar) { return !std::isnan(z[bar]) && tot[bar] > 0; };
+
+    // Start after a bar without hit, so no cluster is split at the wrap around
+    int start = 0;
+    while (start < N && hit(start)) start++;
+    if (start == N) start = 0;
+
+    Double_t sumW = 0, sumCos = 0, sumSin = 0, sumZ = 0;
+    auto close = [&]() {
+        if (sumW <= 0) return;
+        clusters.push_back({std::atan2(sumSin, sumCos), sumZ / sumW});
+        sumW = sumCos = sumSin = sumZ = 0;
+    };
+
+    for (int i = 1; i <= N; i++) {
+        int bar = (start + i) % N;
+        if (!hit(bar)) {
+            close();
+            continue;
+        }
+        Double_t phi = geometry.barPhi(bar);
+        sumW += tot[bar];
+        sumCos += tot[bar] * std::cos(phi);
+        sumSin += tot[bar] * std::sin(phi);
+        sumZ += tot[bar] * z[bar];
+    }
+    close();
+    return clusters;
+}
+
+}
+
+/**
+ * @brief Reads the track_reco and hodoscope geometry keys, missing keys keep their defaults.
+ */
+HodoGeometry HodoGeometry::fromConfig(const std::map<std::string, std::string>& config) {
+    HodoGeometry geometry;
+
+    try {
+        if (config.count("track_reco"))           geometry.enabled = std::stoi(config.at("track_reco")) != 0;
+        if (config.count("hodo_inner_radius_mm")) geometry.innerRadius_mm = std::stod(config.at("hodo_inner_radius_mm"));
+        if (config.count("hodo_outer_radius_mm")) geometry.outerRadius_mm = std::stod(config.at("hodo_outer_radius_mm"));
+        if (config.count("hodo_bar_speed_mm_ns")) geometry.barSpeed_mm_ns = std::stod(config.at("hodo_bar_speed_mm_ns"));
+        if (config.count("hodo_phi0_deg"))        geometry.phi0_deg = std::stod(config.at("hodo_phi0_deg"));
+        if (config.count("bgo_z_mm"))             geometry.bgoZ_mm = std::stod(config.at("bgo_z_mm"));
+        if (config.count("track_max_dphi_deg"))   geometry.maxDphi_deg = std::stod(config.at("track_max_dphi_deg"));
+    } catch (const std::exception& e) {
+        Logger::getLogger()->error("Invalid track reconstruction setting in config: {}", e.what());
+    }
+    return geometry;
+}
+
+// Azimuth of the centre of a bar in rad
+Double_t HodoGeometry::barPhi(int bar) const {
+    return (phi0_deg + bar * 360. / N_BARS) * M_PI / 180.;
+}
+
+/**
+ * @brief The z position of the hit in each bar from the leading edges of both ends.
+ *
+ * The signal reaches the nearer end first, z = (t_us - t_ds) * v / 2, so hits
+ * downstream of the middle of the bar have a positive z. Fixed length loop
+ * without branches, vectorised by the compiler.
+ *
+ * @param dsLE, usLE Leading edges of the downstream and upstream ends in TDC ticks.
+ * @param dsToT, usToT ToT of both ends in ns, NaN for ends without hit.
+ * @param tick_ns The TDC tick size.
+ * @return z in mm per bar, NaN for bars without hits on both ends.
+ */
+ROOT::RVec<Double_t> barZ(const ROOT::RVec<Int_t>& dsLE, const ROOT::RVec<Int_t>& usLE,
+                          const ROOT::RVec<Double_t>& dsToT, const ROOT::RVec<Double_t>& usToT,
+                          Double_t tick_ns, const HodoGeometry& geometry) {
+    constexpr int N = HodoGeometry::N_BARS;
+    const Double_t scale = tick_ns * geometry.barSpeed_mm_ns / 2;
+
+    ROOT::RVec<Double_t> z(N);
+    for (int bar = 0; bar < N; bar++) {
+        bool both = dsToT[bar] > 0 && usToT[bar] > 0 && dsLE[bar] > 0 && usLE[bar] > 0;
+        z[bar] = both ? (usLE[bar] - dsLE[bar]) * scale : NAN;
+    }
+    return z;
+}
+
+/**
+ * @brief Fits straight tracks through the bar clusters of both layers.
+ *
+ * Every inner cluster is paired with the closest outer cluster in azimuth
+ * (closest pairs first, each cluster used once, at most maxDphi_deg apart).
+ * The line through both clusters is extrapolated to the BGO plane, the mean
+ * of all tracks there is the vertex of the event.
+ *
+ * @param zI, zO z per bar of the inner and outer layer, see barZ.
+ * @param totI, totO ToT per bar in ns, the weights of the clusters.
+ */
+HodoTracks reconstructTracks(const ROOT::RVec<Double_t>& zI, const ROOT::RVec<Double_t>& totI,
+                             const ROOT::RVec<Double_t>& zO, const ROOT::RVec<Double_t>& totO,
+                             const HodoGeometry& geometry) {
+    HodoTracks tracks;
+    auto inner = clusterBars(zI, totI, geometry);
+    auto outer = clusterBars(zO, totO, geometry);
+    if (inner.empty() || outer.empty()) return tracks;
+
+    struct Pair { Double_t dphi; size_t i, o; };
+    std::vector<Pair> pairs;
+    const Double_t maxDphi = geometry.maxDphi_deg * M_PI / 180.;
+    for (size_t i = 0; i < inner.size(); i++) {
+        for (size_t o = 0; o < outer.size(); o++) {
+            Double_t d = deltaPhi(inner[i].phi, outer[o].phi);
+            if (d <= maxDphi) pairs.push_back({d, i, o});
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) { return a.dphi < b.dphi; });
+
+    std::vector<bool> usedI(inner.size()), usedO(outer.size());
+    Double_t sumX = 0, sumY = 0;
+    int nVertex = 0;
+    for (const auto& pair : pairs) {
+        if (usedI[pair.i] || usedO[pair.o]) continue;
+        usedI[pair.i] = usedO[pair.o] = true;
+
+        const Cluster& ci = inner[pair.i];
+        const Cluster& co = outer[pair.o];
+        Double_t xi = geometry.innerRadius_mm * std::cos(ci.phi), yi = geometry.innerRadius_mm * std::sin(ci.phi);
+        Double_t xo = geometry.outerRadius_mm * std::cos(co.phi), yo = geometry.outerRadius_mm * std::sin(co.phi);
+
+        Double_t dz = co.z - ci.z;
+        Double_t t = (std::fabs(dz) > 1e-6) ? (geometry.bgoZ_mm - ci.z) / dz : NAN;
+        Double_t x = xi + t * (xo - xi);
+        Double_t y = yi + t * (yo - yi);
+
+        tracks.phiI.push_back(ci.phi);
+        tracks.zI.push_back(ci.z);
+        tracks.phiO.push_back(co.phi);
+        tracks.zO.push_back(co.z);
+        tracks.bgoX.push_back(x);
+        tracks.bgoY.push_back(y);
+        if (std::isfinite(x) && std::isfinite(y)) {
+            sumX += x;
+            sumY += y;
+            nVertex++;
+        }
+    }
+
+    if (nVertex > 0) {
+        tracks.vertexX = sumX / nVertex;
+        tracks.vertexY = sumY / nVertex;
+    }
+    return tracks;
+}
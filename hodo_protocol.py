@@ -0,0 +1,69 @@
+"""
+Reader for the binary frames hodo_analysis sends to the GUI over ZMQ.
+The layout is defined in data_analysis/include/guiProtocol.h, keep both in sync.
+@author: viktoria
+"""
+
+import struct
+import numpy as np
+
+MAGIC = 0x49554748      # "HGUI"
+VERSION = 2
+
+END = 2
+SNAPSHOT = 3
+TIMELINE = 4
+
+N_BGO = 64
+N_BAR = 32
+N_TOT_BINS = 128
+
+HEADER = struct.Struct("<IHHII")     # magic, version, type, count, recordSize
+
+END_DTYPE = np.dtype([("eventsCut", "<u8"), ("eventsCutGate", "<u8")])
+SNAPSHOT_DTYPE = np.dtype([("eventsCut", "<u8"), ("eventsCutGate", "<u8"),
+                           ("timeBin_s", "<f8"), ("totBin_ns", "<f8"),
+                           ("bgo", "<u4", (N_BGO,)), ("barO", "<u4", (N_BAR,)), ("barI", "<u4", (N_BAR,)),
+                           ("bgoToT", "<u4", (N_TOT_BINS,)), ("barToT", "<u4", (N_TOT_BINS,)),
+                           ("bgoToTSum", "<f8", (N_BGO,))])
+BIN_DTYPE = np.dtype([("events", "<u4"), ("eventsGate", "<u4")])
+
+_DTYPES = {END: END_DTYPE, SNAPSHOT: SNAPSHOT_DTYPE, TIMELINE: BIN_DTYPE}
+# Record sizes of the first layouts, fields appended later are only read if recordSize covers them
+_MIN_SIZES = {END: END_DTYPE.itemsize, SNAPSHOT: SNAPSHOT_DTYPE.fields["bgoToTSum"][1], TIMELINE: BIN_DTYPE.itemsize}
+
+
+class ProtocolError(ValueError):
+    pass
+
+
+def _with_stride(dtype, record_size):
+    """The fields within record_size, records of record_size bytes, newer senders may append fields"""
+    names = [name for name in dtype.names
+             if dtype.fields[name][1] + dtype.fields[name][0].itemsize <= record_size]
+    return np.dtype({"names": names,
+                     "formats": [dtype.fields[name][0] for name in names],
+                     "offsets": [dtype.fields[name][1] for name in names],
+                     "itemsize": record_size})
+
+
+def parse_frame(frame):
+    """Returns the frame type and its records as numpy structured array, without copying"""
+    if len(frame) < HEADER.size:
+        raise ProtocolError(f"Frame too short: {len(frame)} bytes")
+    magic, version, frame_type, count, record_size = HEADER.unpack_from(frame)
+    if magic != MAGIC:
+        raise ProtocolError(f"Wrong magic number 0x{magic:08x}")
+    if version > VERSION:
+        raise ProtocolError(f"Unsupported protocol version {version}")
+
+    dtype = _DTYPES.get(frame_type)
+    if dtype is None:
+        raise ProtocolError(f"Unknown frame type {frame_type}")
+
+    if record_size < _MIN_SIZES[frame_type] or len(frame) < HEADER.size + count * record_size:
+        raise ProtocolError(f"Frame of {len(frame)} bytes too short for {count} records of {record_size} bytes")
+
+    records = np.frombuffer(frame, dtype=_with_stride(dtype, record_size), count=count, offset=HEADER.size)
+    return frame_type, records
+
@@ -25,6 +25,7 @@ from matplotlib.colors import Normalize
 from mpl_toolkits.axes_grid1 import make_axes_locatable
 import zmq
 import traceback
+import hodo_protocol
 
 # Setup for plotting
 plt.style.use("ggplot")
@@ -153,6 +154,9 @@ class DAQControllerApp:
         self.config_file = "./config/daq_config.conf"  
         self.config = self.read_config()
         self.run_number = self.config.get("run_number", "Unknown")  # Get run_number or default to "Unknown"
+        # The live BGO map shows hits or the summed ToT per channel
+        self.bgo_map_tot = self.config.get("bgo_map_weight", "hits") == "tot"
+        self.bgo_map_label = "ToT sum (ns)" if self.bgo_map_tot else "Counts"
 
         # Read CUSP run number file
         self.run_file = "CUSP/Hodo.txt"  # File that stores the CUSP run number
@@ -265,13 +269,19 @@ class DAQControllerApp:
         self.daq_process = None
         self.run_running = False
 
+        # Persistent control connection to hodo_daq, opened on the first command
+        self.daq_socket = None
+        self.daq_socket_lock = threading.Lock()
+        self.daq_status = {}
+        self.daq_done = threading.Event()       # set when a start, stop or switch has finished
+        self.daq_done_line = ""
+
     # def setup_plots(self):
     #     """Creating event plot and BGO plot"""
 
-    #     # Data arrays for event plot
-    #     self.event_times = []
-    #     self.seen_event_ids = set()
-    #     self.gated_event_ids = set()
+    #     # Monitoring histograms from the live analysis, see hodo_protocol.py
+    #     self.monitor = None
+    #     self.timeline = np.zeros(0, dtype=hodo_protocol.BIN_DTYPE)
 
     #     # Create the event plot
     #     self.fig1, self.ax1 = plt.subplots(figsize=(500*px, 500*px))
@@ -391,22 +401,72 @@ class DAQControllerApp:
         self.root.after(2000, self.update_image)
 
 
-    def send_command(self, command):
-        """Send a TCP command to the DAQ controller."""
+    def connect_daq(self):
+        """Opens the control connection to the DAQ controller and subscribes to its status updates."""
 
         # TCP connection settings
         HOST = "127.0.0.1"  # Change to your DAQ controller's IP
         PORT = 12345        # Change to your chosen port
 
+        s = socket.create_connection((HOST, PORT), timeout=2)
+        s.settimeout(None)
+        s.sendall(b"subscribe\n")
+        self.daq_socket = s
+        threading.Thread(target=self.daq_listener, args=(s,), daemon=True).start()
+
+    def daq_listener(self, s):
+        """Reads the replies and status updates of the DAQ controller until the connection is closed."""
         try:
-            with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
-                s.connect((HOST, PORT))
-                s.sendall(command.encode())
-                self.console.write(f"Sent: {command}", "INFO")
-        except ConnectionRefusedError:
-            self.console.write("Error: Connection Refused, you need to run hodo_daq first!", "ERROR")
-        except Exception as e:
-            self.console.write(f"Error: {e}", "ERROR")
+            for line in s.makefile("r"):
+                line = line.strip()
+                if line.startswith("STATUS"):
+                    previous = self.daq_status
+                    self.daq_status = dict(item.split("=", 1) for item in line.split()[1:] if "=" in item)
+                    self.check_event_ids(previous, self.daq_status)
+                elif line.startswith("DONE"):
+                    self.daq_done_line = line
+                    self.daq_done.set()
+                    self.console.write(f"DAQ: {line}", "INFO")
+                elif line.startswith("ERROR") or line.startswith("BUSY"):
+                    self.console.write(f"DAQ: {line}", "ERROR")
+                elif line and not line.startswith("OK subscribe"):
+                    self.console.write(f"DAQ: {line}", "INFO")
+        except OSError:
+            pass
+        with self.daq_socket_lock:
+            if self.daq_socket is s:
+                self.daq_socket = None
+
+    def check_event_ids(self, previous, status):
+        """Warns on the console as soon as the DAQ reports skipped event IDs or a TDC/GATE drift."""
+        state = status.get("evid", "ok")
+        skips = int(status.get("evid_skips", 0))
+        if skips > int(previous.get("evid_skips", 0)):
+            self.console.write(f"DAQ: {skips - int(previous.get('evid_skips', 0))} event IDs skipped in run {status.get('run')}", "ERROR")
+        if state == "drift" and previous.get("evid") != "drift":
+            self.console.write(f"DAQ: TDC and GATE event counts differ by {status.get('evid_drift')} in run {status.get('run')}", "ERROR")
+        elif state == "ok" and previous.get("evid", "ok") != "ok":
+            self.console.write("DAQ: event IDs in sync again", "INFO")
+
+    def send_command(self, command):
+        """Send a command to the DAQ controller, the connection stays open for the next commands."""
+        with self.daq_socket_lock:
+            for attempt in range(2):    # reconnect once if the DAQ was restarted
+                try:
+                    if self.daq_socket is None:
+                        self.connect_daq()
+                    self.daq_socket.sendall(f"{command}\n".encode())
+                    self.console.write(f"Sent: {command}", "INFO")
+                    return
+                except ConnectionRefusedError:
+                    self.console.write("Error: Connection Refused, you need to run hodo_daq first!", "ERROR")
+                    return
+                except OSError as e:
+                    if self.daq_socket is not None:
+                        self.daq_socket.close()
+                        self.daq_socket = None
+                    if attempt == 1:
+                        self.console.write(f"Error: {e}", "ERROR")
 
     def start_run(self):
         self.send_command("start")
@@ -453,6 +513,31 @@ class DAQControllerApp:
             threading.Thread(target=self.after_analysis_monitor, daemon=True).start()
         
 
+    def switch_run(self):
+        """Ends the current run and starts the next one while the DAQ keeps running (auto run)."""
+        old_run = self.run_number
+        self.daq_done.clear()
+        self.send_command("switch")
+        if not self.daq_done.wait(timeout=10) or not self.daq_done_line.endswith("ok"):
+            self.console.write("Run switch failed, stopping and starting instead.", "WARNING")
+            self.stop_run()
+            time.sleep(5)  # Ensure the stop is fully processed
+            self.start_run()
+            return
+
+        lockfile = f"./tmp/hodo_run_{old_run}.lock"     # Lockfile of the old run is deleted, its live analysis finishes
+        if os.path.exists(lockfile):
+            os.remove(lockfile)
+        if self.analysis_after_enabled:
+            threading.Thread(target=self.after_analysis_monitor, args=(old_run,), daemon=True).start()
+
+        self.run_number = self.read_config().get("run_number", "Unknown")
+        self.run_number_label.config(text=f"Run Number: {self.run_number}")
+        lockfile = f"./tmp/hodo_run_{self.run_number}.lock"
+        open(lockfile, "w").close()
+        self.elapsed_time = 0
+        self.cusp_number_at_start = self.cusp_number
+
     def pause_daq(self):
         self.send_command("pause")
         self.pause_button.config(state="disabled")
@@ -620,12 +705,11 @@ class DAQControllerApp:
             if new_cusp_run and new_cusp_run != self.current_cusp_run:
                 self.console.write(f"CUSP number: {self.cusp_number}", "SUCCESS")
                 if self.run_active:  
-                    self.console.write(f"Stopping previous run before starting new run {new_cusp_run}.", "WARNING")
-                    self.stop_run()
-                    time.sleep(5)  # Ensure the stop is fully processed
-                
-                self.console.write(f"Starting new CUSP run: {new_cusp_run}", "SUCCESS")
-                self.start_run()
+                    self.console.write(f"Switching to new CUSP run: {new_cusp_run}", "SUCCESS")
+                    self.switch_run()
+                else:
+                    self.console.write(f"Starting new CUSP run: {new_cusp_run}", "SUCCESS")
+                    self.start_run()
                 self.current_cusp_run = new_cusp_run
                 self.run_active = True
 
@@ -672,8 +756,8 @@ class DAQControllerApp:
         try:
             while self.live_analysis_enabled:
                 try:
-                    message = socket.recv_string(flags=zmq.NOBLOCK)
-                    self.process_live_data(message)
+                    frame = socket.recv(flags=zmq.NOBLOCK)
+                    self.process_live_data(frame)
                 except zmq.Again:
                     time.sleep(0.1)  # Avoid busy wait
         except Exception as e:
@@ -727,8 +811,10 @@ class DAQControllerApp:
     #             self.live_process.terminate()
 
 
-    def after_analysis_monitor(self):
+    def after_analysis_monitor(self, run_number=None):
         """Starts analysis and waits for incoming data."""
+        if run_number is None:
+            run_number = self.run_number
         # context = zmq.Context()
         # socket = context.socket(zmq.SUB)
         # socket.connect("tcp://localhost:5555")
@@ -737,7 +823,7 @@ class DAQControllerApp:
         geometry = f"80x26+1140+400"
         self.live_process = subprocess.Popen(["gnome-terminal", f"--geometry={geometry}", 
                                               "--title=Live Analysis Terminal", "--", "bash", "-l", "-c", 
-                                              f"cd data_analysis/build; ./hodo_analysis {str(self.run_number)}"]) #add ; exec bash to keep window open
+                                              f"cd data_analysis/build; ./hodo_analysis {str(run_number)}"]) #add ; exec bash to keep window open
         print("Analysis done.")
         # try:
         #     while self.analysis_after_enabled:
@@ -760,22 +846,17 @@ class DAQControllerApp:
 
 
 
-    def process_live_data(self, message):
-        """Extracts the data form the recieved string"""
-        tokens = message.strip().split()
-        if not tokens:
-            return  # Skip empty messages
-    
-        if tokens[0] == "END":
-            if len(tokens) != 3:
-                self.console.write(f"END message has wrong length: {message}")
-                return
-            try:
-                sum_events = int(tokens[1])
-                sum_events_gated = int(tokens[2])
-            except ValueError:
-                self.console.write(f"Invalid number in END message: {message}")
-                return
+    def process_live_data(self, frame):
+        """Takes the monitoring histograms or the run summary from a received binary frame, see hodo_protocol.py"""
+        try:
+            frame_type, records = hodo_protocol.parse_frame(frame)
+        except hodo_protocol.ProtocolError as pe:
+            self.console.write(f"Invalid frame from live analysis: {pe}")
+            return
+
+        if frame_type == hodo_protocol.END:
+            sum_events = int(records["eventsCut"][0])
+            sum_events_gated = int(records["eventsCutGate"][0])
             self.update_plot()
             self.last_run_nr = self.run_number
             self.last_run_cusp = self.cusp_number_at_start
@@ -792,49 +873,31 @@ class DAQControllerApp:
 
             return
 
-        if len(tokens) < 3:
-            self.console.write(f"END message has wrong length: {message}")
-            return
-        try:
-            event_id = int(tokens[0])
-            tdc_time = float(tokens[1])*1e-9
-            gate = int(tokens[2])
-            active_channels = list(map(int, tokens[3:]))
-            self.console.write(f"Event {event_id}, Time {tdc_time:.2f}, Gate: {gate}, Channels: {active_channels}")
-        except ValueError as ve:
-            self.console.write(f"Invalid event data: {message}")
-            return
-
-        if event_id in self.seen_event_ids:
-            return 
-        self.seen_event_ids.add(event_id)
-
-        for ch in active_channels:
-            if ch < 64:
-                self.BGO_counts[ch] +=1
-
-        self.event_times.append([tdc_time, event_id, gate])
-        if self.live_analysis_enabled:
-            self.update_plot()
-        # if self.analysis_after_enabled:
-        #     self.root.after(5000, self.update_plot)
+        if frame_type == hodo_protocol.SNAPSHOT:
+            # The analysis sends the full histograms, nothing is accumulated here
+            self.monitor = records[0]
+            # bgoToTSum is missing in the snapshots of an older hodo_analysis
+            tot = self.bgo_map_tot and "bgoToTSum" in records.dtype.names
+            self.BGO_counts = self.monitor["bgoToTSum" if tot else "bgo"].astype(float)
+            self.console.write(f"Events: {self.monitor['eventsCut']}, Mixing Events: {self.monitor['eventsCutGate']}")
+        elif frame_type == hodo_protocol.TIMELINE:
+            self.timeline = records.copy()
+            if self.live_analysis_enabled:
+                self.update_plot()
 
 
     def update_plot(self):
-        if not self.event_times:
+        if self.monitor is None or len(self.timeline) == 0:
             return
-        tdc_times = np.array(self.event_times)[:,0]
-        tdc_event = np.arange(1, len(self.event_times) + 1) # np.array(self.event_times)[:,1]
-        tdc_gates = 1 - np.array(self.event_times)[:,2]
-        tdc_event_gated = np.arange(1, len(np.ma.array(np.array(self.event_times)[:,1], mask = tdc_gates).compressed()) + 1 )
+        time_bin = self.monitor["timeBin_s"]
+        tdc_times = np.arange(1, len(self.timeline) + 1) * time_bin
+        tdc_event = np.cumsum(self.timeline["events"])
+        tdc_event_gated = np.cumsum(self.timeline["eventsGate"])
 
         self.line.set_data(tdc_times, tdc_event)
-        self.line.set_label(f"Events: {np.max(tdc_event)}")
-        self.line2.set_data(np.ma.array(tdc_times, mask=tdc_gates).compressed(), tdc_event_gated)
-        try:
-            self.line2.set_label(f"Mixing Events: {np.max(tdc_event_gated)}")
-        except ValueError:
-            self.line2.set_label(f"Mixing Events: 0")
+        self.line.set_label(f"Events: {tdc_event[-1]}")
+        self.line2.set_data(tdc_times, tdc_event_gated)
+        self.line2.set_label(f"Mixing Events: {tdc_event_gated[-1]}")
         self.ax1.legend()
         self.ax1.relim()
         self.ax1.autoscale_view()
@@ -867,7 +930,7 @@ class DAQControllerApp:
         if axis == self.ax2:
             self.cbar.ax.yaxis.set_tick_params(color='#161616')  # Tick marks
             plt.setp(self.cbar.ax.get_yticklabels(), color='#161616')  # Tick text
-            self.cbar.set_label("Counts", color='#161616')  # Set color of the label
+            self.cbar.set_label(self.bgo_map_label, color='#161616')  # Set color of the label
             for spine in self.cbar.ax.spines.values():
                 spine.set_edgecolor('#161616')
         for spine in axis.spines.values():
@@ -880,7 +943,8 @@ class DAQControllerApp:
 
     def clear_plot1(self, axis, canvas):
         """Clears event plot, texts and outlines are light again"""
-        self.event_times.clear()
+        self.monitor = None
+        self.timeline = np.zeros(0, dtype=hodo_protocol.BIN_DTYPE)
         self.line.set_data([], [])
         self.line2.set_data([], [])
         axis.tick_params(colors='white')  # Tick label color
@@ -903,7 +967,7 @@ class DAQControllerApp:
         axis.yaxis.label.set_color('lightgray')
         self.cbar.ax.yaxis.set_tick_params(color='lightgray')  # Tick marks
         plt.setp(self.cbar.ax.get_yticklabels(), color='lightgray')  # Tick text
-        self.cbar.set_label("Counts", color='lightgray')  # Set color of the label
+        self.cbar.set_label(self.bgo_map_label, color='lightgray')  # Set color of the label
         for spine in self.cbar.ax.spines.values():
             spine.set_edgecolor('white')
         for spine in axis.spines.values():